@@ -17,7 +17,12 @@ def get_author_articles(author):
 
 @api_bp.route('/authors/<string:author>/collaborators', methods=['GET'])
 def get_author_collaborators(author):
-    collaborators = search_service.get_collaborators(author)
+    # ?limit=k returns only the k most frequent collaborators
+    limit = request.args.get('limit', default=None, type=int)
+    if limit is not None and limit < 0:
+        limit = None
+
+    collaborators = search_service.get_collaborators(author, limit)
     return jsonify({
         'success': True,
         'data': collaborators
@@ -15,13 +15,14 @@ def import_from_xml():
         }), 400
 
     try:
-        xml_content = request.data.decode('utf-8')
-        imported_count = import_service.import_from_xml(xml_content)
+        imported_count, mb_per_second = import_service.import_from_xml(
+            request.data)
 
         return jsonify({
             'success': True,
             'message': f'{imported_count} articles imported',
-            'count': imported_count
+            'count': imported_count,
+            'mb_per_second': mb_per_second
         })
     except Exception as e:
         return jsonify({
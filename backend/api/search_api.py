@@ -20,3 +20,37 @@ def search_by_keywords():
         'success': True,
         'data': [article.to_dict() for article in articles]
     })
+
+
+@api_bp.route('/search/ranked', methods=['GET'])
+def search_ranked():
+    query = request.args.get('q', '')
+    limit = request.args.get('limit', default=20, type=int)
+    if not query:
+        return jsonify({
+            'success': False,
+            'message': 'Empty keyword'
+        }), 400
+
+    return jsonify({
+        'success': True,
+        'data': search_service.search_articles_ranked(query, limit)
+    })
+
+
+@api_bp.route('/search/authors', methods=['GET'])
+def search_authors():
+    # names within ?distance= edits of ?q=, closest first
+    name = request.args.get('q', '')
+    max_distance = request.args.get('distance', default=2, type=int)
+    limit = request.args.get('limit', default=10, type=int)
+    if not name:
+        return jsonify({
+            'success': False,
+            'message': 'Empty author name'
+        }), 400
+
+    return jsonify({
+        'success': True,
+        'data': search_service.find_authors_fuzzy(name, max_distance, limit)
+    })
@@ -2,19 +2,22 @@ from flask import jsonify, request
 from backend.api import api_bp
 from backend.services.stats_service import StatsService
 from backend.config import storage
+from pivoter import CancellationToken, PivoterCancelled
 from flask import Response, stream_with_context
 import json
 import time
 
 stats_service = StatsService(storage)
 
+# largest k of /stats/collaboration/clique-authors
+MAX_CLIQUE_AUTHORS_K = 16
+
 
 @api_bp.route('/stats/authors/article-counts', methods=['GET'])
 def get_author_article_counts():
     limit = request.args.get('limit', default=100, type=int)
 
-    counts = stats_service.get_author_article_counts()
-    counts = counts[:limit]
+    counts = stats_service.get_author_article_counts(limit)
 
     return jsonify({
         'success': True,
@@ -38,13 +41,76 @@ def get_yearly_keyword_frequencies():
     })
 
 
+@api_bp.route('/stats/keywords/trend', methods=['GET'])
+def get_keyword_trend():
+    keywords = request.args.get('keywords', default='', type=str).split(',')
+    start = request.args.get('start', default=0, type=int)
+    end = request.args.get('end', default=9999, type=int)
+
+    if start > end:
+        return jsonify({
+            'success': False,
+            'message': 'start must not be after end'
+        }), 400
+
+    data = stats_service.get_keyword_trend(keywords, start, end)
+
+    return jsonify({
+        'success': True,
+        'data': {keyword: [{'year': year, 'count': count} for year, count in years.items()]
+                 for keyword, years in data.items()}
+    })
+
+
+@api_bp.route('/stats/collaboration/clique-authors', methods=['GET'])
+def get_top_clique_authors():
+    k = request.args.get('k', default=3, type=int)
+    limit = request.args.get('limit', default=100, type=int)
+
+    # the per-author counts take k + 1 doubles for every author
+    if k < 1 or k > MAX_CLIQUE_AUTHORS_K:
+        return jsonify({
+            'success': False,
+            'message': f'k must be between 1 and {MAX_CLIQUE_AUTHORS_K}'
+        }), 400
+
+    authors = stats_service.get_top_clique_authors(k, limit)
+
+    return jsonify({
+        'success': True,
+        'data': [{'author': author, 'count': count} for author, count in authors]
+    })
+
+
+@api_bp.route('/stats/collaboration/cliques-estimate', methods=['GET'])
+def get_cliques_estimate():
+    max_k = request.args.get('max_k', default=None, type=int)
+    if max_k is not None and max_k < 1:
+        max_k = None
+    # sampling time, loading the graph and its ordering come on top
+    budget_ms = request.args.get('budget_ms', default=500, type=int)
+    budget_ms = min(max(budget_ms, 0), 10000)
+
+    estimates = stats_service.estimate_cliques(max_k, budget_ms)
+
+    return jsonify({
+        'success': True,
+        'data': [{'order': order, 'count': count, 'low': low, 'high': high}
+                 for order, (count, low, high) in estimates.items()]
+    })
+
+
 @api_bp.route('/stats/collaboration/cliques-counts', methods=['GET'])
 def get_cliques_counts():
-    return Response(stream_with_context(generate_cliques_counts()),
+    max_k = request.args.get('max_k', default=None, type=int)
+    if max_k is not None and max_k < 1:
+        max_k = None
+
+    return Response(stream_with_context(generate_cliques_counts(max_k)),
                     content_type='text/event-stream')
 
 
-def generate_cliques_counts():
+def generate_cliques_counts(max_k=None):
     yield f"data: {json.dumps({'status': 'started', 'progress': 0})}\n\n"
 
     try:
@@ -71,11 +137,14 @@ def generate_cliques_counts():
 
         import threading
         result = {'data': None}
+        cancel_token = CancellationToken()
 
         def processing_thread():
             try:
                 result['data'] = stats_service.count_cliques_with_progress(
-                    progress_callback)
+                    progress_callback, max_k, cancel_token)
+            except PivoterCancelled:
+                pass
             except Exception as e:
                 progress_state.set_message('error', 0, 0)
                 print(f"Error in processing thread: {e}")
@@ -84,12 +153,18 @@ def generate_cliques_counts():
         thread.daemon = True
         thread.start()
 
-        while thread.is_alive():
-            message = progress_state.get_message()
-            if message:
-                yield message
-            import time
-            time.sleep(1)
+        try:
+            while thread.is_alive():
+                message = progress_state.get_message()
+                if message:
+                    yield message
+                import time
+                time.sleep(1)
+        finally:
+            # the client went away (GeneratorExit) or the stream failed,
+            # nobody is left to read the counts
+            if thread.is_alive():
+                cancel_token.cancel()
 
         message = progress_state.get_message()
         if message:
@@ -12,10 +12,30 @@
 #include <vector>
 #include <queue>
 #include <map>
+#include <algorithm>
 #include <string>
 #include <locale>
 #include <codecvt>
 #include <sys/socket.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <stdexcept>
+#include <thread>
+#include <exception>
+#include <list>
+#include <set>
+#include <deque>
+#include <memory>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "codec.h"
+#include "crc32c.h"
+#include "lru_cache.h"
 
 std::ostream& operator<<(std::ostream& os, const std::vector<int>& vec) {
     os << "[";
@@ -40,83 +60,261 @@ template<typename KeyT, typename ValT>
 class Node {
 public:
     bool leaf;
-    Node* parent;   //for non-root only
-    Node* next;     //for leaf only
+    uint64_t epoch;     // the tree's epoch when the node was made
     std::vector<KeyT> key;
     std::vector<Node*> ptr2node;    //for non-leaf only
     std::vector<ValT*> ptr2val;     //for leaf only
-    Node(bool _leaf = false);
+    size_t page;    //for leaf of a lazily loaded tree only, its slot in the leaf pool
+    Node(bool _leaf = false, uint64_t _epoch = 0);
 };
 
+// The leaves of a lazily loaded tree, read from the mapped index file
+// when they are first reached. Leaves as they are in the file are dropped
+// again, least recently used first, while they take more than budget
+// bytes of the file; changed leaves are kept until the tree is written.
+template<typename KeyT, typename ValT>
+struct LeafPool {
+    struct Page {
+        Node<KeyT, ValT>* node;     // null once the leaf was replaced
+        size_t node_id;     // of the leaf in the file
+        size_t parent_id;
+        size_t begin;       // of its record in the payload
+        size_t end;
+        bool resident;
+        bool dirty;
+        std::list<size_t>::iterator lru_pos;    // if resident and clean
+    };
+
+    std::string filename;
+    const char* data = nullptr;     // mapping of the file
+    size_t data_size = 0;
+    const char* payload = nullptr;
+    uint64_t payload_size = 0;
+    const char* block_crcs = nullptr;
+    uint32_t block_size = 0;
+    std::vector<bool> verified;     // blocks whose checksum was checked
+    std::vector<Page> pages;        // by leaf id in the file, from the first
+    std::list<size_t> lru;          // clean resident pages, most recent first
+    size_t budget = 0;
+    size_t bytes = 0;               // of the records of the clean resident pages
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+
+    LeafPool() = default;
+    LeafPool(const LeafPool&) = delete;
+    LeafPool& operator=(const LeafPool&) = delete;
+    ~LeafPool() {
+        unmap();
+    }
+
+    void unmap() {
+        if (data) {
+            munmap(const_cast<char*>(data), data_size);
+            data = nullptr;
+        }
+    }
+
+    // checks the blocks holding payload bytes [begin, end) once
+    void verify(size_t begin, size_t end);
+};
+
+// Versions are kept copy-on-write. A snapshot freezes the nodes of the
+// tree as it is; the epoch then moves on and a change first copies every
+// node on its path a snapshot can see, so the nodes of the newest epoch
+// are changed in place. The nodes copies replaced are freed once no
+// snapshot older than their replacement is open. Without open snapshots
+// nothing is copied.
 template<typename KeyT, typename ValT>
 class BPTree {
 private:
     int order;
     Node<KeyT, ValT>* root;
     inline int keyIndex(Node<KeyT, ValT>* _node, KeyT _key);
-    inline std::pair<Node<KeyT, ValT>*, int> keyIndexInLeaf(KeyT _key);
+    inline std::pair<Node<KeyT, ValT>*, int> keyIndexInLeaf(Node<KeyT, ValT>* _root, KeyT _key);
     Node<KeyT, ValT>* splitLeaf(Node<KeyT, ValT>* _leaf);
-    void createIndex(Node<KeyT, ValT>* _new_node, KeyT _index);
     std::pair<Node<KeyT, ValT>*, KeyT> splitNode(Node<KeyT, ValT>* _node);
+    void clear();
+    static Node<KeyT, ValT>* decodeNode(const char*& position, const char* end, size_t& node_id,
+        size_t& parent_id, size_t& next_id, std::vector<size_t>& children_ids);
+
+    // reads of the current version and of snapshots
+    ValT* findIn(Node<KeyT, ValT>* _root, KeyT _key);
+    size_t countIn(Node<KeyT, ValT>* _root, KeyT _key);
+    std::vector<KeyT> keysIn(Node<KeyT, ValT>* _root);
+    std::vector<ValT> valuesIn(Node<KeyT, ValT>* _root);
+    std::vector<std::pair<KeyT, ValT>> rangeIn(Node<KeyT, ValT>* _root, KeyT _lo, KeyT _hi);
+    template<typename Fn>
+    void forEachLeaf(Node<KeyT, ValT>* _node, Fn fn);
+    template<typename Fn>
+    void forEachLeafIn(Node<KeyT, ValT>* _node, KeyT _lo, KeyT _hi, Fn fn);
+
+    // copy-on-write
+    uint64_t epoch;
+    std::multiset<uint64_t> snapshots;      // epochs of the open snapshots
+    std::deque<std::pair<uint64_t, Node<KeyT, ValT>*>> retired;     // by the epoch they were replaced in
+    inline bool writable(Node<KeyT, ValT>* _node);
+    Node<KeyT, ValT>* copyNode(Node<KeyT, ValT>* _node);
+    Node<KeyT, ValT>* writablePath(KeyT _key, std::vector<std::pair<Node<KeyT, ValT>*, int>>& _path);
+    void releaseSnapshot(uint64_t _epoch);
+    static void freeNode(Node<KeyT, ValT>* _node);
+
+    // lazily loaded leaves, null if the whole tree is in memory
+    std::unique_ptr<LeafPool<KeyT, ValT>> pool;
+    inline void fetch(Node<KeyT, ValT>* _leaf);
+    inline void changed(Node<KeyT, ValT>* _leaf);
+    void loadPage(size_t _page);
+    void evictPage(size_t _page);
+    void detachPage(Node<KeyT, ValT>* _leaf);
+    void remapPool(const std::string& filename, const std::vector<Node<KeyT, ValT>*>& all_nodes,
+        const std::vector<size_t>& parent_ids, const std::vector<size_t>& offsets, const std::string& payload);
 
 public:
+    // The tree as it was when taken, for consistent reads across calls
+    // while the tree changes. It must not outlive the tree.
+    class Snapshot {
+    public:
+        Snapshot(Snapshot&& other);
+        Snapshot(const Snapshot&) = delete;
+        ~Snapshot();
+        ValT* find(KeyT _key);
+        size_t count(KeyT _key);
+        std::vector<KeyT> keys();
+        std::vector<ValT> values();
+        std::vector<std::pair<KeyT, ValT>> range(KeyT _lo, KeyT _hi);
+        // lets the nodes only this snapshot sees go before it is destroyed
+        void release();
+
+    private:
+        friend class BPTree;
+        Snapshot(BPTree* tree, Node<KeyT, ValT>* root, uint64_t epoch);
+        BPTree* tree;
+        Node<KeyT, ValT>* root;
+        uint64_t epoch;
+    };
+
     BPTree(int order);
     std::vector<KeyT> keys();
     std::vector<ValT> values();
     void insert(KeyT _key, ValT _val);
     bool update(KeyT _key, ValT _new_val);
+    // on a lazily loaded tree, valid until the next call
     ValT* find(KeyT _key);
+    size_t count(KeyT _key);
+    // keys in [_lo, _hi] with their values, in key order
+    std::vector<std::pair<KeyT, ValT>> range(KeyT _lo, KeyT _hi);
+    template<typename ElemT>
+    bool append(KeyT _key, ElemT _elem);
+    // throws std::runtime_error unless the tree is empty
+    void bulkLoad(std::vector<KeyT>& _keys, std::vector<ValT>& _vals);
+    bool empty() const;
+    Snapshot snapshot();
+    // throws std::runtime_error on a corrupt file, keeping the tree as it was
     void deserialize(const std::string& filename);
+    // loads the inner nodes and reads leaves when they are reached, keeping
+    // about budget bytes of them; a leaf failing its checks throws then
+    void deserializeLazy(const std::string& filename, size_t budget);
+    // throws std::runtime_error if the file cannot be written, keeping the old one
     void serialize(const std::string& filename);
+    CacheStats leafPoolStats() const;
 };
 
+// calls fn on the leaves under _node from left to right
 template<typename KeyT, typename ValT>
-std::vector<KeyT> BPTree<KeyT, ValT>::keys() {
-    std::vector<KeyT> result;
+template<typename Fn>
+void BPTree<KeyT, ValT>::forEachLeaf(Node<KeyT, ValT>* _node, Fn fn) {
+    if (_node->leaf) {
+        fetch(_node);
+        fn(_node);
+        return;
+    }
+    for (Node<KeyT, ValT>* child : _node->ptr2node) {
+        forEachLeaf(child, fn);
+    }
+}
 
-    if (!root) {
-        return result;
+// calls fn on the leaves under _node that may hold keys in [_lo, _hi]
+template<typename KeyT, typename ValT>
+template<typename Fn>
+void BPTree<KeyT, ValT>::forEachLeafIn(Node<KeyT, ValT>* _node, KeyT _lo, KeyT _hi, Fn fn) {
+    if (_node->leaf) {
+        fetch(_node);
+        fn(_node);
+        return;
+    }
+    int last = keyIndex(_node, _hi) + 1;
+    for (int i = keyIndex(_node, _lo) + 1; i <= last; i++) {
+        forEachLeafIn(_node->ptr2node[i], _lo, _hi, fn);
     }
+}
+
+template<typename KeyT, typename ValT>
+std::vector<KeyT> BPTree<KeyT, ValT>::keysIn(Node<KeyT, ValT>* _root) {
+    std::vector<KeyT> result;
 
-    Node<KeyT, ValT>* leaf = root;
-    while (!leaf->leaf) {
-        leaf = leaf->ptr2node[0];
+    if (!_root) {
+        return result;
     }
 
-    while (leaf) {
+    forEachLeaf(_root, [&result](Node<KeyT, ValT>* leaf) {
         for (const KeyT& k : leaf->key) {
             result.push_back(k);
         }
-        leaf = leaf->next;
-    }
+    });
 
     return result;
 }
 
 template<typename KeyT, typename ValT>
-std::vector<ValT> BPTree<KeyT, ValT>::values() {
+std::vector<ValT> BPTree<KeyT, ValT>::valuesIn(Node<KeyT, ValT>* _root) {
     std::vector<ValT> result;
 
-    if (!root) {
+    if (!_root) {
         return result;
     }
 
-    Node<KeyT, ValT>* leaf = root;
-    while (!leaf->leaf) {
-        leaf = leaf->ptr2node[0];
-    }
-
-    while (leaf) {
+    forEachLeaf(_root, [&result](Node<KeyT, ValT>* leaf) {
         for (ValT* val_ptr : leaf->ptr2val) {
             if (val_ptr) {
                 result.push_back(*val_ptr);
             }
         }
-        leaf = leaf->next;
+    });
+    return result;
+}
+
+template<typename KeyT, typename ValT>
+std::vector<std::pair<KeyT, ValT>> BPTree<KeyT, ValT>::rangeIn(Node<KeyT, ValT>* _root, KeyT _lo, KeyT _hi) {
+    std::vector<std::pair<KeyT, ValT>> result;
+
+    if (!_root || _hi < _lo) {
+        return result;
     }
+
+    forEachLeafIn(_root, _lo, _hi, [&](Node<KeyT, ValT>* leaf) {
+        for (size_t i = 0; i < leaf->key.size(); i++) {
+            if (_lo <= leaf->key[i] && leaf->key[i] <= _hi) {
+                result.emplace_back(leaf->key[i], *leaf->ptr2val[i]);
+            }
+        }
+    });
     return result;
 }
 
+template<typename KeyT, typename ValT>
+std::vector<std::pair<KeyT, ValT>> BPTree<KeyT, ValT>::range(KeyT _lo, KeyT _hi) {
+    return rangeIn(root, _lo, _hi);
+}
+
+template<typename KeyT, typename ValT>
+std::vector<KeyT> BPTree<KeyT, ValT>::keys() {
+    return keysIn(root);
+}
+
+template<typename KeyT, typename ValT>
+std::vector<ValT> BPTree<KeyT, ValT>::values() {
+    return valuesIn(root);
+}
+
 
 template<typename KeyT, typename ValT>
 inline int BPTree<KeyT, ValT>::keyIndex(Node<KeyT, ValT>* _node, KeyT _key) {
@@ -129,28 +327,25 @@ inline int BPTree<KeyT, ValT>::keyIndex(Node<KeyT, ValT>* _node, KeyT _key) {
 }
 
 template<typename KeyT, typename ValT>
-inline std::pair<Node<KeyT, ValT>*, int> BPTree<KeyT, ValT>::keyIndexInLeaf(KeyT _key) {
-    if (root == nullptr) {
+inline std::pair<Node<KeyT, ValT>*, int> BPTree<KeyT, ValT>::keyIndexInLeaf(Node<KeyT, ValT>* _root, KeyT _key) {
+    if (_root == nullptr) {
         return std::make_pair(nullptr, -1);
     }
-    Node<KeyT, ValT>* node = root;
+    Node<KeyT, ValT>* node = _root;
     while (true) {
-        int loc = keyIndex(node, _key);
         if (node->leaf) {
-            return std::make_pair(node, loc);
+            fetch(node);
+            return std::make_pair(node, keyIndex(node, _key));
         }
         else {
-            node = node->ptr2node[loc + 1];
+            node = node->ptr2node[keyIndex(node, _key) + 1];
         }
     }
 }
 
 template<typename KeyT, typename ValT>
 Node<KeyT, ValT>* BPTree<KeyT, ValT>::splitLeaf(Node<KeyT, ValT>* _leaf) {
-    Node<KeyT, ValT>* new_leaf = new Node<KeyT, ValT>(LEAF);
-    new_leaf->next = _leaf->next;
-    _leaf->next = new_leaf;
-    new_leaf->parent = _leaf->parent;
+    Node<KeyT, ValT>* new_leaf = new Node<KeyT, ValT>(LEAF, epoch);
     int mid = _leaf->key.size() / 2;
     new_leaf->key.assign(_leaf->key.begin() + mid, _leaf->key.end());
     new_leaf->ptr2val.assign(_leaf->ptr2val.begin() + mid, _leaf->ptr2val.end());
@@ -161,63 +356,156 @@ Node<KeyT, ValT>* BPTree<KeyT, ValT>::splitLeaf(Node<KeyT, ValT>* _leaf) {
 
 template<typename KeyT, typename ValT>
 std::pair<Node<KeyT, ValT>*, KeyT> BPTree<KeyT, ValT>::splitNode(Node<KeyT, ValT>* _node) {
-    Node<KeyT, ValT>* new_node = new Node<KeyT, ValT>();
-    new_node->parent = _node->parent;
+    Node<KeyT, ValT>* new_node = new Node<KeyT, ValT>(false, epoch);
     int mid = (_node->key.size() + 1) / 2 - 1;
     KeyT push_key = _node->key[mid];
     new_node->key.assign(_node->key.begin() + mid + 1, _node->key.end());
     new_node->ptr2node.assign(_node->ptr2node.begin() + mid + 1, _node->ptr2node.end());
     _node->key.erase(_node->key.begin() + mid, _node->key.end());
     _node->ptr2node.erase(_node->ptr2node.begin() + mid + 1, _node->ptr2node.end());
-    for (Node<KeyT, ValT>* each : new_node->ptr2node)
-        each->parent = new_node;
     return std::make_pair(new_node, push_key);
 }
 
 template<typename KeyT, typename ValT>
-void BPTree<KeyT, ValT>::createIndex(Node<KeyT, ValT>* _new_node, KeyT _index) {
-    Node<KeyT, ValT>* node = _new_node->parent;
-    int loc = keyIndex(node, _index);
-    node->key.insert(node->key.begin() + loc + 1, _index);
-    node->ptr2node.insert(node->ptr2node.begin() + loc + 2, _new_node);
-    if (node->key.size() > order) {
-        std::pair<Node<KeyT, ValT>*, KeyT> pair = splitNode(node);
-        Node<KeyT, ValT>* new_node = pair.first;
-        KeyT push_key = pair.second;
-        if (node == root) {
-            Node<KeyT, ValT>* new_root = new Node<KeyT, ValT>();
-            new_root->key.push_back(push_key);
-            new_root->ptr2node.push_back(node);
-            new_root->ptr2node.push_back(new_node);
-            root = new_root;
-            node->parent = root;
-            new_node->parent = root;
+Node<KeyT, ValT>::Node(bool _leaf, uint64_t _epoch) : leaf(_leaf), epoch(_epoch), page(size_t(-1)) {}
+
+template<typename KeyT, typename ValT>
+BPTree<KeyT, ValT>::BPTree(int order) : root(nullptr), order(order), epoch(1) {}
+
+// no open snapshot sees the node
+template<typename KeyT, typename ValT>
+inline bool BPTree<KeyT, ValT>::writable(Node<KeyT, ValT>* _node) {
+    return snapshots.empty() || _node->epoch > *snapshots.rbegin();
+}
+
+// a copy of the node for the current epoch, which replaces it
+template<typename KeyT, typename ValT>
+Node<KeyT, ValT>* BPTree<KeyT, ValT>::copyNode(Node<KeyT, ValT>* _node) {
+    Node<KeyT, ValT>* copy = new Node<KeyT, ValT>(_node->leaf, epoch);
+    if (_node->leaf) {
+        fetch(_node);
+        copy->key = _node->key;
+        copy->ptr2val.reserve(_node->ptr2val.size());
+        for (ValT* val_ptr : _node->ptr2val) {
+            copy->ptr2val.push_back(new ValT(*val_ptr));
         }
-        else {
-            createIndex(new_node, push_key);
+        // snapshots keep reading the old leaf from memory
+        detachPage(_node);
+    }
+    else {
+        copy->key = _node->key;
+        copy->ptr2node = _node->ptr2node;
+    }
+    retired.emplace_back(epoch, _node);
+    return copy;
+}
+
+// the leaf _key belongs in, with the nodes down to it made writable;
+// _path gets the inner nodes and the child taken in each
+template<typename KeyT, typename ValT>
+Node<KeyT, ValT>* BPTree<KeyT, ValT>::writablePath(KeyT _key, std::vector<std::pair<Node<KeyT, ValT>*, int>>& _path) {
+    if (!writable(root)) {
+        root = copyNode(root);
+    }
+    Node<KeyT, ValT>* node = root;
+    while (!node->leaf) {
+        int loc = keyIndex(node, _key) + 1;
+        if (!writable(node->ptr2node[loc])) {
+            node->ptr2node[loc] = copyNode(node->ptr2node[loc]);
         }
+        _path.emplace_back(node, loc);
+        node = node->ptr2node[loc];
     }
+    fetch(node);
+    return node;
+}
+
+template<typename KeyT, typename ValT>
+void BPTree<KeyT, ValT>::freeNode(Node<KeyT, ValT>* _node) {
+    for (ValT* val_ptr : _node->ptr2val) {
+        delete val_ptr;
+    }
+    delete _node;
+}
+
+template<typename KeyT, typename ValT>
+typename BPTree<KeyT, ValT>::Snapshot BPTree<KeyT, ValT>::snapshot() {
+    snapshots.insert(epoch);
+    return Snapshot(this, root, epoch++);
+}
+
+template<typename KeyT, typename ValT>
+void BPTree<KeyT, ValT>::releaseSnapshot(uint64_t _epoch) {
+    snapshots.erase(snapshots.find(_epoch));
+
+    // a node replaced in epoch e is seen by the snapshots before e
+    while (!retired.empty() && (snapshots.empty() || retired.front().first <= *snapshots.begin())) {
+        freeNode(retired.front().second);
+        retired.pop_front();
+    }
+}
+
+template<typename KeyT, typename ValT>
+BPTree<KeyT, ValT>::Snapshot::Snapshot(BPTree* tree, Node<KeyT, ValT>* root, uint64_t epoch)
+    : tree(tree), root(root), epoch(epoch) {}
+
+template<typename KeyT, typename ValT>
+BPTree<KeyT, ValT>::Snapshot::Snapshot(Snapshot&& other) : tree(other.tree), root(other.root), epoch(other.epoch) {
+    other.tree = nullptr;
+}
+
+template<typename KeyT, typename ValT>
+BPTree<KeyT, ValT>::Snapshot::~Snapshot() {
+    release();
+}
+
+template<typename KeyT, typename ValT>
+void BPTree<KeyT, ValT>::Snapshot::release() {
+    if (tree) {
+        tree->releaseSnapshot(epoch);
+        tree = nullptr;
+        root = nullptr;
+    }
+}
+
+template<typename KeyT, typename ValT>
+ValT* BPTree<KeyT, ValT>::Snapshot::find(KeyT _key) {
+    return tree ? tree->findIn(root, _key) : nullptr;
+}
+
+template<typename KeyT, typename ValT>
+size_t BPTree<KeyT, ValT>::Snapshot::count(KeyT _key) {
+    return tree ? tree->countIn(root, _key) : 0;
+}
+
+template<typename KeyT, typename ValT>
+std::vector<KeyT> BPTree<KeyT, ValT>::Snapshot::keys() {
+    return tree ? tree->keysIn(root) : std::vector<KeyT>();
 }
 
 template<typename KeyT, typename ValT>
-Node<KeyT, ValT>::Node(bool _leaf) : leaf(_leaf), parent(nullptr), next(nullptr) {}
+std::vector<ValT> BPTree<KeyT, ValT>::Snapshot::values() {
+    return tree ? tree->valuesIn(root) : std::vector<ValT>();
+}
 
 template<typename KeyT, typename ValT>
-BPTree<KeyT, ValT>::BPTree(int order) : root(nullptr), order(order) {}
+std::vector<std::pair<KeyT, ValT>> BPTree<KeyT, ValT>::Snapshot::range(KeyT _lo, KeyT _hi) {
+    return tree ? tree->rangeIn(root, _lo, _hi) : std::vector<std::pair<KeyT, ValT>>();
+}
 
 
 template<typename KeyT, typename ValT>
 void BPTree<KeyT, ValT>::insert(KeyT _key, ValT _val) {
     if (root == nullptr) {
-        root = new Node<KeyT, ValT>(LEAF);
+        root = new Node<KeyT, ValT>(LEAF, epoch);
         root->key.push_back(_key);
         root->ptr2val.emplace_back(new ValT(_val));
-        root->ptr2node.push_back(nullptr);
         return;
     }
-    std::pair<Node<KeyT, ValT>*, int> pair = keyIndexInLeaf(_key);
-    Node<KeyT, ValT>* leaf = pair.first;
-    int loc = pair.second;
+    std::vector<std::pair<Node<KeyT, ValT>*, int>> path;
+    Node<KeyT, ValT>* leaf = writablePath(_key, path);
+    int loc = keyIndex(leaf, _key);
+    changed(leaf);
     if (loc != -1 && leaf->key[loc] == _key) {
 #ifdef DEBUG
         std::cout << "Key " << _key << " with value " << *(leaf->ptr2val[loc]) << " is already in B+ tree, overwrite it with new val " << _val << std::endl;
@@ -227,26 +515,42 @@ void BPTree<KeyT, ValT>::insert(KeyT _key, ValT _val) {
     }
     leaf->key.insert(leaf->key.begin() + loc + 1, _key);
     leaf->ptr2val.insert(leaf->ptr2val.begin() + loc + 1, new ValT(_val));
-    if (leaf->key.size() > order) {
-        Node<KeyT, ValT>* new_leaf = splitLeaf(leaf);
-        if (leaf == root) {
-            Node<KeyT, ValT>* new_root = new Node<KeyT, ValT>();
-            new_root->key.push_back(new_leaf->key[0]);
-            new_root->ptr2node.push_back(leaf);
-            new_root->ptr2node.push_back(new_leaf);
+    if (leaf->key.size() <= order) {
+        return;
+    }
+
+    // the new node of each split goes right of the old one in the node
+    // above, which may split in turn
+    Node<KeyT, ValT>* node = leaf;
+    Node<KeyT, ValT>* new_node = splitLeaf(leaf);
+    KeyT push_key = new_node->key[0];
+    while (true) {
+        if (path.empty()) {
+            Node<KeyT, ValT>* new_root = new Node<KeyT, ValT>(false, epoch);
+            new_root->key.push_back(push_key);
+            new_root->ptr2node.push_back(node);
+            new_root->ptr2node.push_back(new_node);
             root = new_root;
-            leaf->parent = root;
-            new_leaf->parent = root;
+            return;
         }
-        else {
-            createIndex(new_leaf, new_leaf->key[0]);
+        Node<KeyT, ValT>* parent = path.back().first;
+        int child = path.back().second;
+        path.pop_back();
+        parent->key.insert(parent->key.begin() + child, push_key);
+        parent->ptr2node.insert(parent->ptr2node.begin() + child + 1, new_node);
+        if (parent->key.size() <= order) {
+            return;
         }
+        std::pair<Node<KeyT, ValT>*, KeyT> pair = splitNode(parent);
+        node = parent;
+        new_node = pair.first;
+        push_key = pair.second;
     }
 }
 
 template<typename KeyT, typename ValT>
-ValT* BPTree<KeyT, ValT>::find(KeyT _key) {
-    std::pair<Node<KeyT, ValT>*, int> pair = keyIndexInLeaf(_key);
+ValT* BPTree<KeyT, ValT>::findIn(Node<KeyT, ValT>* _root, KeyT _key) {
+    std::pair<Node<KeyT, ValT>*, int> pair = keyIndexInLeaf(_root, _key);
     Node<KeyT, ValT>* leaf = pair.first;
     int loc = pair.second;
     if (loc == -1 || leaf->key[loc] != _key) {
@@ -260,310 +564,1012 @@ ValT* BPTree<KeyT, ValT>::find(KeyT _key) {
     }
 }
 
+template<typename KeyT, typename ValT>
+ValT* BPTree<KeyT, ValT>::find(KeyT _key) {
+    return findIn(root, _key);
+}
+
+
+// number of elements a value holds, 1 for scalars
+template<typename ValT>
+inline size_t valueCount(const ValT&) {
+    return 1;
+}
+
+template<typename ElemT>
+inline size_t valueCount(const std::vector<ElemT>& _val) {
+    return _val.size();
+}
+
+template<typename KeyT, typename ValT>
+size_t BPTree<KeyT, ValT>::countIn(Node<KeyT, ValT>* _root, KeyT _key) {
+    ValT* val = findIn(_root, _key);
+    return val ? valueCount(*val) : 0;
+}
+
+template<typename KeyT, typename ValT>
+size_t BPTree<KeyT, ValT>::count(KeyT _key) {
+    return countIn(root, _key);
+}
+
+// add _elem to the list value of _key in place, unless it is already there
+template<typename KeyT, typename ValT>
+template<typename ElemT>
+bool BPTree<KeyT, ValT>::append(KeyT _key, ElemT _elem) {
+    ValT* val = find(_key);
+    if (val == nullptr) {
+        insert(_key, ValT{ _elem });
+        return true;
+    }
+    // lists are appended in increasing order, so a repeat is usually last
+    if (!val->empty() && (val->back() == _elem
+        || std::find(val->begin(), val->end(), _elem) != val->end())) {
+        return false;
+    }
+
+    std::vector<std::pair<Node<KeyT, ValT>*, int>> path;
+    Node<KeyT, ValT>* leaf = writablePath(_key, path);
+    changed(leaf);
+    leaf->ptr2val[keyIndex(leaf, _key)]->push_back(_elem);
+    return true;
+}
+
+// build an empty tree bottom-up from sorted distinct keys, taking the
+// keys and values; leaves and nodes are filled up to order keys
+template<typename KeyT, typename ValT>
+void BPTree<KeyT, ValT>::bulkLoad(std::vector<KeyT>& _keys, std::vector<ValT>& _vals) {
+    if (root != nullptr) {
+        throw std::runtime_error("bulk load needs an empty B+ tree");
+    }
+    if (_keys.empty()) {
+        return;
+    }
+
+    // level: nodes with the smallest key below each
+    std::vector<Node<KeyT, ValT>*> level;
+    std::vector<KeyT> level_min;
+    for (size_t i = 0; i < _keys.size(); i += order) {
+        size_t end = std::min(_keys.size(), i + order);
+        Node<KeyT, ValT>* leaf = new Node<KeyT, ValT>(LEAF, epoch);
+        leaf->key.assign(std::make_move_iterator(_keys.begin() + i), std::make_move_iterator(_keys.begin() + end));
+        for (size_t j = i; j < end; j++) {
+            leaf->ptr2val.push_back(new ValT(std::move(_vals[j])));
+        }
+        level_min.push_back(leaf->key[0]);
+        level.push_back(leaf);
+    }
+    _keys.clear();
+    _vals.clear();
+
+    // a node of order keys has order + 1 children
+    while (level.size() > 1) {
+        std::vector<Node<KeyT, ValT>*> upper;
+        std::vector<KeyT> upper_min;
+        for (size_t i = 0; i < level.size(); i += order + 1) {
+            size_t end = std::min(level.size(), i + order + 1);
+            Node<KeyT, ValT>* node = new Node<KeyT, ValT>(false, epoch);
+            for (size_t j = i; j < end; j++) {
+                if (j > i) {
+                    node->key.push_back(level_min[j]);
+                }
+                node->ptr2node.push_back(level[j]);
+            }
+            upper_min.push_back(level_min[i]);
+            upper.push_back(node);
+        }
+        level.swap(upper);
+        level_min.swap(upper_min);
+    }
+    root = level[0];
+}
+
+template<typename KeyT, typename ValT>
+bool BPTree<KeyT, ValT>::empty() const {
+    return root == nullptr;
+}
 
 template<typename KeyT, typename ValT>
 bool BPTree<KeyT, ValT>::update(KeyT _key, ValT _new_val) {
-    std::pair<Node<KeyT, ValT>*, int> pair = keyIndexInLeaf(_key);
-    Node<KeyT, ValT>* leaf = pair.first;
-    int loc = pair.second;
-    if (loc == -1 || leaf->key[loc] != _key) {
+    if (find(_key) == nullptr) {
 #ifdef DEBUG
         std::cout << "Key " << _key << " is not in B+ tree" << std::endl;
 #endif
         return false;
     }
     else {
-        *(leaf->ptr2val[loc]) = _new_val;
+        std::vector<std::pair<Node<KeyT, ValT>*, int>> path;
+        Node<KeyT, ValT>* leaf = writablePath(_key, path);
+        changed(leaf);
+        *(leaf->ptr2val[keyIndex(leaf, _key)]) = _new_val;
         return true;
     }
 }
 
+// Index files start with a header: magic, format version, the tags of the
+// key and value encodings, the block size, the payload size and a CRC32C
+// of the header itself. A CRC32C of every block of the payload follows,
+// then the payload: order, has_root, node count, the offset of every
+// node in the payload and the nodes, so nodes are decoded in parallel.
+// Nodes are numbered level by level, the leaves last. Version 2 files have
+// no node offsets, files of the first version are just the payload; both
+// are still read.
+#define BPTREE_MAGIC "BPTFILE"
+#define BPTREE_VERSION 3
+#define BPTREE_BLOCK_SIZE (1 << 20)
+#define BPTREE_HEADER_SIZE (8 + 4 * sizeof(uint32_t) + sizeof(uint64_t) + sizeof(uint32_t))
+// id, type, parent and next of a node record, before its keys
+#define BPTREE_NODE_HEADER_SIZE (3 * sizeof(size_t) + sizeof(bool))
+
+inline bool writeAll(int fd, const char* data, size_t size) {
+    while (size > 0) {
+        ssize_t written = write(fd, data, size);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        data += written;
+        size -= written;
+    }
+    return true;
+}
+
+// writes filename + ".tmp", syncs it and renames it over filename, so a
+// crash leaves either the old or the new file there, never a partial one
+inline bool replaceFile(const std::string& filename, const std::string& header, const std::string& payload) {
+    std::string tmp_filename = filename + ".tmp";
+    int fd = open(tmp_filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        return false;
+    }
+    bool ok = writeAll(fd, header.data(), header.size())
+        && writeAll(fd, payload.data(), payload.size())
+        && fsync(fd) == 0;
+    ok = (close(fd) == 0) && ok;
+    if (!ok || rename(tmp_filename.c_str(), filename.c_str()) != 0) {
+        unlink(tmp_filename.c_str());
+        return false;
+    }
+
+    // the rename is only durable once the directory is synced
+    size_t slash = filename.rfind('/');
+    std::string dir = (slash == std::string::npos) ? "." : filename.substr(0, slash + 1);
+    int dir_fd = open(dir.c_str(), O_RDONLY | O_DIRECTORY);
+    if (dir_fd >= 0) {
+        fsync(dir_fd);
+        close(dir_fd);
+    }
+    return true;
+}
+
+// runs fn(begin, end) on parts of [0, count) in parallel, at least
+// min_per_thread items each, and rethrows what any of them threw
+template<typename Fn>
+inline void parallelFor(size_t count, size_t min_per_thread, Fn fn) {
+    size_t threads = std::min<size_t>(std::max(1u, std::thread::hardware_concurrency()),
+        std::max<size_t>(1, count / std::max<size_t>(1, min_per_thread)));
+    size_t chunk = (count + threads - 1) / std::max<size_t>(1, threads);
+
+    std::vector<std::exception_ptr> errors(threads);
+    auto run = [&](size_t t) {
+        try {
+            fn(std::min(count, t * chunk), std::min(count, (t + 1) * chunk));
+        }
+        catch (...) {
+            errors[t] = std::current_exception();
+        }
+    };
+
+    // the calling thread takes the first part
+    std::vector<std::thread> workers;
+    try {
+        for (size_t t = 1; t < threads; t++) {
+            workers.emplace_back(run, t);
+        }
+    }
+    catch (...) {
+        for (std::thread& worker : workers) {
+            worker.join();
+        }
+        throw;
+    }
+    run(0);
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+
+    for (std::exception_ptr& error : errors) {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+}
+
+// an index file whose header was checked
+struct IndexFile {
+    uint32_t version;
+    const char* payload;
+    const char* end;
+    const char* block_crcs;     // from version 2
+    uint32_t block_size;
+
+    size_t blockCount() const {
+        return block_crcs ? (size_t(end - payload) + block_size - 1) / block_size : 0;
+    }
+};
+
+inline std::runtime_error corruptIndexFile(const std::string& filename, const std::string& reason) {
+    return std::runtime_error("Corrupt index file " + filename + ": " + reason);
+}
 
 template<typename KeyT, typename ValT>
-void BPTree<KeyT, ValT>::serialize(const std::string& filename) {
-    std::ofstream outfile(filename, std::ios::binary);
-    if (!outfile) {
-        std::cerr << "Error opening file for writing!" << std::endl;
-        return;
+IndexFile indexFile(const char* data, size_t size, const std::string& filename) {
+    const char* position = data;
+    const char* end = data + size;
+    if (size < 8 || memcmp(position, BPTREE_MAGIC, 8) != 0) {
+        // first version, no header
+        return { 1, position, end, nullptr, 0 };
+    }
+
+    if (size < BPTREE_HEADER_SIZE) {
+        throw corruptIndexFile(filename, "truncated header");
+    }
+    position += 8;
+    uint32_t version = decodeFrom<uint32_t>(position, end);
+    uint32_t key_tag = decodeFrom<uint32_t>(position, end);
+    uint32_t val_tag = decodeFrom<uint32_t>(position, end);
+    uint32_t block_size = decodeFrom<uint32_t>(position, end);
+    uint64_t payload_size = decodeFrom<uint64_t>(position, end);
+    uint32_t header_crc = decodeFrom<uint32_t>(position, end);
+    if (header_crc != crc32c(data, BPTREE_HEADER_SIZE - sizeof(uint32_t))) {
+        throw corruptIndexFile(filename, "header checksum mismatch");
+    }
+    if (version < 2 || version > BPTREE_VERSION) {
+        throw std::runtime_error("Index file " + filename + " has unsupported version " + std::to_string(version));
+    }
+    if (key_tag != Codec<KeyT>::tag() || val_tag != Codec<ValT>::tag()) {
+        throw std::runtime_error("Index file " + filename + " holds other key or value types");
     }
+    if (block_size == 0) {
+        throw corruptIndexFile(filename, "zero block size");
+    }
+
+    uint64_t num_blocks = (payload_size + block_size - 1) / block_size;
+    if (uint64_t(end - position) < num_blocks * sizeof(uint32_t)
+        || uint64_t(end - position) - num_blocks * sizeof(uint32_t) != payload_size) {
+        throw corruptIndexFile(filename, "expected " + std::to_string(payload_size) + " bytes of data");
+    }
+    return { version, position + num_blocks * sizeof(uint32_t), end, position, block_size };
+}
+
+// checks blocks [first, last) of the payload against their checksums
+inline void verifyIndexBlocks(const IndexFile& file, size_t first, size_t last, const std::string& filename) {
+    size_t payload_size = file.end - file.payload;
+    for (size_t block = first; block < last; block++) {
+        uint32_t block_crc;
+        memcpy(&block_crc, file.block_crcs + block * sizeof(uint32_t), sizeof(block_crc));
+        size_t offset = block * file.block_size;
+        if (block_crc != crc32c(file.payload + offset, std::min<size_t>(file.block_size, payload_size - offset))) {
+            throw corruptIndexFile(filename, "checksum mismatch in block " + std::to_string(block));
+        }
+    }
+}
+
+template<typename KeyT, typename ValT>
+void LeafPool<KeyT, ValT>::verify(size_t begin, size_t end) {
+    IndexFile file{ BPTREE_VERSION, payload, payload + payload_size, block_crcs, block_size };
+    for (size_t block = begin / block_size; block * block_size < end; block++) {
+        if (!verified[block]) {
+            verifyIndexBlocks(file, block, block + 1, filename);
+            verified[block] = true;
+        }
+    }
+}
+
+template<typename KeyT, typename ValT>
+void BPTree<KeyT, ValT>::serialize(const std::string& filename) {
+    // the payload is encoded into one buffer and written at once
+    std::string payload;
 
     // order
-    outfile.write(reinterpret_cast<const char*>(&order), sizeof(order));
+    encodeTo(payload, order);
 
     // is empty
     bool has_root = (root != nullptr);
-    outfile.write(reinterpret_cast<const char*>(&has_root), sizeof(has_root));
-    if (!has_root) {
-        outfile.close();
+    encodeTo(payload, has_root);
+    std::vector<Node<KeyT, ValT>*> all_nodes;
+    std::vector<size_t> parent_ids;
+    std::vector<size_t> offsets;
+    if (has_root) {
+        // level-order trav
+        std::map<Node<KeyT, ValT>*, size_t> node_id_map; // unique id for every node
+        std::queue<Node<KeyT, ValT>*> q;
+
+        q.push(root);
+        size_t id = 0;
+        node_id_map[root] = id++;
+        all_nodes.push_back(root);
+        parent_ids.push_back(size_t(-1));
+
+        // id
+        while (!q.empty()) {
+            Node<KeyT, ValT>* node = q.front();
+            q.pop();
+
+            if (!node->leaf) {
+                for (Node<KeyT, ValT>* child : node->ptr2node) {
+                    if (child && node_id_map.find(child) == node_id_map.end()) {
+                        parent_ids.push_back(node_id_map[node]);
+                        node_id_map[child] = id++;
+                        all_nodes.push_back(child);
+                        q.push(child);
+                    }
+                }
+            }
+        }
+
+        // node count
+        size_t total_nodes = all_nodes.size();
+        encodeTo(payload, total_nodes);
+
+        // node offsets, filled in as the nodes are encoded
+        size_t offsets_pos = payload.size();
+        payload.resize(offsets_pos + total_nodes * sizeof(size_t));
+        offsets.reserve(total_nodes);
+
+        // data
+        for (size_t i = 0; i < total_nodes; i++) {
+            Node<KeyT, ValT>* node = all_nodes[i];
+            offsets.push_back(payload.size());
+
+            // id, type, parent, next; the leaves come last, left to right
+            bool has_next = node->leaf && i + 1 < total_nodes && all_nodes[i + 1]->leaf;
+            encodeTo(payload, i);
+            encodeTo(payload, node->leaf);
+            encodeTo(payload, parent_ids[i]);
+            encodeTo(payload, has_next ? i + 1 : size_t(-1));
+
+            if (node->leaf && node->page != size_t(-1) && !pool->pages[node->page].resident) {
+                // a leaf not read yet is copied from the file as it is
+                typename LeafPool<KeyT, ValT>::Page& page = pool->pages[node->page];
+                pool->verify(page.begin, page.end);
+                payload.append(pool->payload + page.begin + BPTREE_NODE_HEADER_SIZE,
+                    page.end - page.begin - BPTREE_NODE_HEADER_SIZE);
+                continue;
+            }
+
+            // key count and keys
+            encodeTo(payload, node->key);
+
+            if (node->leaf) {
+                // v
+                size_t leaf_size = 0;
+                for (ValT* val_ptr : node->ptr2val) {
+                    leaf_size += Codec<ValT>::size(*val_ptr);
+                }
+                payload.reserve(payload.size() + leaf_size);
+                for (ValT* val_ptr : node->ptr2val) {
+                    encodeTo(payload, *val_ptr);
+                }
+            }
+            else {
+                // child id
+                std::vector<size_t> child_ids;
+                for (Node<KeyT, ValT>* child : node->ptr2node) {
+                    child_ids.push_back((child) ? node_id_map[child] : size_t(-1));
+                }
+                encodeTo(payload, child_ids);
+            }
+        }
+        memcpy(&payload[offsets_pos], offsets.data(), total_nodes * sizeof(size_t));
+    }
+
+    // header and block checksums
+    std::string header(BPTREE_MAGIC, 8);
+    encodeTo(header, uint32_t(BPTREE_VERSION));
+    encodeTo(header, Codec<KeyT>::tag());
+    encodeTo(header, Codec<ValT>::tag());
+    encodeTo(header, uint32_t(BPTREE_BLOCK_SIZE));
+    encodeTo(header, uint64_t(payload.size()));
+    encodeTo(header, crc32c(header.data(), header.size()));
+    for (size_t block = 0; block < payload.size(); block += BPTREE_BLOCK_SIZE) {
+        encodeTo(header, crc32c(payload.data() + block, std::min<size_t>(BPTREE_BLOCK_SIZE, payload.size() - block)));
+    }
+
+    if (!replaceFile(filename, header, payload)) {
+        throw std::runtime_error("Error writing " + filename + ": " + std::strerror(errno));
+    }
+
+    // a lazily loaded tree goes on with the file just written
+    if (pool) {
+        remapPool(filename, all_nodes, parent_ids, offsets, payload);
+    }
+}
+
+template<typename KeyT, typename ValT>
+void BPTree<KeyT, ValT>::clear() {
+    pool.reset();
+    for (std::pair<uint64_t, Node<KeyT, ValT>*>& node : retired) {
+        freeNode(node.second);
+    }
+    retired.clear();
+    if (!root) {
         return;
     }
 
-    // level-order trav
-    std::map<Node<KeyT, ValT>*, size_t> node_id_map; // unique id for every node
+    // trav remove
     std::queue<Node<KeyT, ValT>*> q;
-    std::vector<Node<KeyT, ValT>*> all_nodes;
-
     q.push(root);
-    size_t id = 0;
-    node_id_map[root] = id++;
-    all_nodes.push_back(root);
-
-    // id
     while (!q.empty()) {
         Node<KeyT, ValT>* node = q.front();
         q.pop();
-
         if (!node->leaf) {
             for (Node<KeyT, ValT>* child : node->ptr2node) {
-                if (child && node_id_map.find(child) == node_id_map.end()) {
-                    node_id_map[child] = id++;
-                    all_nodes.push_back(child);
-                    q.push(child);
-                }
+                if (child) q.push(child);
+            }
+        }
+        else {
+            // release
+            for (ValT* val_ptr : node->ptr2val) {
+                delete val_ptr;
             }
         }
+        delete node;
     }
+    root = nullptr;
+}
 
-    // node count
-    size_t total_nodes = all_nodes.size();
-    outfile.write(reinterpret_cast<const char*>(&total_nodes), sizeof(total_nodes));
+template<typename KeyT, typename ValT>
+Node<KeyT, ValT>* BPTree<KeyT, ValT>::decodeNode(const char*& position, const char* end, size_t& node_id,
+    size_t& parent_id, size_t& next_id, std::vector<size_t>& children_ids) {
+    node_id = decodeFrom<size_t>(position, end);
+    bool is_leaf = decodeFrom<bool>(position, end);
+    Node<KeyT, ValT>* node = new Node<KeyT, ValT>(is_leaf);
+    try {
+        // parent, next
+        parent_id = decodeFrom<size_t>(position, end);
+        next_id = decodeFrom<size_t>(position, end);
 
-    // data
-    for (Node<KeyT, ValT>* node : all_nodes) {
-        // id
-        size_t node_id = node_id_map[node];
-        outfile.write(reinterpret_cast<const char*>(&node_id), sizeof(node_id));
-
-        // type
-        outfile.write(reinterpret_cast<const char*>(&node->leaf), sizeof(node->leaf));
-
-        // parent
-        size_t parent_id = (node->parent) ? node_id_map[node->parent] : size_t(-1);
-        outfile.write(reinterpret_cast<const char*>(&parent_id), sizeof(parent_id));
-
-        // next
-        size_t next_id = (node->leaf && node->next) ? node_id_map[node->next] : size_t(-1);
-        outfile.write(reinterpret_cast<const char*>(&next_id), sizeof(next_id));
-
-        // keys
-        size_t key_count = node->key.size();
-        outfile.write(reinterpret_cast<const char*>(&key_count), sizeof(key_count));
-        for (const KeyT& key : node->key) {
-            // for wstring
-            if constexpr (std::is_same_v<KeyT, std::wstring>) {
-                size_t str_len = key.length();
-                outfile.write(reinterpret_cast<const char*>(&str_len), sizeof(str_len));
-                outfile.write(reinterpret_cast<const char*>(key.c_str()), str_len * sizeof(wchar_t));
-            }
-            else {
-                outfile.write(reinterpret_cast<const char*>(&key), sizeof(KeyT));
-            }
-        }
+        // k
+        node->key = decodeFrom<std::vector<KeyT>>(position, end);
 
-        if (node->leaf) {
+        if (is_leaf) {
             // v
-            for (size_t i = 0; i < key_count; i++) {
-                // for vec<int>
-                if constexpr (std::is_same_v<ValT, std::vector<int>>) {
-                    const auto& vec = *(node->ptr2val[i]);
-                    size_t vec_size = vec.size();
-                    outfile.write(reinterpret_cast<const char*>(&vec_size), sizeof(vec_size));
-                    for (int val : vec) {
-                        outfile.write(reinterpret_cast<const char*>(&val), sizeof(int));
-                    }
-                }
-                // for str
-                else if constexpr (std::is_same_v<ValT, std::string>) {
-                    const auto& str = *(node->ptr2val[i]);
-                    size_t str_len = str.length();
-                    outfile.write(reinterpret_cast<const char*>(&str_len), sizeof(str_len));
-                    outfile.write(str.c_str(), str_len);
-                }
-                else {
-                    outfile.write(reinterpret_cast<const char*>(node->ptr2val[i]), sizeof(ValT));
-                }
+            size_t key_count = node->key.size();
+            node->ptr2val.reserve(key_count);
+            for (size_t j = 0; j < key_count; j++) {
+                node->ptr2val.push_back(new ValT(decodeFrom<ValT>(position, end)));
             }
         }
         else {
-            // child id
-            size_t child_count = node->ptr2node.size();
-            outfile.write(reinterpret_cast<const char*>(&child_count), sizeof(child_count));
-            for (Node<KeyT, ValT>* child : node->ptr2node) {
-                size_t child_id = (child) ? node_id_map[child] : size_t(-1);
-                outfile.write(reinterpret_cast<const char*>(&child_id), sizeof(child_id));
+            // child
+            children_ids = decodeFrom<std::vector<size_t>>(position, end);
+            if (children_ids.size() != node->key.size() + 1) {
+                throw std::runtime_error("invalid child count");
             }
+            node->ptr2node.resize(children_ids.size(), nullptr);
         }
     }
-
-    outfile.close();
+    catch (...) {
+        for (ValT* val_ptr : node->ptr2val) {
+            delete val_ptr;
+        }
+        delete node;
+        throw;
+    }
+    return node;
 }
 
 template<typename KeyT, typename ValT>
 void BPTree<KeyT, ValT>::deserialize(const std::string& filename) {
-    std::ifstream infile(filename, std::ios::binary);
+    if (!snapshots.empty()) {
+        throw std::runtime_error("cannot load " + filename + " while snapshots are open");
+    }
+    std::ifstream infile(filename, std::ios::binary | std::ios::ate);
     if (!infile) {
         std::cerr << "Error opening file for reading!" << std::endl;
         return;
     }
 
-    // clean
-    if (root) {
-        // trav remove
-        std::queue<Node<KeyT, ValT>*> q;
-        q.push(root);
-        while (!q.empty()) {
-            Node<KeyT, ValT>* node = q.front();
-            q.pop();
-            if (!node->leaf) {
-                for (Node<KeyT, ValT>* child : node->ptr2node) {
-                    if (child) q.push(child);
-                }
-            }
-            else {
-                // release
+    // the whole file is read at once, checked and decoded from memory
+    std::string buffer(size_t(infile.tellg()), '\0');
+    infile.seekg(0);
+    infile.read(&buffer[0], buffer.size());
+    infile.close();
+    IndexFile file = indexFile<KeyT, ValT>(buffer.data(), buffer.size(), filename);
+    parallelFor(file.blockCount(), 8, [&](size_t first, size_t last) {
+        verifyIndexBlocks(file, first, last, filename);
+    });
+    const char* payload = file.payload;
+    const char* position = file.payload;
+    const char* end = file.end;
+
+    // the tree is only replaced once the whole file decoded
+    std::vector<Node<KeyT, ValT>*> nodes;
+    auto release = [&nodes]() {
+        for (Node<KeyT, ValT>* node : nodes) {
+            if (node) {
                 for (ValT* val_ptr : node->ptr2val) {
                     delete val_ptr;
                 }
+                delete node;
             }
-            delete node;
         }
-        root = nullptr;
-    }
-
-    // order
-    infile.read(reinterpret_cast<char*>(&order), sizeof(order));
+    };
+
+    int new_order;
+    Node<KeyT, ValT>* new_root = nullptr;
+    try {
+        // order
+        new_order = decodeFrom<int>(position, end);
+
+        // is empty
+        bool has_root = decodeFrom<bool>(position, end);
+        if (has_root) {
+            // count, bounded by the smallest node encoding
+            size_t total_nodes = decodeFrom<size_t>(position, end);
+            if (total_nodes == 0 || total_nodes > size_t(end - position) / (BPTREE_NODE_HEADER_SIZE + sizeof(size_t))) {
+                throw std::runtime_error("invalid node count");
+            }
 
-    // is empty
-    bool has_root;
-    infile.read(reinterpret_cast<char*>(&has_root), sizeof(has_root));
-    if (!has_root) {
-        infile.close();
-        return;
-    }
+            nodes.resize(total_nodes, nullptr);
+            std::vector<size_t> parent_ids(total_nodes);
+            std::vector<size_t> next_ids(total_nodes);
+            std::vector<std::vector<size_t>> children_ids(total_nodes);
+
+            // decodes a node record, which holds node expected_id unless
+            // that is -1
+            auto decode_node = [&](const char*& node_position, const char* node_end, size_t expected_id) {
+                size_t node_id, parent_id, next_id;
+                std::vector<size_t> child_ids;
+                Node<KeyT, ValT>* node = decodeNode(node_position, node_end, node_id, parent_id, next_id, child_ids);
+                if (node_id >= total_nodes || (expected_id != size_t(-1) && node_id != expected_id) || nodes[node_id]) {
+                    for (ValT* val_ptr : node->ptr2val) {
+                        delete val_ptr;
+                    }
+                    delete node;
+                    throw std::runtime_error("invalid node id");
+                }
+                nodes[node_id] = node;
+                parent_ids[node_id] = parent_id;
+                next_ids[node_id] = next_id;
+                children_ids[node_id] = std::move(child_ids);
+            };
+
+            // create nodes
+            if (file.version >= 3) {
+                // node i lies between offsets i and i + 1, so parts of the
+                // nodes are decoded by different threads
+                const char* offsets = encodedElements<size_t>(position, end, total_nodes);
+                auto node_bounds = [&](size_t i) {
+                    size_t begin, next = size_t(end - payload);
+                    memcpy(&begin, offsets + i * sizeof(size_t), sizeof(size_t));
+                    if (i + 1 < total_nodes) {
+                        memcpy(&next, offsets + (i + 1) * sizeof(size_t), sizeof(size_t));
+                    }
+                    if (begin < size_t(position - payload) || begin > next || next > size_t(end - payload)) {
+                        throw std::runtime_error("invalid node offset");
+                    }
+                    return std::make_pair(payload + begin, payload + next);
+                };
+                parallelFor(total_nodes, 1024, [&](size_t first, size_t last) {
+                    for (size_t i = first; i < last; i++) {
+                        auto [node_position, node_end] = node_bounds(i);
+                        decode_node(node_position, node_end, i);
+                        if (node_position != node_end) {
+                            throw std::runtime_error("invalid node length");
+                        }
+                    }
+                });
+            }
+            else {
+                for (size_t i = 0; i < total_nodes; i++) {
+                    decode_node(position, end, size_t(-1));
+                }
+            }
 
-    // count
-    size_t total_nodes;
-    infile.read(reinterpret_cast<char*>(&total_nodes), sizeof(total_nodes));
+            // link, every node but the root below the one parent it names
+            auto node_at = [&nodes](size_t node_id) {
+                if (node_id >= nodes.size()) {
+                    throw std::runtime_error("invalid node reference");
+                }
+                return nodes[node_id];
+            };
+            std::vector<bool> linked(nodes.size(), false);
+            size_t linked_count = 0;
+            for (size_t i = 0; i < nodes.size(); i++) {
+                // parent
+                if (parent_ids[i] == size_t(-1)) {
+                    if (new_root) {
+                        throw std::runtime_error("more than one root");
+                    }
+                    new_root = nodes[i];
+                }
 
-    std::vector<Node<KeyT, ValT>*> nodes(total_nodes, nullptr);
-    std::vector<size_t> parent_ids(total_nodes);
-    std::vector<size_t> next_ids(total_nodes);
-    std::vector<std::vector<size_t>> children_ids(total_nodes);
+                // next
+                if (nodes[i]->leaf && next_ids[i] != size_t(-1) && !node_at(next_ids[i])->leaf) {
+                    throw std::runtime_error("invalid next leaf of node " + std::to_string(i));
+                }
 
-    // create nodes
-    for (size_t i = 0; i < total_nodes; i++) {
-        size_t node_id;
-        infile.read(reinterpret_cast<char*>(&node_id), sizeof(node_id));
+                // child
+                for (size_t j = 0; j < children_ids[i].size(); j++) {
+                    size_t child_id = children_ids[i][j];
+                    Node<KeyT, ValT>* child = node_at(child_id);
+                    if (linked[child_id] || parent_ids[child_id] != i) {
+                        throw std::runtime_error("invalid node reference");
+                    }
+                    linked[child_id] = true;
+                    linked_count++;
+                    nodes[i]->ptr2node[j] = child;
+                }
+            }
+            if (!new_root) {
+                throw std::runtime_error("no root");
+            }
+            if (linked_count != nodes.size() - 1) {
+                throw std::runtime_error("unlinked nodes");
+            }
 
-        bool is_leaf;
-        infile.read(reinterpret_cast<char*>(&is_leaf), sizeof(is_leaf));
+            // with one parent each, a node out of reach of the root is on a cycle
+            std::vector<Node<KeyT, ValT>*> reached = { new_root };
+            for (size_t i = 0; i < reached.size(); i++) {
+                reached.insert(reached.end(), reached[i]->ptr2node.begin(), reached[i]->ptr2node.end());
+            }
+            if (reached.size() != nodes.size()) {
+                throw std::runtime_error("node cycle");
+            }
+        }
+    }
+    catch (const std::runtime_error& e) {
+        release();
+        throw corruptIndexFile(filename, e.what());
+    }
+    catch (...) {
+        release();
+        throw;
+    }
 
-        nodes[node_id] = new Node<KeyT, ValT>(is_leaf);
+    clear();
+    order = new_order;
+    root = new_root;
+}
 
-        // parent
-        size_t parent_id;
-        infile.read(reinterpret_cast<char*>(&parent_id), sizeof(parent_id));
-        parent_ids[node_id] = parent_id;
+template<typename KeyT, typename ValT>
+void BPTree<KeyT, ValT>::deserializeLazy(const std::string& filename, size_t budget) {
+    if (!snapshots.empty()) {
+        throw std::runtime_error("cannot load " + filename + " while snapshots are open");
+    }
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        std::cerr << "Error opening file for reading!" << std::endl;
+        return;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        close(fd);
+        deserialize(filename);
+        return;
+    }
 
-        // next
-        size_t next_id;
-        infile.read(reinterpret_cast<char*>(&next_id), sizeof(next_id));
-        next_ids[node_id] = next_id;
+    std::unique_ptr<LeafPool<KeyT, ValT>> new_pool(new LeafPool<KeyT, ValT>());
+    new_pool->filename = filename;
+    new_pool->budget = budget;
+    void* data = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        throw std::runtime_error("cannot map " + filename);
+    }
+    new_pool->data = static_cast<const char*>(data);
+    new_pool->data_size = st.st_size;
 
-        // k
-        size_t key_count;
-        infile.read(reinterpret_cast<char*>(&key_count), sizeof(key_count));
-        nodes[node_id]->key.resize(key_count);
-        for (size_t j = 0; j < key_count; j++) {
-            // for wstring
-            if constexpr (std::is_same_v<KeyT, std::wstring>) {
-                size_t str_len;
-                infile.read(reinterpret_cast<char*>(&str_len), sizeof(str_len));
-                wchar_t* buffer = new wchar_t[str_len + 1];
-                infile.read(reinterpret_cast<char*>(buffer), str_len * sizeof(wchar_t));
-                buffer[str_len] = L'\0';
-                nodes[node_id]->key[j] = std::wstring(buffer);
-                delete[] buffer;
+    IndexFile file = indexFile<KeyT, ValT>(new_pool->data, new_pool->data_size, filename);
+    if (file.version < 3) {
+        // without node offsets the leaves cannot be found on their own
+        deserialize(filename);
+        return;
+    }
+    new_pool->payload = file.payload;
+    new_pool->payload_size = file.end - file.payload;
+    new_pool->block_crcs = file.block_crcs;
+    new_pool->block_size = file.block_size;
+    new_pool->verified.assign(file.blockCount(), false);
+
+    const char* payload = file.payload;
+    const char* position = file.payload;
+    const char* end = file.end;
+
+    // only the inner nodes, which come before the leaves, are decoded
+    std::vector<Node<KeyT, ValT>*> nodes;
+    auto release = [&nodes]() {
+        for (Node<KeyT, ValT>* node : nodes) {
+            delete node;
+        }
+    };
+
+    int new_order;
+    Node<KeyT, ValT>* new_root = nullptr;
+    try {
+        new_order = decodeFrom<int>(position, end);
+        bool has_root = decodeFrom<bool>(position, end);
+        if (has_root) {
+            size_t total_nodes = decodeFrom<size_t>(position, end);
+            if (total_nodes == 0 || total_nodes > size_t(end - position) / (BPTREE_NODE_HEADER_SIZE + sizeof(size_t))) {
+                throw std::runtime_error("invalid node count");
             }
-            else {
-                infile.read(reinterpret_cast<char*>(&nodes[node_id]->key[j]), sizeof(KeyT));
+            std::vector<size_t> offsets(total_nodes);
+            memcpy(offsets.data(), encodedElements<size_t>(position, end, total_nodes), total_nodes * sizeof(size_t));
+            for (size_t i = 0; i < total_nodes; i++) {
+                size_t next = (i + 1 < total_nodes) ? offsets[i + 1] : size_t(end - payload);
+                if (offsets[i] < size_t(position - payload) || offsets[i] + BPTREE_NODE_HEADER_SIZE > next || next > size_t(end - payload)) {
+                    throw std::runtime_error("invalid node offset");
+                }
             }
-        }
 
-        if (is_leaf) {
-            // v
-            nodes[node_id]->ptr2val.resize(key_count);
-            for (size_t j = 0; j < key_count; j++) {
-                // for vec<int>
-                if constexpr (std::is_same_v<ValT, std::vector<int>>) {
-                    size_t vec_size;
-                    infile.read(reinterpret_cast<char*>(&vec_size), sizeof(vec_size));
-                    std::vector<int>* vec_ptr = new std::vector<int>(vec_size);
-                    for (size_t k = 0; k < vec_size; k++) {
-                        int val;
-                        infile.read(reinterpret_cast<char*>(&val), sizeof(int));
-                        (*vec_ptr)[k] = val;
+            // inner nodes up to the first leaf
+            nodes.resize(total_nodes, nullptr);
+            std::vector<size_t> parent_ids;
+            std::vector<std::vector<size_t>> children_ids;
+            size_t first_leaf = 0;
+            while (first_leaf < total_nodes && !payload[offsets[first_leaf] + sizeof(size_t)]) {
+                const char* node_position = payload + offsets[first_leaf];
+                size_t node_id, parent_id, next_id;
+                std::vector<size_t> child_ids;
+                nodes[first_leaf] = decodeNode(node_position, end, node_id, parent_id, next_id, child_ids);
+                if (node_id != first_leaf || node_position - payload != ptrdiff_t(first_leaf + 1 < total_nodes ? offsets[first_leaf + 1] : end - payload)) {
+                    throw std::runtime_error("invalid inner node " + std::to_string(first_leaf));
+                }
+                // children come after their parent
+                for (size_t child_id : child_ids) {
+                    if (child_id <= first_leaf || child_id >= total_nodes) {
+                        throw std::runtime_error("invalid node reference");
                     }
-                    nodes[node_id]->ptr2val[j] = vec_ptr;
                 }
-                // for str
-                else if constexpr (std::is_same_v<ValT, std::string>) {
-                    size_t str_len;
-                    infile.read(reinterpret_cast<char*>(&str_len), sizeof(str_len));
-                    char* buffer = new char[str_len + 1];
-                    infile.read(buffer, str_len);
-                    buffer[str_len] = '\0';
-                    std::string* str_ptr = new std::string(buffer);
-                    nodes[node_id]->ptr2val[j] = str_ptr;
-                    delete[] buffer;
+                parent_ids.push_back(parent_id);
+                children_ids.push_back(std::move(child_ids));
+                first_leaf++;
+            }
+            if (first_leaf == total_nodes || (first_leaf == 0 && total_nodes != 1)) {
+                throw std::runtime_error("invalid leaf count");
+            }
+
+            // what was read so far is checked before anything is linked
+            new_pool->verify(0, offsets[first_leaf]);
+
+            // a placeholder for every leaf, filled when it is reached
+            for (size_t i = first_leaf; i < total_nodes; i++) {
+                nodes[i] = new Node<KeyT, ValT>(LEAF);
+                nodes[i]->page = i - first_leaf;
+                new_pool->pages.push_back({ nodes[i], i, size_t(-1), offsets[i],
+                    (i + 1 < total_nodes) ? offsets[i + 1] : size_t(end - payload), false, false, {} });
+            }
+
+            // link, the root first and every other node below one parent
+            for (size_t i = 0; i < first_leaf; i++) {
+                if ((i == 0) != (parent_ids[i] == size_t(-1)) || (i > 0 && parent_ids[i] >= i)) {
+                    throw std::runtime_error("invalid parent of node " + std::to_string(i));
                 }
-                else {
-                    ValT* val_ptr = new ValT();
-                    infile.read(reinterpret_cast<char*>(val_ptr), sizeof(ValT));
-                    nodes[node_id]->ptr2val[j] = val_ptr;
+            }
+            std::vector<bool> linked(total_nodes, false);
+            size_t linked_count = 0;
+            for (size_t i = 0; i < first_leaf; i++) {
+                for (size_t j = 0; j < children_ids[i].size(); j++) {
+                    size_t child_id = children_ids[i][j];
+                    if (linked[child_id] || (child_id < first_leaf && parent_ids[child_id] != i)) {
+                        throw std::runtime_error("invalid node reference");
+                    }
+                    linked[child_id] = true;
+                    linked_count++;
+                    nodes[i]->ptr2node[j] = nodes[child_id];
+                    if (child_id >= first_leaf) {
+                        new_pool->pages[child_id - first_leaf].parent_id = i;
+                    }
                 }
             }
-        }
-        else {
-            // child
-            size_t child_count;
-            infile.read(reinterpret_cast<char*>(&child_count), sizeof(child_count));
-            children_ids[node_id].resize(child_count);
-            for (size_t j = 0; j < child_count; j++) {
-                size_t child_id;
-                infile.read(reinterpret_cast<char*>(&child_id), sizeof(child_id));
-                children_ids[node_id][j] = child_id;
+            if (linked_count != total_nodes - 1) {
+                throw std::runtime_error("unlinked nodes");
             }
-            nodes[node_id]->ptr2node.resize(child_count, nullptr);
+            new_root = nodes[0];
         }
     }
+    catch (const std::runtime_error& e) {
+        release();
+        throw corruptIndexFile(filename, e.what());
+    }
+    catch (...) {
+        release();
+        throw;
+    }
 
-    // link
-    for (size_t i = 0; i < total_nodes; i++) {
-        // parent
-        if (parent_ids[i] != size_t(-1)) {
-            nodes[i]->parent = nodes[parent_ids[i]];
-        }
-        else {
-            root = nodes[i]; // root
-        }
+    clear();
+    order = new_order;
+    root = new_root;
+    pool = std::move(new_pool);
+}
 
-        // next
-        if (nodes[i]->leaf && next_ids[i] != size_t(-1)) {
-            nodes[i]->next = nodes[next_ids[i]];
+template<typename KeyT, typename ValT>
+inline void BPTree<KeyT, ValT>::fetch(Node<KeyT, ValT>* _leaf) {
+    if (_leaf->page == size_t(-1)) {
+        return;
+    }
+    typename LeafPool<KeyT, ValT>::Page& page = pool->pages[_leaf->page];
+    if (page.dirty) {
+        pool->hits++;
+        return;
+    }
+    if (page.resident) {
+        pool->hits++;
+        pool->lru.splice(pool->lru.begin(), pool->lru, page.lru_pos);
+        return;
+    }
+
+    pool->misses++;
+    loadPage(_leaf->page);
+    pool->lru.push_front(_leaf->page);
+    page.lru_pos = pool->lru.begin();
+    pool->bytes += page.end - page.begin;
+
+    // the leaf just read stays
+    while (pool->bytes > pool->budget && pool->lru.size() > 1) {
+        evictPage(pool->lru.back());
+    }
+}
+
+// a fetched leaf is about to change, it stays until the tree is written
+template<typename KeyT, typename ValT>
+inline void BPTree<KeyT, ValT>::changed(Node<KeyT, ValT>* _leaf) {
+    if (_leaf->page == size_t(-1)) {
+        return;
+    }
+    typename LeafPool<KeyT, ValT>::Page& page = pool->pages[_leaf->page];
+    if (!page.dirty) {
+        page.dirty = true;
+        pool->lru.erase(page.lru_pos);
+        pool->bytes -= page.end - page.begin;
+    }
+}
+
+template<typename KeyT, typename ValT>
+void BPTree<KeyT, ValT>::loadPage(size_t _page) {
+    typename LeafPool<KeyT, ValT>::Page& page = pool->pages[_page];
+    pool->verify(page.begin, page.end);
+
+    const char* position = pool->payload + page.begin;
+    const char* end = pool->payload + page.end;
+    size_t node_id, parent_id, next_id;
+    std::vector<size_t> children_ids;
+    Node<KeyT, ValT>* node;
+    try {
+        node = decodeNode(position, end, node_id, parent_id, next_id, children_ids);
+    }
+    catch (const std::runtime_error& e) {
+        throw corruptIndexFile(pool->filename, e.what());
+    }
+    size_t expected_next = (_page + 1 < pool->pages.size()) ? page.node_id + 1 : size_t(-1);
+    if (!node->leaf || node_id != page.node_id || parent_id != page.parent_id
+        || next_id != expected_next || position != end) {
+        for (ValT* val_ptr : node->ptr2val) {
+            delete val_ptr;
         }
+        delete node;
+        throw corruptIndexFile(pool->filename, "invalid leaf " + std::to_string(page.node_id));
+    }
 
-        // child
-        if (!nodes[i]->leaf) {
-            for (size_t j = 0; j < children_ids[i].size(); j++) {
-                if (children_ids[i][j] != size_t(-1)) {
-                    nodes[i]->ptr2node[j] = nodes[children_ids[i][j]];
-                }
+    page.node->key.swap(node->key);
+    page.node->ptr2val.swap(node->ptr2val);
+    page.resident = true;
+    delete node;
+}
+
+template<typename KeyT, typename ValT>
+void BPTree<KeyT, ValT>::evictPage(size_t _page) {
+    typename LeafPool<KeyT, ValT>::Page& page = pool->pages[_page];
+    for (ValT* val_ptr : page.node->ptr2val) {
+        delete val_ptr;
+    }
+    std::vector<KeyT>().swap(page.node->key);
+    std::vector<ValT*>().swap(page.node->ptr2val);
+    page.resident = false;
+    pool->lru.erase(page.lru_pos);
+    pool->bytes -= page.end - page.begin;
+}
+
+// the fetched leaf leaves the pool and stays in memory as it is
+template<typename KeyT, typename ValT>
+void BPTree<KeyT, ValT>::detachPage(Node<KeyT, ValT>* _leaf) {
+    if (_leaf->page == size_t(-1)) {
+        return;
+    }
+    typename LeafPool<KeyT, ValT>::Page& page = pool->pages[_leaf->page];
+    if (!page.dirty) {
+        pool->lru.erase(page.lru_pos);
+        pool->bytes -= page.end - page.begin;
+    }
+    page.node = nullptr;
+    page.resident = false;
+    page.dirty = false;
+    _leaf->page = size_t(-1);
+}
+
+// points the pool at the file the tree was just written to, whose
+// payload was payload with node i of all_nodes at offsets[i]
+template<typename KeyT, typename ValT>
+void BPTree<KeyT, ValT>::remapPool(const std::string& filename, const std::vector<Node<KeyT, ValT>*>& all_nodes,
+    const std::vector<size_t>& parent_ids, const std::vector<size_t>& offsets, const std::string& payload) {
+    int fd = open(filename.c_str(), O_RDONLY);
+    struct stat st;
+    void* data = MAP_FAILED;
+    if (fd >= 0 && fstat(fd, &st) == 0 && st.st_size > 0) {
+        data = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    }
+    if (fd >= 0) {
+        close(fd);
+    }
+    if (data == MAP_FAILED) {
+        // leaves not read yet cannot be found any more, read them now
+        std::cerr << "Error mapping " << filename << ", loading all leaves" << std::endl;
+        for (typename LeafPool<KeyT, ValT>::Page& page : pool->pages) {
+            if (page.node) {
+                fetch(page.node);
+                changed(page.node);
+            }
+        }
+        for (typename LeafPool<KeyT, ValT>::Page& page : pool->pages) {
+            if (page.node) {
+                page.node->page = size_t(-1);
             }
         }
+        pool->pages.clear();
+        return;
     }
 
-    infile.close();
+    std::unique_ptr<LeafPool<KeyT, ValT>> new_pool(new LeafPool<KeyT, ValT>());
+    new_pool->filename = filename;
+    new_pool->budget = pool->budget;
+    new_pool->hits = pool->hits;
+    new_pool->misses = pool->misses;
+    new_pool->data = static_cast<const char*>(data);
+    new_pool->data_size = st.st_size;
+    new_pool->payload_size = payload.size();
+    new_pool->payload = new_pool->data + (new_pool->data_size - payload.size());
+    new_pool->block_size = BPTREE_BLOCK_SIZE;
+    new_pool->block_crcs = new_pool->payload - (payload.size() + BPTREE_BLOCK_SIZE - 1) / BPTREE_BLOCK_SIZE * sizeof(uint32_t);
+    // the checksums were just computed from payload
+    new_pool->verified.assign((payload.size() + BPTREE_BLOCK_SIZE - 1) / BPTREE_BLOCK_SIZE, true);
+
+    // every leaf becomes a page, the ones in memory clean
+    for (size_t i = 0; i < all_nodes.size(); i++) {
+        Node<KeyT, ValT>* node = all_nodes[i];
+        if (!node->leaf) {
+            continue;
+        }
+        bool resident = (node->page == size_t(-1)) || pool->pages[node->page].resident;
+        node->page = new_pool->pages.size();
+        new_pool->pages.push_back({ node, i, parent_ids[i], offsets[i],
+            (i + 1 < all_nodes.size()) ? offsets[i + 1] : payload.size(), resident, false, {} });
+        if (resident) {
+            new_pool->lru.push_front(node->page);
+            new_pool->pages.back().lru_pos = new_pool->lru.begin();
+            new_pool->bytes += new_pool->pages.back().end - new_pool->pages.back().begin;
+        }
+    }
+    pool = std::move(new_pool);
+
+    while (pool->bytes > pool->budget && !pool->lru.empty()) {
+        evictPage(pool->lru.back());
+    }
+}
+
+template<typename KeyT, typename ValT>
+CacheStats BPTree<KeyT, ValT>::leafPoolStats() const {
+    if (!pool) {
+        return { 0, 0, 0, 0 };
+    }
+    size_t resident = 0;
+    for (const typename LeafPool<KeyT, ValT>::Page& page : pool->pages) {
+        resident += page.resident;
+    }
+    return { pool->hits, pool->misses, resident, pool->bytes };
 }
 
 #endif // BPTREE_H
\ No newline at end of file
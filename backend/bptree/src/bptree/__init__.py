@@ -1,4 +1,10 @@
-from bptree._bptree import BPTreeIntStr, BPTreeIntVecInt, BPTreeWStrInt, BPTreeWStrVecInt
+from bptree._bptree import BPTreeIntStr, BPTreeIntVecInt, BPTreeWStrInt, BPTreeWStrVecInt, RecordStore, ColumnStore, CacheStats
+from bptree._bptree import BPTreeKeywordYearVecInt
+from bptree._bptree import DblpParser, DBLP_FIELDS, parse_dblp, parse_dblp_file, extract_keywords
+from bptree._bptree import BulkImportStats, bulk_import
+from bptree._bptree import ScoredId, search_bm25
 
 __all__ = [BPTreeIntStr, BPTreeIntVecInt,
-           BPTreeWStrInt, BPTreeWStrVecInt]
+           BPTreeWStrInt, BPTreeWStrVecInt, BPTreeKeywordYearVecInt, RecordStore, ColumnStore, CacheStats,
+           DblpParser, DBLP_FIELDS, parse_dblp, parse_dblp_file, extract_keywords,
+           BulkImportStats, bulk_import, ScoredId, search_bm25]
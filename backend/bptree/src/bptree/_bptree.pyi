@@ -1,7 +1,15 @@
-from typing import TypeVar, List, Optional
+from typing import TypeVar, List, Optional, Union, Dict, Tuple
 
 KeyT = TypeVar('KeyT', int, str)
 ValT = TypeVar('ValT', int, str, List[int])
+Field = Union[None, int, str, List[str]]
+
+
+class BPTreeIntStrSnapshot:
+    def find(self, _key: int) -> Optional[str]: ...
+    def keys(self) -> List[int]: ...
+    def values(self) -> List[str]: ...
+    def release(self) -> None: ...
 
 
 class BPTreeIntStr:
@@ -10,9 +18,20 @@ class BPTreeIntStr:
     def update(self, _key: int, _new_val: str) -> bool: ...
     def find(self, _key: int) -> Optional[str]: ...
     def deserialize(self, filename: str) -> None: ...
+    def deserialize_lazy(self, filename: str, budget: int) -> None: ...
     def serialize(self, filename: str) -> None: ...
     def keys(self) -> List[int]: ...
     def values(self) -> List[str]: ...
+    def leaf_pool_stats(self) -> CacheStats: ...
+    def snapshot(self) -> BPTreeIntStrSnapshot: ...
+
+
+class BPTreeIntVecIntSnapshot:
+    def find(self, _key: int) -> Optional[List[int]]: ...
+    def count(self, _key: int) -> int: ...
+    def keys(self) -> List[int]: ...
+    def values(self) -> List[List[int]]: ...
+    def release(self) -> None: ...
 
 
 class BPTreeIntVecInt:
@@ -20,10 +39,23 @@ class BPTreeIntVecInt:
     def insert(self, _key: int, _val: List[int]) -> None: ...
     def update(self, _key: int, _new_val: List[int]) -> bool: ...
     def find(self, _key: int) -> Optional[List[int]]: ...
+    def count(self, _key: int) -> int: ...
+    def range(self, _lo: int, _hi: int) -> List[Tuple[int, List[int]]]: ...
+    def append(self, _key: int, _elem: int) -> bool: ...
     def deserialize(self, filename: str) -> None: ...
+    def deserialize_lazy(self, filename: str, budget: int) -> None: ...
     def serialize(self, filename: str) -> None: ...
     def keys(self) -> List[int]: ...
     def values(self) -> List[List[int]]: ...
+    def leaf_pool_stats(self) -> CacheStats: ...
+    def snapshot(self) -> BPTreeIntVecIntSnapshot: ...
+
+
+class BPTreeWStrIntSnapshot:
+    def find(self, _key: str) -> Optional[int]: ...
+    def keys(self) -> List[str]: ...
+    def values(self) -> List[int]: ...
+    def release(self) -> None: ...
 
 
 class BPTreeWStrInt:
@@ -32,9 +64,20 @@ class BPTreeWStrInt:
     def update(self, _key: str, _new_val: int) -> bool: ...
     def find(self, _key: str) -> Optional[int]: ...
     def deserialize(self, filename: str) -> None: ...
+    def deserialize_lazy(self, filename: str, budget: int) -> None: ...
     def serialize(self, filename: str) -> None: ...
     def keys(self) -> List[str]: ...
     def values(self) -> List[int]: ...
+    def leaf_pool_stats(self) -> CacheStats: ...
+    def snapshot(self) -> BPTreeWStrIntSnapshot: ...
+
+
+class BPTreeWStrVecIntSnapshot:
+    def find(self, _key: str) -> Optional[List[int]]: ...
+    def count(self, _key: str) -> int: ...
+    def keys(self) -> List[str]: ...
+    def values(self) -> List[List[int]]: ...
+    def release(self) -> None: ...
 
 
 class BPTreeWStrVecInt:
@@ -42,7 +85,140 @@ class BPTreeWStrVecInt:
     def insert(self, _key: str, _val: List[int]) -> None: ...
     def update(self, _key: str, _new_val: List[int]) -> bool: ...
     def find(self, _key: str) -> Optional[List[int]]: ...
+    def count(self, _key: str) -> int: ...
+    def append(self, _key: str, _elem: int) -> bool: ...
     def deserialize(self, filename: str) -> None: ...
+    def deserialize_lazy(self, filename: str, budget: int) -> None: ...
     def serialize(self, filename: str) -> None: ...
     def keys(self) -> List[str]: ...
     def values(self) -> List[List[int]]: ...
+    def leaf_pool_stats(self) -> CacheStats: ...
+    def snapshot(self) -> BPTreeWStrVecIntSnapshot: ...
+
+
+class BPTreeKeywordYearVecIntSnapshot:
+    def find(self, _key: Tuple[int, int]) -> Optional[List[int]]: ...
+    def count(self, _key: Tuple[int, int]) -> int: ...
+    def range(self, _lo: Tuple[int, int], _hi: Tuple[int, int]) -> List[Tuple[Tuple[int, int], List[int]]]: ...
+    def keys(self) -> List[Tuple[int, int]]: ...
+    def values(self) -> List[List[int]]: ...
+    def release(self) -> None: ...
+
+
+class BPTreeKeywordYearVecInt:
+    def __init__(self, order: int) -> None: ...
+    def insert(self, _key: Tuple[int, int], _val: List[int]) -> None: ...
+    def update(self, _key: Tuple[int, int], _new_val: List[int]) -> bool: ...
+    def find(self, _key: Tuple[int, int]) -> Optional[List[int]]: ...
+    def count(self, _key: Tuple[int, int]) -> int: ...
+    def range(self, _lo: Tuple[int, int], _hi: Tuple[int, int]) -> List[Tuple[Tuple[int, int], List[int]]]: ...
+    def append(self, _key: Tuple[int, int], _elem: int) -> bool: ...
+    def deserialize(self, filename: str) -> None: ...
+    def deserialize_lazy(self, filename: str, budget: int) -> None: ...
+    def serialize(self, filename: str) -> None: ...
+    def keys(self) -> List[Tuple[int, int]]: ...
+    def values(self) -> List[List[int]]: ...
+    def leaf_pool_stats(self) -> CacheStats: ...
+    def snapshot(self) -> BPTreeKeywordYearVecIntSnapshot: ...
+
+
+class CacheStats:
+    hits: int
+    misses: int
+    entries: int
+    bytes: int
+    @property
+    def hit_rate(self) -> float: ...
+
+
+class RecordStore:
+    def __init__(self, directory: str, max_segment_size: int = 256 * 1024 * 1024,
+                 cache_size: int = 64 * 1024 * 1024) -> None: ...
+    def put(self, id: int, record: List[Field]) -> None: ...
+    def get(self, id: int) -> Optional[List[Field]]: ...
+    def get_many(self, ids: List[int]) -> List[Optional[List[Field]]]: ...
+    def contains(self, id: int) -> bool: ...
+    def __len__(self) -> int: ...
+    def ids(self) -> List[int]: ...
+    def flush(self) -> None: ...
+    def cache_stats(self) -> CacheStats: ...
+
+
+DBLP_FIELDS: List[str]
+
+
+class DblpParser:
+    def __iter__(self) -> "DblpParser": ...
+    def __next__(self) -> List[List[Field]]: ...
+    @property
+    def bytes_read(self) -> int: ...
+    @property
+    def entries(self) -> int: ...
+    @property
+    def seconds(self) -> float: ...
+    @property
+    def mb_per_second(self) -> float: ...
+
+
+def parse_dblp(data: bytes, batch_size: int = 1000) -> DblpParser: ...
+def parse_dblp_file(path: str, batch_size: int = 1000) -> DblpParser: ...
+
+
+def extract_keywords(titles: List[str]) -> List[List[str]]: ...
+
+
+class YearlyKeywordCounts:
+    articles: int
+    keyword_ids: List[int]
+    counts: List[int]
+
+
+class ColumnStore:
+    def __init__(self, directory: str) -> None: ...
+    def put(self, article_id: int, year: int, authors: List[str], keywords: List[str]) -> None: ...
+    def contains(self, article_id: int) -> bool: ...
+    def __len__(self) -> int: ...
+    def average_keyword_count(self) -> float: ...
+    def year(self, article_id: int) -> int: ...
+    def author_dict_size(self) -> int: ...
+    def keyword_dict_size(self) -> int: ...
+    def author_ids(self, article_id: int) -> List[int]: ...
+    def keyword_ids(self, article_id: int) -> List[int]: ...
+    def find_author(self, name: str) -> int: ...
+    def author_names(self, ids: List[int]) -> List[str]: ...
+    def find_keyword(self, keyword: str) -> int: ...
+    def keyword_names(self, ids: List[int]) -> List[str]: ...
+    def coauthors(self, author_id: int) -> List[Tuple[int, int]]: ...
+    def top_coauthors(self, author_id: int, k: int) -> List[Tuple[int, int]]: ...
+    def find_authors_fuzzy(self, name: str, max_distance: int, limit: int,
+                           num_authors: int = ...) -> List[Tuple[int, int]]: ...
+    def top_authors(self, k: int) -> List[Tuple[int, int]]: ...
+    def author_articles(self, author_id: int) -> List[int]: ...
+    def shared_articles(self, author_id: int, other_id: int) -> List[int]: ...
+    def intern_keywords(self, titles: List[str]) -> List[List[int]]: ...
+    def yearly_keyword_counts(self, excluded_keyword_ids: List[int] = [], limit: int = 0,
+                              threads: int = 0, max_article_id: int = ...) -> Dict[int, YearlyKeywordCounts]: ...
+    def flush(self) -> None: ...
+
+
+class BulkImportStats:
+    articles: int
+    bytes: int
+    seconds: float
+
+
+def bulk_import(paths: List[str], record_fields: List[str], records: RecordStore, columns: ColumnStore,
+                author_index: BPTreeIntVecInt, title_index: BPTreeWStrInt,
+                keyword_index: BPTreeIntVecInt, date_index: BPTreeIntVecInt,
+                keyword_year_index: BPTreeKeywordYearVecInt,
+                first_id: int = 1, threads: int = 0) -> BulkImportStats: ...
+
+
+class ScoredId:
+    id: int
+    score: float
+
+
+def search_bm25(keyword_index: Union[BPTreeIntVecInt, BPTreeIntVecIntSnapshot], columns: ColumnStore,
+                keyword_ids: List[int], k: int, k1: float = 1.2, b: float = 0.75,
+                num_articles: int = 0, average_keywords: float = 0) -> List[ScoredId]: ...
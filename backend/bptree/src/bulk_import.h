@@ -0,0 +1,426 @@
+/*
+    Copyright (C) 2025 Yuesong Feng
+    Copyright (C) 2025 ParaN3xus
+*/
+
+#ifndef BULK_IMPORT_H
+#define BULK_IMPORT_H
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <exception>
+#include <stdexcept>
+#include <algorithm>
+#include <functional>
+#include <condition_variable>
+#include <unordered_map>
+#include <queue>
+#include <map>
+
+#include "bptree.h"
+#include "composite_key.h"
+#include "record_store.h"
+#include "column_store.h"
+#include "dblp_parser.h"
+#include "tokenizer.h"
+
+struct BulkImportStats {
+    size_t articles;
+    uint64_t bytes;
+    double seconds;
+};
+
+// key -> ids, sorted by key
+template<typename KeyT>
+using SortedRun = std::vector<std::pair<KeyT, std::vector<int>>>;
+
+// The entries of one file with ids counted from 0 within the file, and
+// for every index the sorted run of the file. Authors and keywords are
+// only grouped by name, their runs are keyed by the ids the names get
+// once the file is committed.
+struct ParsedFile {
+    std::vector<Record> entries;    // records of DBLP_FIELDS
+    std::vector<std::vector<std::string>> keywords;
+    std::unordered_map<std::string, std::vector<int>> authorGroups;
+    std::unordered_map<std::string, std::vector<int>> keywordGroups;
+    SortedRun<std::wstring> titleRun;
+    SortedRun<int> yearRun;
+    uint64_t bytes;
+};
+
+inline std::wstring toWide(const std::string& utf8) {
+    std::u32string text = tokenizer::decodeUtf8(utf8);
+    return std::wstring(text.begin(), text.end());
+}
+
+inline size_t dblpField(const std::string& name) {
+    return std::find(DBLP_FIELDS.begin(), DBLP_FIELDS.end(), name) - DBLP_FIELDS.begin();
+}
+
+template<typename KeyT>
+SortedRun<KeyT> sortedRun(std::unordered_map<KeyT, std::vector<int>>& groups) {
+    SortedRun<KeyT> run;
+    run.reserve(groups.size());
+    for (auto& group : groups) {
+        run.emplace_back(group.first, std::move(group.second));
+    }
+    groups.clear();
+    std::sort(run.begin(), run.end(),
+        [](const std::pair<KeyT, std::vector<int>>& a, const std::pair<KeyT, std::vector<int>>& b) {
+            return a.first < b.first;
+        });
+    return run;
+}
+
+// names grouped by their ids in dict, which has all of them
+inline SortedRun<int> internedRun(std::unordered_map<std::string, std::vector<int>>& groups,
+    const StringDict& dict) {
+    std::unordered_map<int, std::vector<int>> ids;
+    for (auto& group : groups) {
+        ids.emplace(dict.find(group.first), std::move(group.second));
+    }
+    groups.clear();
+    return sortedRun(ids);
+}
+
+// the title an entry is stored with
+inline std::string entryTitle(const Record& entry) {
+    const std::string* title = std::get_if<std::string>(&entry[dblpField("title")]);
+    return title ? *title : "Untitled";
+}
+
+inline std::unique_ptr<ParsedFile> parseFile(const std::string& path) {
+    auto input = std::make_unique<std::ifstream>(path, std::ios::binary);
+    if (!*input) {
+        throw std::runtime_error("cannot open " + path);
+    }
+    DblpParser parser(std::move(input), 1000);
+
+    static const size_t YEAR = dblpField("year");
+    static const size_t AUTHORS = dblpField("authors");
+
+    auto file = std::make_unique<ParsedFile>();
+    std::unordered_map<std::wstring, std::vector<int>> titles;
+    std::unordered_map<int, std::vector<int>> years;
+    // an entry may list a name or keyword twice, its id goes in once
+    auto add = [](std::vector<int>& ids, int id) {
+        if (ids.empty() || ids.back() != id) {
+            ids.push_back(id);
+        }
+    };
+
+    std::vector<Record> batch;
+    while (parser.nextBatch(batch)) {
+        for (Record& entry : batch) {
+            int id = file->entries.size();
+            std::string title = entryTitle(entry);
+
+            std::vector<std::string> entryKeywords;
+            if (title != "Untitled") {
+                entryKeywords = extractKeywords(title);
+            }
+
+            if (auto* names = std::get_if<std::vector<std::string>>(&entry[AUTHORS])) {
+                for (const std::string& name : *names) {
+                    add(file->authorGroups[name], id);
+                }
+            }
+            for (const std::string& keyword : entryKeywords) {
+                add(file->keywordGroups[keyword], id);
+            }
+            add(titles[toWide(title)], id);
+            add(years[int(std::get<long long>(entry[YEAR]))], id);
+
+            file->entries.push_back(std::move(entry));
+            file->keywords.push_back(std::move(entryKeywords));
+        }
+    }
+
+    file->titleRun = sortedRun(titles);
+    file->yearRun = sortedRun(years);
+    file->bytes = parser.bytesRead();
+    return file;
+}
+
+// k-way merge of the runs of all files into keys and id lists, the ids of
+// run i offset by bases[i]. Equal keys come out of the earlier file first,
+// so every list stays in increasing order. The runs are consumed.
+template<typename KeyT>
+void mergeRuns(std::vector<SortedRun<KeyT>>& runs, const std::vector<int>& bases,
+    std::vector<KeyT>& keys, std::vector<std::vector<int>>& values) {
+    typedef std::pair<size_t, size_t> Cursor;   // run, position
+    auto after = [&](const Cursor& a, const Cursor& b) {
+        const KeyT& keyA = runs[a.first][a.second].first;
+        const KeyT& keyB = runs[b.first][b.second].first;
+        return keyA != keyB ? keyB < keyA : a.first > b.first;
+    };
+    std::priority_queue<Cursor, std::vector<Cursor>, decltype(after)> heap(after);
+    for (size_t i = 0; i < runs.size(); i++) {
+        if (!runs[i].empty()) {
+            heap.emplace(i, 0);
+        }
+    }
+
+    while (!heap.empty()) {
+        Cursor cursor = heap.top();
+        heap.pop();
+
+        std::pair<KeyT, std::vector<int>>& entry = runs[cursor.first][cursor.second];
+        if (keys.empty() || keys.back() != entry.first) {
+            keys.push_back(std::move(entry.first));
+            values.emplace_back();
+        }
+        for (int id : entry.second) {
+            values.back().push_back(bases[cursor.first] + id);
+        }
+        std::vector<int>().swap(entry.second);
+
+        if (cursor.second + 1 < runs[cursor.first].size()) {
+            heap.emplace(cursor.first, cursor.second + 1);
+        } else {
+            SortedRun<KeyT>().swap(runs[cursor.first]);
+        }
+    }
+}
+
+// Imports DBLP XML files into empty stores, as if they were imported one
+// after the other with ids from firstId on. threads files (0 for one per
+// core) are parsed at once into sorted runs; their records and columns are
+// written in file order as they come in, bounded by a window of parsed
+// files. The runs of all files are then merged into the indices at once,
+// each built bottom-up by bulkLoad; the author and keyword indices are
+// keyed by the ids of the names in columns, the keyword-year index splits
+// the ids of every keyword by the years in columns. recordFields is the
+// record layout: article_id, title, keywords and names of DBLP_FIELDS.
+// If it throws, the stores are cleared so the import can be retried; the
+// indices may be partly loaded and have to be replaced.
+BulkImportStats bulkImport(const std::vector<std::string>& paths, const std::vector<std::string>& recordFields,
+    RecordStore& records, ColumnStore& columns,
+    BPTree<int, std::vector<int>>& authorIndex, BPTree<std::wstring, int>& titleIndex,
+    BPTree<int, std::vector<int>>& keywordIndex, BPTree<int, std::vector<int>>& dateIndex,
+    BPTree<KeywordYear, std::vector<int>>& keywordYearIndex,
+    int firstId = 1, unsigned threads = 0) {
+    if (records.size() != 0 || columns.size() != 0) {
+        throw std::runtime_error("bulk import needs empty stores");
+    }
+    // checked before anything is written, bulkLoad would only fail at the end
+    if (!authorIndex.empty() || !titleIndex.empty() || !keywordIndex.empty() || !dateIndex.empty()
+        || !keywordYearIndex.empty()) {
+        throw std::runtime_error("bulk import needs empty indices");
+    }
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    auto started = std::chrono::steady_clock::now();
+
+    static const size_t YEAR = dblpField("year");
+    static const size_t AUTHORS = dblpField("authors");
+
+    // where each record field comes from, an index of DBLP_FIELDS or one of these
+    enum { ARTICLE_ID = -1, TITLE_FIELD = -2, KEYWORDS = -3, MISSING = -4 };
+    std::vector<int> sources;
+    for (const std::string& name : recordFields) {
+        size_t field = dblpField(name);
+        sources.push_back(name == "article_id" ? ARTICLE_ID : name == "title" ? TITLE_FIELD
+            : name == "keywords" ? KEYWORDS : field < DBLP_FIELDS.size() ? int(field) : MISSING);
+    }
+
+    // records and columns of a parsed file, its ids from base on
+    auto commitFile = [&](ParsedFile& file, int base) {
+        for (size_t j = 0; j < file.entries.size(); j++) {
+            Record& entry = file.entries[j];
+            int id = base + j;
+
+            Record record(recordFields.size());
+            for (size_t f = 0; f < sources.size(); f++) {
+                switch (sources[f]) {
+                case ARTICLE_ID: record[f] = (long long)id; break;
+                case TITLE_FIELD: record[f] = entryTitle(entry); break;
+                case KEYWORDS: record[f] = file.keywords[j]; break;
+                case MISSING: break;
+                default: record[f] = entry[sources[f]]; break;
+                }
+            }
+            records.put(id, record);
+
+            const std::vector<std::string>* authors = std::get_if<std::vector<std::string>>(&entry[AUTHORS]);
+            columns.put(id, std::get<long long>(entry[YEAR]), authors ? *authors : std::vector<std::string>(),
+                file.keywords[j]);
+        }
+    };
+
+    std::vector<std::unique_ptr<ParsedFile>> parsed(paths.size());
+    std::mutex mutex;
+    std::condition_variable changed;
+    size_t next = 0;
+    size_t committed = 0;
+    std::exception_ptr error;
+    const size_t window = 2 * threads;
+
+    std::vector<std::thread> workers;
+    for (unsigned t = 0; t < std::min<size_t>(threads, paths.size()); t++) {
+        workers.emplace_back([&] {
+            while (true) {
+                size_t i;
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    changed.wait(lock, [&] { return error || next >= paths.size() || next < committed + window; });
+                    if (error || next >= paths.size()) {
+                        return;
+                    }
+                    i = next++;
+                }
+
+                try {
+                    std::unique_ptr<ParsedFile> file = parseFile(paths[i]);
+                    std::lock_guard<std::mutex> lock(mutex);
+                    parsed[i] = std::move(file);
+                } catch (...) {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    if (!error) {
+                        error = std::current_exception();
+                    }
+                }
+                changed.notify_all();
+            }
+        });
+    }
+
+    std::vector<SortedRun<int>> authorRuns(paths.size()), keywordRuns(paths.size()), yearRuns(paths.size());
+    std::vector<SortedRun<std::wstring>> titleRuns(paths.size());
+    std::vector<int> bases(paths.size());
+    BulkImportStats stats{ 0, 0, 0 };
+
+    for (size_t i = 0; i < paths.size(); i++) {
+        std::unique_ptr<ParsedFile> file;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            changed.wait(lock, [&] { return error || parsed[i]; });
+            if (error) {
+                break;
+            }
+            file = std::move(parsed[i]);
+        }
+
+        int base = firstId + stats.articles;
+        try {
+            commitFile(*file, base);
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(mutex);
+            error = std::current_exception();
+            changed.notify_all();
+            break;
+        }
+
+        bases[i] = base;
+        stats.articles += file->entries.size();
+        stats.bytes += file->bytes;
+        authorRuns[i] = internedRun(file->authorGroups, columns.authors());
+        titleRuns[i] = std::move(file->titleRun);
+        keywordRuns[i] = internedRun(file->keywordGroups, columns.keywords());
+        yearRuns[i] = std::move(file->yearRun);
+
+        std::lock_guard<std::mutex> lock(mutex);
+        committed++;
+        changed.notify_all();
+    }
+
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+    if (error) {
+        records.clear();
+        columns.clear();
+        std::rethrow_exception(error);
+    }
+
+    // the indices are merged and built at the same time
+    std::vector<std::function<void()>> builds = {
+        [&] {
+            std::vector<int> keys;
+            std::vector<std::vector<int>> values;
+            mergeRuns(authorRuns, bases, keys, values);
+            authorIndex.bulkLoad(keys, values);
+        },
+        [&] {
+            std::vector<int> keys;
+            std::vector<std::vector<int>> values;
+            mergeRuns(keywordRuns, bases, keys, values);
+
+            // keywords come in order, so do their years
+            std::vector<KeywordYear> yearKeys;
+            std::vector<std::vector<int>> yearValues;
+            for (size_t i = 0; i < keys.size(); i++) {
+                std::map<int, std::vector<int>> byYear;
+                for (int id : values[i]) {
+                    byYear[columns.year(id)].push_back(id);
+                }
+                for (auto& year : byYear) {
+                    yearKeys.push_back({ keys[i], year.first });
+                    yearValues.push_back(std::move(year.second));
+                }
+            }
+            keywordIndex.bulkLoad(keys, values);
+            keywordYearIndex.bulkLoad(yearKeys, yearValues);
+        },
+        [&] {
+            std::vector<int> keys;
+            std::vector<std::vector<int>> values;
+            mergeRuns(yearRuns, bases, keys, values);
+            dateIndex.bulkLoad(keys, values);
+        },
+        [&] {
+            std::vector<std::wstring> keys;
+            std::vector<std::vector<int>> values;
+            mergeRuns(titleRuns, bases, keys, values);
+
+            // a title goes to its first article, the later ones are
+            // renamed the way LiteratureStorage.add_article does
+            std::vector<int> ids;
+            std::vector<std::pair<std::wstring, int>> duplicates;
+            for (size_t i = 0; i < keys.size(); i++) {
+                ids.push_back(values[i][0]);
+                for (size_t j = 1; j < values[i].size(); j++) {
+                    duplicates.emplace_back(keys[i] + L" - dup id(" + std::to_wstring(values[i][j]) + L")",
+                        values[i][j]);
+                }
+            }
+            values.clear();
+            titleIndex.bulkLoad(keys, ids);
+            for (const auto& duplicate : duplicates) {
+                titleIndex.insert(duplicate.first, duplicate.second);
+            }
+        }
+    };
+
+    std::vector<std::thread> builders;
+    for (auto& build : builds) {
+        builders.emplace_back([&] {
+            try {
+                build();
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (!error) {
+                    error = std::current_exception();
+                }
+            }
+        });
+    }
+    for (std::thread& builder : builders) {
+        builder.join();
+    }
+    if (error) {
+        records.clear();
+        columns.clear();
+        std::rethrow_exception(error);
+    }
+
+    stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    return stats;
+}
+
+#endif
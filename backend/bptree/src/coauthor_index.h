@@ -0,0 +1,165 @@
+/*
+    Copyright (C) 2025 Yuesong Feng
+    Copyright (C) 2025 ParaN3xus
+*/
+
+#ifndef COAUTHOR_INDEX_H
+#define COAUTHOR_INDEX_H
+
+#include <set>
+#include <vector>
+#include <utility>
+#include <iterator>
+#include <algorithm>
+
+// Weighted coauthor graph over author ids: for every author the coauthors
+// with the number of shared articles, and the articles themselves, both
+// sorted by id so lookups are binary searches and two authors' articles
+// intersect with one merge. Authors are also kept ranked by their number
+// of articles, so the most productive ones are read off in O(k).
+class CoauthorIndex {
+public:
+    // authors are the distinct author ids of the article
+    void add(int articleId, const std::vector<int>& authors);
+    void remove(int articleId, const std::vector<int>& authors);
+
+    // (coauthor id, shared articles), by coauthor id
+    const std::vector<std::pair<int, int>>& coauthors(int authorId) const;
+    // the k coauthors with the most shared articles, ties by id
+    std::vector<std::pair<int, int>> topCoauthors(int authorId, size_t k) const;
+    const std::vector<int>& articles(int authorId) const;
+    std::vector<int> sharedArticles(int authorId, int otherId) const;
+    // (author id, articles) of the k authors with the most articles, ties by id
+    std::vector<std::pair<int, int>> topAuthors(size_t k) const;
+
+private:
+    std::vector<std::vector<std::pair<int, int>>> adjacency;
+    std::vector<std::vector<int>> authorArticles;
+    // (-articles, author id) of every author with articles
+    std::set<std::pair<int, int>> ranking;
+
+    void reserve(int authorId);
+    void addWeight(int authorId, int coauthorId, int delta);
+    void rank(int authorId, int oldCount);
+};
+
+void CoauthorIndex::reserve(int authorId) {
+    if (size_t(authorId) >= adjacency.size()) {
+        adjacency.resize(size_t(authorId) + 1);
+        authorArticles.resize(size_t(authorId) + 1);
+    }
+}
+
+void CoauthorIndex::addWeight(int authorId, int coauthorId, int delta) {
+    std::vector<std::pair<int, int>>& list = adjacency[authorId];
+    auto it = std::lower_bound(list.begin(), list.end(), std::make_pair(coauthorId, 0),
+        [](const std::pair<int, int>& a, const std::pair<int, int>& b) { return a.first < b.first; });
+
+    if (it == list.end() || it->first != coauthorId) {
+        list.insert(it, std::make_pair(coauthorId, delta));
+    } else if ((it->second += delta) <= 0) {
+        list.erase(it);
+    }
+}
+
+void CoauthorIndex::rank(int authorId, int oldCount) {
+    if (oldCount > 0) {
+        ranking.erase(std::make_pair(-oldCount, authorId));
+    }
+    int count = authorArticles[authorId].size();
+    if (count > 0) {
+        ranking.emplace(-count, authorId);
+    }
+}
+
+void CoauthorIndex::add(int articleId, const std::vector<int>& authors) {
+    for (int authorId : authors) {
+        reserve(authorId);
+
+        std::vector<int>& list = authorArticles[authorId];
+        auto it = std::lower_bound(list.begin(), list.end(), articleId);
+        if (it != list.end() && *it == articleId) {
+            continue;
+        }
+        list.insert(it, articleId);
+        rank(authorId, list.size() - 1);
+
+        for (int coauthorId : authors) {
+            if (coauthorId != authorId) {
+                addWeight(authorId, coauthorId, 1);
+            }
+        }
+    }
+}
+
+void CoauthorIndex::remove(int articleId, const std::vector<int>& authors) {
+    for (int authorId : authors) {
+        if (size_t(authorId) >= authorArticles.size()) {
+            continue;
+        }
+
+        std::vector<int>& list = authorArticles[authorId];
+        auto it = std::lower_bound(list.begin(), list.end(), articleId);
+        if (it == list.end() || *it != articleId) {
+            continue;
+        }
+        list.erase(it);
+        rank(authorId, list.size() + 1);
+
+        for (int coauthorId : authors) {
+            if (coauthorId != authorId) {
+                addWeight(authorId, coauthorId, -1);
+            }
+        }
+    }
+}
+
+const std::vector<std::pair<int, int>>& CoauthorIndex::coauthors(int authorId) const {
+    static const std::vector<std::pair<int, int>> none;
+    if (authorId < 0 || size_t(authorId) >= adjacency.size()) {
+        return none;
+    }
+    return adjacency[authorId];
+}
+
+std::vector<std::pair<int, int>> CoauthorIndex::topCoauthors(int authorId, size_t k) const {
+    std::vector<std::pair<int, int>> result = coauthors(authorId);
+    auto byCount = [](const std::pair<int, int>& a, const std::pair<int, int>& b) {
+        return a.second != b.second ? a.second > b.second : a.first < b.first;
+    };
+
+    if (k < result.size()) {
+        std::partial_sort(result.begin(), result.begin() + k, result.end(), byCount);
+        result.resize(k);
+    } else {
+        std::sort(result.begin(), result.end(), byCount);
+    }
+    return result;
+}
+
+const std::vector<int>& CoauthorIndex::articles(int authorId) const {
+    static const std::vector<int> none;
+    if (authorId < 0 || size_t(authorId) >= authorArticles.size()) {
+        return none;
+    }
+    return authorArticles[authorId];
+}
+
+std::vector<int> CoauthorIndex::sharedArticles(int authorId, int otherId) const {
+    const std::vector<int>& a = articles(authorId);
+    const std::vector<int>& b = articles(otherId);
+
+    std::vector<int> result;
+    std::set_intersection(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(result));
+    return result;
+}
+
+std::vector<std::pair<int, int>> CoauthorIndex::topAuthors(size_t k) const {
+    std::vector<std::pair<int, int>> result;
+    for (auto it = ranking.begin(); it != ranking.end() && result.size() < k; it++) {
+        result.emplace_back(it->second, -it->first);
+    }
+    return result;
+}
+
+#endif
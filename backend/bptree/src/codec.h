@@ -0,0 +1,157 @@
+/*
+    Copyright (C) 2025 Yuesong Feng
+    Copyright (C) 2025 ParaN3xus
+*/
+
+#ifndef CODEC_H
+#define CODEC_H
+
+#include <vector>
+#include <string>
+#include <cstring>
+#include <cstdint>
+#include <stdexcept>
+#include <type_traits>
+
+// How a key or value type is laid out in a file. Codec<T> appends the
+// encoding of a T to a buffer, reads one back from [position, end) and
+// tells the size of an encoding in advance, so whole nodes are encoded
+// into one buffer. tag() tells encodings apart, so a file is not read as
+// a tree of other types. A new index type only needs a Codec
+// specialization; trivially copyable types (ints, fixed structs) work as
+// they are.
+//
+//   trivially copyable T    the bytes of T
+//   basic_string<C>         size_t length + the characters
+//   vector<T>               size_t count + the elements, copied in one go
+//                           if T is trivially copyable
+template<typename T, typename Enable = void>
+struct Codec {
+    static_assert(std::is_trivially_copyable_v<T>, "no Codec for this type");
+
+    // kind, signedness and size; the low two bits are left for containers
+    static constexpr uint32_t tag() {
+        return ((std::is_integral_v<T> ? 1u : std::is_floating_point_v<T> ? 2u : 3u) << 10
+            | (std::is_signed_v<T> ? 1u : 0u) << 9 | uint32_t(sizeof(T) & 0x1FF)) << 2;
+    }
+
+    static size_t size(const T&) {
+        return sizeof(T);
+    }
+
+    static void encode(const T& value, std::string& out) {
+        out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    static T decode(const char*& position, const char* end) {
+        if (position + sizeof(T) > end) {
+            throw std::runtime_error("encoded data is truncated");
+        }
+        if constexpr (std::is_same_v<T, bool>) {
+            if (uint8_t(*position) > 1) {
+                throw std::runtime_error("encoded bool is invalid");
+            }
+        }
+        T value;
+        memcpy(&value, position, sizeof(T));
+        position += sizeof(T);
+        return value;
+    }
+};
+
+// count elements of trivially copyable T at position, checked against end
+template<typename T>
+inline const char* encodedElements(const char*& position, const char* end, size_t count) {
+    if (count > size_t(end - position) / sizeof(T)) {
+        throw std::runtime_error("encoded data is truncated");
+    }
+    const char* elements = position;
+    position += count * sizeof(T);
+    return elements;
+}
+
+template<typename C>
+struct Codec<std::basic_string<C>> {
+    static constexpr uint32_t tag() {
+        return Codec<C>::tag() << 2 | 1;
+    }
+
+    static size_t size(const std::basic_string<C>& value) {
+        return sizeof(size_t) + value.size() * sizeof(C);
+    }
+
+    static void encode(const std::basic_string<C>& value, std::string& out) {
+        Codec<size_t>::encode(value.size(), out);
+        out.append(reinterpret_cast<const char*>(value.data()), value.size() * sizeof(C));
+    }
+
+    static std::basic_string<C> decode(const char*& position, const char* end) {
+        size_t length = Codec<size_t>::decode(position, end);
+        const char* chars = encodedElements<C>(position, end, length);
+        std::basic_string<C> value(length, C());
+        memcpy(&value[0], chars, length * sizeof(C));
+        return value;
+    }
+};
+
+template<typename T>
+struct Codec<std::vector<T>> {
+    static constexpr uint32_t tag() {
+        return Codec<T>::tag() << 2 | 2;
+    }
+
+    static size_t size(const std::vector<T>& value) {
+        if constexpr (std::is_trivially_copyable_v<T>) {
+            return sizeof(size_t) + value.size() * sizeof(T);
+        }
+        else {
+            size_t size = sizeof(size_t);
+            for (const T& element : value) {
+                size += Codec<T>::size(element);
+            }
+            return size;
+        }
+    }
+
+    static void encode(const std::vector<T>& value, std::string& out) {
+        Codec<size_t>::encode(value.size(), out);
+        if constexpr (std::is_trivially_copyable_v<T>) {
+            out.append(reinterpret_cast<const char*>(value.data()), value.size() * sizeof(T));
+        }
+        else {
+            for (const T& element : value) {
+                Codec<T>::encode(element, out);
+            }
+        }
+    }
+
+    static std::vector<T> decode(const char*& position, const char* end) {
+        size_t count = Codec<size_t>::decode(position, end);
+        std::vector<T> value;
+        if constexpr (std::is_trivially_copyable_v<T>) {
+            const char* elements = encodedElements<T>(position, end, count);
+            value.resize(count);
+            if (count > 0) {
+                memcpy(value.data(), elements, count * sizeof(T));
+            }
+        }
+        else {
+            for (size_t i = 0; i < count; i++) {
+                value.push_back(Codec<T>::decode(position, end));
+            }
+        }
+        return value;
+    }
+};
+
+template<typename T>
+inline void encodeTo(std::string& out, const T& value) {
+    Codec<T>::encode(value, out);
+}
+
+template<typename T>
+inline T decodeFrom(const char*& position, const char* end) {
+    return Codec<T>::decode(position, end);
+}
+
+#endif
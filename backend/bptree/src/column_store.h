@@ -0,0 +1,539 @@
+/*
+    Copyright (C) 2025 Yuesong Feng
+    Copyright (C) 2025 ParaN3xus
+*/
+
+#ifndef COLUMN_STORE_H
+#define COLUMN_STORE_H
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <map>
+#include <string>
+#include <cstdio>
+#include <cstdint>
+#include <climits>
+#include <cstring>
+#include <algorithm>
+#include <stdexcept>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <shared_mutex>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "string_dict.h"
+#include "coauthor_index.h"
+#include "name_index.h"
+#include "tokenizer.h"
+
+// keywords of one year, most frequent first (ties by id)
+struct YearlyKeywordCounts {
+    int articles = 0;
+    std::vector<int> keywordIds;
+    std::vector<int> counts;
+};
+
+typedef std::map<int, YearlyKeywordCounts> YearlyKeywordCountsMap;
+
+// The fields statistics need, per article id: year, author ids and keyword
+// ids, with the ids interned in StringDicts. Every column is a raw array in
+// its own file, so it can be read (or mapped) as is:
+//
+//   year.col       int32 year[numArticles]
+//   authors.rows   Row rows[numArticles]       row of article i is
+//   authors.vals   int32 values[]                values[start..start + length)
+//   keywords.rows, keywords.vals                 the same for keywords
+//
+// columns.meta is written last by flush() and tells how much of each file
+// is valid, anything after that is an interrupted flush and is ignored.
+// The coauthor index is derived from the author column when opening and
+// kept up to date by put().
+class ColumnStore {
+public:
+    ColumnStore(const std::string& directory);
+
+    void put(int articleId, int year, const std::vector<std::string>& authors,
+        const std::vector<std::string>& keywords);
+    bool contains(int articleId) const;
+    size_t size() const;
+    int year(int articleId) const;
+    std::vector<int> authorIds(int articleId) const;
+    std::vector<int> keywordIds(int articleId) const;
+    // number of keywords of an article, and on average over the articles
+    size_t keywordCount(int articleId) const;
+    double averageKeywordCount() const;
+
+    StringDict& authors();
+    StringDict& keywords();
+
+    const CoauthorIndex& coauthors() const;
+
+    // (author id, edit distance) of the up to limit author names closest
+    // to name within maxDistance among the first numAuthors, see NameIndex;
+    // the names are indexed on the first search and may be searched while
+    // put() is called
+    std::vector<std::pair<int, int>> findAuthorsFuzzy(const std::string& name, int maxDistance, size_t limit,
+        size_t numAuthors = SIZE_MAX) const;
+
+    // the keywords of each title (see tokenizer.h) as ids in keywords(),
+    // interning the new ones
+    std::vector<std::vector<int>> internKeywords(const std::vector<std::string>& titles);
+
+    // year -> the limit (0 for all) most frequent keywords by number of
+    // articles up to maxArticleId, year 0 and excluded keywords left out.
+    // Years are counted on threads (0 for one per core) and may run while
+    // put() is called from another thread.
+    YearlyKeywordCountsMap yearlyKeywordCounts(const std::vector<int>& excludedKeywordIds,
+        size_t limit = 0, unsigned threads = 0, int maxArticleId = INT_MAX) const;
+
+    void flush();
+    // drops every article and name and removes the files
+    void clear();
+
+private:
+    struct Row {
+        uint64_t start;
+        uint32_t length;
+        uint32_t present;
+    };
+
+    // article -> ids, values only ever get appended
+    struct CsrColumn {
+        std::vector<Row> rows;
+        std::vector<int32_t> values;
+        size_t persistedValues = 0;
+
+        void put(int articleId, std::vector<int32_t> ids);
+        const int32_t* begin(int articleId) const;
+        const int32_t* end(int articleId) const;
+        // every row within values, with ids below dictSize
+        bool valid(size_t dictSize) const;
+    };
+
+    struct Meta {
+        char magic[8];
+        uint32_t version;
+        uint32_t reserved;
+        uint64_t numArticles;
+        uint64_t numAuthorValues;
+        uint64_t numKeywordValues;
+    };
+
+    static constexpr uint32_t COLUMNS_VERSION = 1;
+
+    std::string directory;
+    StringDict authorDict;
+    StringDict keywordDict;
+    std::vector<int32_t> years;
+    CsrColumn authorColumn;
+    CsrColumn keywordColumn;
+    CoauthorIndex coauthorIndex;
+    mutable NameIndex authorNameIndex;
+    size_t numPresent;
+    uint64_t numKeywords;   // in the rows of the present articles
+    size_t dirtyFrom;   // rows from this article id on changed since flush
+    mutable std::shared_mutex mutex;
+
+    std::string columnPath(const std::string& name) const;
+
+    template<typename T>
+    static bool readColumn(const std::string& path, std::vector<T>& column, size_t count);
+    template<typename T>
+    static bool writeColumn(const std::string& path, const std::vector<T>& column, size_t from);
+};
+
+void ColumnStore::CsrColumn::put(int articleId, std::vector<int32_t> ids) {
+    // an article counts once however often a name appears in it
+    std::sort(ids.begin(), ids.end());
+    ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+
+    if (size_t(articleId) >= rows.size()) {
+        rows.resize(size_t(articleId) + 1, Row{ 0, 0, 0 });
+    }
+
+    rows[articleId] = Row{ values.size(), uint32_t(ids.size()), 1 };
+    values.insert(values.end(), ids.begin(), ids.end());
+}
+
+const int32_t* ColumnStore::CsrColumn::begin(int articleId) const {
+    if (articleId < 0 || size_t(articleId) >= rows.size()) {
+        return nullptr;
+    }
+    return values.data() + rows[articleId].start;
+}
+
+const int32_t* ColumnStore::CsrColumn::end(int articleId) const {
+    if (articleId < 0 || size_t(articleId) >= rows.size()) {
+        return nullptr;
+    }
+    return values.data() + rows[articleId].start + rows[articleId].length;
+}
+
+bool ColumnStore::CsrColumn::valid(size_t dictSize) const {
+    for (const Row& row : rows) {
+        if (row.start > values.size() || row.length > values.size() - row.start) {
+            return false;
+        }
+        for (size_t i = row.start; i < row.start + row.length; i++) {
+            if (values[i] < 0 || size_t(values[i]) >= dictSize) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+ColumnStore::ColumnStore(const std::string& directory)
+    : directory((mkdir(directory.c_str(), 0755), directory)),
+    authorDict(directory + "/authors.dict"),
+    keywordDict(directory + "/keywords.dict"),
+    numPresent(0), numKeywords(0), dirtyFrom(0) {
+    std::ifstream infile(columnPath("columns.meta"), std::ios::binary);
+    if (!infile) {
+        return;
+    }
+
+    Meta meta;
+    infile.read(reinterpret_cast<char*>(&meta), sizeof(meta));
+    if (!infile || memcmp(meta.magic, "COLUMNS", 8) != 0 || meta.version != COLUMNS_VERSION) {
+        std::cerr << "Ignoring invalid columns in " << directory << std::endl;
+        return;
+    }
+
+    auto ignore = [&](const char* reason) {
+        std::cerr << "Columns in " << directory << " are " << reason << ", ignoring them" << std::endl;
+        years.clear();
+        authorColumn = CsrColumn();
+        keywordColumn = CsrColumn();
+    };
+
+    if (!readColumn(columnPath("year.col"), years, meta.numArticles)
+        || !readColumn(columnPath("authors.rows"), authorColumn.rows, meta.numArticles)
+        || !readColumn(columnPath("authors.vals"), authorColumn.values, meta.numAuthorValues)
+        || !readColumn(columnPath("keywords.rows"), keywordColumn.rows, meta.numArticles)
+        || !readColumn(columnPath("keywords.vals"), keywordColumn.values, meta.numKeywordValues)) {
+        ignore("truncated");
+        return;
+    }
+
+    // a crash in a flush after a re-put can leave rows past the values of
+    // columns.meta, and a damaged dict ids past its end; the columns are
+    // then built again from the records
+    if (!authorColumn.valid(authorDict.size()) || !keywordColumn.valid(keywordDict.size())) {
+        ignore("invalid");
+        return;
+    }
+
+    authorColumn.persistedValues = authorColumn.values.size();
+    keywordColumn.persistedValues = keywordColumn.values.size();
+    dirtyFrom = years.size();
+
+    for (size_t articleId = 0; articleId < authorColumn.rows.size(); articleId++) {
+        if (authorColumn.rows[articleId].present) {
+            numPresent++;
+            numKeywords += keywordColumn.rows[articleId].length;
+            coauthorIndex.add(articleId, authorIds(articleId));
+        }
+    }
+}
+
+std::string ColumnStore::columnPath(const std::string& name) const {
+    return directory + "/" + name;
+}
+
+void ColumnStore::put(int articleId, int year, const std::vector<std::string>& authors,
+    const std::vector<std::string>& keywords) {
+    if (articleId < 0) {
+        throw std::invalid_argument("article ids must not be negative");
+    }
+
+    std::unique_lock<std::shared_mutex> lock(mutex);
+
+    if (contains(articleId)) {
+        coauthorIndex.remove(articleId, authorIds(articleId));
+        numKeywords -= keywordColumn.rows[articleId].length;
+    } else {
+        numPresent++;
+    }
+
+    if (size_t(articleId) >= years.size()) {
+        years.resize(size_t(articleId) + 1, 0);
+    }
+    years[articleId] = year;
+
+    std::vector<int32_t> ids;
+    for (const std::string& author : authors) {
+        ids.push_back(authorDict.intern(author));
+    }
+    authorColumn.put(articleId, ids);
+    coauthorIndex.add(articleId, authorIds(articleId));
+
+    ids.clear();
+    for (const std::string& keyword : keywords) {
+        ids.push_back(keywordDict.intern(keyword));
+    }
+    keywordColumn.put(articleId, ids);
+    numKeywords += keywordColumn.rows[articleId].length;
+
+    // keep every column as long as the year column
+    authorColumn.rows.resize(years.size(), Row{ 0, 0, 0 });
+    keywordColumn.rows.resize(years.size(), Row{ 0, 0, 0 });
+
+    dirtyFrom = std::min(dirtyFrom, size_t(articleId));
+}
+
+bool ColumnStore::contains(int articleId) const {
+    return articleId >= 0 && size_t(articleId) < authorColumn.rows.size()
+        && authorColumn.rows[articleId].present;
+}
+
+size_t ColumnStore::size() const {
+    return numPresent;
+}
+
+int ColumnStore::year(int articleId) const {
+    if (articleId < 0 || size_t(articleId) >= years.size()) {
+        return 0;
+    }
+    return years[articleId];
+}
+
+std::vector<int> ColumnStore::authorIds(int articleId) const {
+    return std::vector<int>(authorColumn.begin(articleId), authorColumn.end(articleId));
+}
+
+std::vector<int> ColumnStore::keywordIds(int articleId) const {
+    return std::vector<int>(keywordColumn.begin(articleId), keywordColumn.end(articleId));
+}
+
+size_t ColumnStore::keywordCount(int articleId) const {
+    return keywordColumn.end(articleId) - keywordColumn.begin(articleId);
+}
+
+double ColumnStore::averageKeywordCount() const {
+    return numPresent == 0 ? 0.0 : double(numKeywords) / numPresent;
+}
+
+StringDict& ColumnStore::authors() {
+    return authorDict;
+}
+
+StringDict& ColumnStore::keywords() {
+    return keywordDict;
+}
+
+const CoauthorIndex& ColumnStore::coauthors() const {
+    return coauthorIndex;
+}
+
+std::vector<std::pair<int, int>> ColumnStore::findAuthorsFuzzy(const std::string& name, int maxDistance,
+    size_t limit, size_t numAuthors) const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    return authorNameIndex.search(authorDict, name, maxDistance, limit, numAuthors);
+}
+
+std::vector<std::vector<int>> ColumnStore::internKeywords(const std::vector<std::string>& titles) {
+    std::vector<std::vector<std::string>> keywords = extractKeywords(titles);
+
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    std::vector<std::vector<int>> result(keywords.size());
+    for (size_t i = 0; i < keywords.size(); i++) {
+        for (const std::string& keyword : keywords[i]) {
+            result[i].push_back(keywordDict.intern(keyword));
+        }
+    }
+    return result;
+}
+
+YearlyKeywordCountsMap ColumnStore::yearlyKeywordCounts(const std::vector<int>& excludedKeywordIds,
+    size_t limit, unsigned threads, int maxArticleId) const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+
+    std::vector<bool> excluded(keywordDict.size(), false);
+    for (int id : excludedKeywordIds) {
+        if (id >= 0 && size_t(id) < excluded.size()) {
+            excluded[id] = true;
+        }
+    }
+
+    // one pass over the year column, then every year is independent
+    std::map<int, std::vector<int>> articlesByYear;
+    size_t endId = maxArticleId < 0 ? 0 : std::min(years.size(), size_t(maxArticleId) + 1);
+    for (size_t articleId = 0; articleId < endId; articleId++) {
+        if (contains(articleId) && years[articleId] != 0) {
+            articlesByYear[years[articleId]].push_back(articleId);
+        }
+    }
+
+    std::vector<const std::pair<const int, std::vector<int>>*> work;
+    for (const auto& year : articlesByYear) {
+        work.push_back(&year);
+    }
+    std::vector<YearlyKeywordCounts> counted(work.size());
+    std::atomic<size_t> next(0);
+
+    auto countYears = [&]() {
+        // dense counts reused across years, only touched entries are reset
+        std::vector<int> counts(keywordDict.size(), 0);
+        std::vector<int> touched;
+
+        for (size_t i; (i = next++) < work.size();) {
+            for (int articleId : work[i]->second) {
+                for (const int32_t* it = keywordColumn.begin(articleId); it != keywordColumn.end(articleId); it++) {
+                    if (!excluded[*it] && counts[*it]++ == 0) {
+                        touched.push_back(*it);
+                    }
+                }
+            }
+
+            auto byCount = [&](int a, int b) {
+                return counts[a] != counts[b] ? counts[a] > counts[b] : a < b;
+            };
+            size_t kept = limit == 0 ? touched.size() : std::min(limit, touched.size());
+            std::partial_sort(touched.begin(), touched.begin() + kept, touched.end(), byCount);
+
+            YearlyKeywordCounts& result = counted[i];
+            result.articles = work[i]->second.size();
+            for (size_t j = 0; j < kept; j++) {
+                result.keywordIds.push_back(touched[j]);
+                result.counts.push_back(counts[touched[j]]);
+            }
+
+            for (int id : touched) {
+                counts[id] = 0;
+            }
+            touched.clear();
+        }
+    };
+
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    threads = std::min<size_t>(threads, work.size());
+
+    std::vector<std::thread> workers;
+    for (unsigned t = 1; t < threads; t++) {
+        workers.emplace_back(countYears);
+    }
+    countYears();
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+
+    YearlyKeywordCountsMap result;
+    for (size_t i = 0; i < work.size(); i++) {
+        result.emplace_hint(result.end(), work[i]->first, std::move(counted[i]));
+    }
+    return result;
+}
+
+template<typename T>
+bool ColumnStore::readColumn(const std::string& path, std::vector<T>& column, size_t count) {
+    column.resize(count);
+    if (count == 0) {
+        return true;
+    }
+
+    std::ifstream infile(path, std::ios::binary);
+    infile.read(reinterpret_cast<char*>(column.data()), count * sizeof(T));
+    return bool(infile);
+}
+
+// write column[from..] over the file and cut it to the column's length
+template<typename T>
+bool ColumnStore::writeColumn(const std::string& path, const std::vector<T>& column, size_t from) {
+    int fd = open(path.c_str(), O_WRONLY | O_CREAT, 0644);
+    if (fd < 0) {
+        return false;
+    }
+
+    const char* data = reinterpret_cast<const char*>(column.data() + from);
+    size_t remaining = (column.size() - from) * sizeof(T);
+    off_t offset = from * sizeof(T);
+
+    while (remaining > 0) {
+        ssize_t written = pwrite(fd, data, remaining, offset);
+        if (written < 0) {
+            close(fd);
+            return false;
+        }
+        data += written;
+        offset += written;
+        remaining -= written;
+    }
+
+    bool ok = ftruncate(fd, column.size() * sizeof(T)) == 0 && fsync(fd) == 0;
+    close(fd);
+    return ok;
+}
+
+void ColumnStore::flush() {
+    // nothing that references ids goes to disk before the names of the ids
+    if (!authorDict.flush() || !keywordDict.flush()) {
+        std::cerr << "Error writing columns to " << directory << std::endl;
+        return;
+    }
+
+    size_t from = std::min(dirtyFrom, years.size());
+    if (!writeColumn(columnPath("year.col"), years, from)
+        || !writeColumn(columnPath("authors.rows"), authorColumn.rows, from)
+        || !writeColumn(columnPath("authors.vals"), authorColumn.values, authorColumn.persistedValues)
+        || !writeColumn(columnPath("keywords.rows"), keywordColumn.rows, from)
+        || !writeColumn(columnPath("keywords.vals"), keywordColumn.values, keywordColumn.persistedValues)) {
+        std::cerr << "Error writing columns to " << directory << std::endl;
+        return;
+    }
+
+    Meta meta;
+    memset(&meta, 0, sizeof(meta));
+    memcpy(meta.magic, "COLUMNS", 8);
+    meta.version = COLUMNS_VERSION;
+    meta.numArticles = years.size();
+    meta.numAuthorValues = authorColumn.values.size();
+    meta.numKeywordValues = keywordColumn.values.size();
+
+    std::string tempPath = columnPath("columns.meta.tmp");
+    if (!writeColumn(tempPath, std::vector<Meta>{ meta }, 0)
+        || std::rename(tempPath.c_str(), columnPath("columns.meta").c_str()) != 0) {
+        std::cerr << "Error writing columns to " << directory << std::endl;
+        return;
+    }
+
+    // the rename is only durable once the directory is synced
+    int dirFd = open(directory.c_str(), O_RDONLY | O_DIRECTORY);
+    if (dirFd >= 0) {
+        fsync(dirFd);
+        close(dirFd);
+    }
+
+    authorColumn.persistedValues = authorColumn.values.size();
+    keywordColumn.persistedValues = keywordColumn.values.size();
+    dirtyFrom = years.size();
+}
+
+void ColumnStore::clear() {
+    std::unique_lock<std::shared_mutex> lock(mutex);
+
+    // columns.meta goes first, the columns are only read through it
+    std::remove(columnPath("columns.meta").c_str());
+    for (const char* name : { "year.col", "authors.rows", "authors.vals", "keywords.rows", "keywords.vals" }) {
+        std::remove(columnPath(name).c_str());
+    }
+    authorDict.clear();
+    keywordDict.clear();
+
+    years.clear();
+    authorColumn = CsrColumn();
+    keywordColumn = CsrColumn();
+    coauthorIndex = CoauthorIndex();
+    authorNameIndex.clear();
+    numPresent = 0;
+    numKeywords = 0;
+    dirtyFrom = 0;
+}
+
+#endif
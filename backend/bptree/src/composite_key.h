@@ -0,0 +1,35 @@
+/*
+    Copyright (C) 2025 Yuesong Feng
+    Copyright (C) 2025 ParaN3xus
+*/
+
+#ifndef COMPOSITE_KEY_H
+#define COMPOSITE_KEY_H
+
+#include <tuple>
+
+// Key of an index by keyword and year, ordered by keyword first, so the
+// years of one keyword are next to each other and a range of them is one
+// scan. Stored as its bytes by Codec.
+struct KeywordYear {
+    int keyword_id;
+    int year;
+};
+
+inline bool operator<(const KeywordYear& a, const KeywordYear& b) {
+    return std::tie(a.keyword_id, a.year) < std::tie(b.keyword_id, b.year);
+}
+
+inline bool operator<=(const KeywordYear& a, const KeywordYear& b) {
+    return !(b < a);
+}
+
+inline bool operator==(const KeywordYear& a, const KeywordYear& b) {
+    return a.keyword_id == b.keyword_id && a.year == b.year;
+}
+
+inline bool operator!=(const KeywordYear& a, const KeywordYear& b) {
+    return !(a == b);
+}
+
+#endif
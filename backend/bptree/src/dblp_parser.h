@@ -0,0 +1,571 @@
+/*
+    Copyright (C) 2025 Yuesong Feng
+    Copyright (C) 2025 ParaN3xus
+*/
+
+#ifndef DBLP_PARSER_H
+#define DBLP_PARSER_H
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <deque>
+#include <string>
+#include <cstring>
+#include <cstdint>
+#include <memory>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <exception>
+#include <stdexcept>
+#include <condition_variable>
+#include <unordered_map>
+
+#include "record_store.h"
+
+// Fields of a parsed entry, in the order of its record.
+static const std::vector<std::string> DBLP_FIELDS = {
+    "title", "ee", "year", "authors", "booktitle", "url", "editors",
+    "pages", "publisher", "isbn", "volume", "series", "school", "journal"
+};
+
+static const char* const DBLP_ENTRY_TYPES[] = {
+    "article", "inproceedings", "proceedings", "book",
+    "incollection", "phdthesis", "mastersthesis"
+};
+
+// A queue between two pipeline stages. push() blocks while it is full and
+// pop() while it is empty, both give up once it is closed.
+template<typename T>
+class BoundedQueue {
+public:
+    BoundedQueue(size_t capacity) : capacity(capacity), closed(false) {}
+
+    bool push(T item) {
+        std::unique_lock<std::mutex> lock(mutex);
+        notFull.wait(lock, [&] { return closed || items.size() < capacity; });
+        if (closed) {
+            return false;
+        }
+        items.push_back(std::move(item));
+        notEmpty.notify_one();
+        return true;
+    }
+
+    // false once the queue is closed and drained
+    bool pop(T& item) {
+        std::unique_lock<std::mutex> lock(mutex);
+        notEmpty.wait(lock, [&] { return closed || !items.empty(); });
+        if (items.empty()) {
+            return false;
+        }
+        item = std::move(items.front());
+        items.pop_front();
+        notFull.notify_one();
+        return true;
+    }
+
+    // no more pushes, pop() still returns what is queued
+    void close() {
+        std::lock_guard<std::mutex> lock(mutex);
+        closed = true;
+        notFull.notify_all();
+        notEmpty.notify_all();
+    }
+
+private:
+    size_t capacity;
+    bool closed;
+    std::deque<T> items;
+    std::mutex mutex;
+    std::condition_variable notFull;
+    std::condition_variable notEmpty;
+};
+
+// Streams the entries of a DBLP XML document as records of DBLP_FIELDS,
+// in batches. Three stages overlap: a reader thread cuts the input into
+// chunks, a parser thread turns chunks into batches, and the caller takes
+// batches with nextBatch() and indexes them. Only the entry types of
+// DBLP_ENTRY_TYPES directly under the root element are kept; DBLP's named
+// entities (the Latin-1 set of dblp.dtd), character references and CDATA
+// are decoded to UTF-8, and markup inside a field (<i>, <sub>, ...) is
+// dropped but its text kept.
+class DblpParser {
+public:
+    static constexpr size_t CHUNK_SIZE = 1 << 20;
+
+    DblpParser(std::unique_ptr<std::istream> input, size_t batchSize);
+    ~DblpParser();
+
+    // false when the document is done, rethrows an error of the stages
+    bool nextBatch(std::vector<Record>& batch);
+
+    uint64_t bytesRead() const;
+    uint64_t entries() const;
+    double seconds() const;
+    double megabytesPerSecond() const;
+
+private:
+    std::unique_ptr<std::istream> input;
+    size_t batchSize;
+
+    BoundedQueue<std::string> chunks;
+    BoundedQueue<std::vector<Record>> batches;
+    std::thread reader;
+    std::thread parser;
+    std::exception_ptr error;
+    std::mutex errorMutex;
+
+    std::atomic<uint64_t> numBytes;
+    std::atomic<uint64_t> numEntries;
+    std::chrono::steady_clock::time_point started;
+    std::atomic<int64_t> elapsedNanos;   // set when parsing ends
+
+    // parser state, only touched by the parser thread
+    std::string buffer;
+    size_t pos;
+    bool exhausted;
+
+    void fail();
+    void read();
+    void parse();
+
+    bool fill();
+    int peek();
+    int get();
+    bool startsWith(const char* prefix);
+    bool readPast(const char* terminator, std::string* skipped);
+    void appendEntity(std::string& out);
+    std::string readName();
+    bool readTag(std::string& name, bool& closing, bool& empty);
+};
+
+inline void appendUtf8(std::string& out, uint32_t code) {
+    if (code < 0x80) {
+        out += char(code);
+    } else if (code < 0x800) {
+        out += char(0xC0 | (code >> 6));
+        out += char(0x80 | (code & 0x3F));
+    } else if (code < 0x10000) {
+        out += char(0xE0 | (code >> 12));
+        out += char(0x80 | ((code >> 6) & 0x3F));
+        out += char(0x80 | (code & 0x3F));
+    } else {
+        out += char(0xF0 | (code >> 18));
+        out += char(0x80 | ((code >> 12) & 0x3F));
+        out += char(0x80 | ((code >> 6) & 0x3F));
+        out += char(0x80 | (code & 0x3F));
+    }
+}
+
+// XML's own entities and the ISO 8859-1 ones dblp.dtd declares
+inline const std::unordered_map<std::string, uint32_t>& dblpEntities() {
+    static const std::unordered_map<std::string, uint32_t> entities = [] {
+        static const char* const latin1[] = {
+            "nbsp", "iexcl", "cent", "pound", "curren", "yen", "brvbar", "sect",
+            "uml", "copy", "ordf", "laquo", "not", "shy", "reg", "macr",
+            "deg", "plusmn", "sup2", "sup3", "acute", "micro", "para", "middot",
+            "cedil", "sup1", "ordm", "raquo", "frac14", "frac12", "frac34", "iquest",
+            "Agrave", "Aacute", "Acirc", "Atilde", "Auml", "Aring", "AElig", "Ccedil",
+            "Egrave", "Eacute", "Ecirc", "Euml", "Igrave", "Iacute", "Icirc", "Iuml",
+            "ETH", "Ntilde", "Ograve", "Oacute", "Ocirc", "Otilde", "Ouml", "times",
+            "Oslash", "Ugrave", "Uacute", "Ucirc", "Uuml", "Yacute", "THORN", "szlig",
+            "agrave", "aacute", "acirc", "atilde", "auml", "aring", "aelig", "ccedil",
+            "egrave", "eacute", "ecirc", "euml", "igrave", "iacute", "icirc", "iuml",
+            "eth", "ntilde", "ograve", "oacute", "ocirc", "otilde", "ouml", "divide",
+            "oslash", "ugrave", "uacute", "ucirc", "uuml", "yacute", "thorn", "yuml"
+        };
+
+        std::unordered_map<std::string, uint32_t> result = {
+            { "amp", '&' }, { "lt", '<' }, { "gt", '>' }, { "quot", '"' }, { "apos", '\'' }
+        };
+        for (uint32_t i = 0; i < sizeof(latin1) / sizeof(latin1[0]); i++) {
+            result.emplace(latin1[i], 160 + i);
+        }
+        return result;
+    }();
+    return entities;
+}
+
+DblpParser::DblpParser(std::unique_ptr<std::istream> input, size_t batchSize)
+    : input(std::move(input)), batchSize(std::max<size_t>(batchSize, 1)), chunks(8), batches(4),
+    numBytes(0), numEntries(0), started(std::chrono::steady_clock::now()),
+    elapsedNanos(-1), pos(0), exhausted(false) {
+    reader = std::thread(&DblpParser::read, this);
+    parser = std::thread(&DblpParser::parse, this);
+}
+
+DblpParser::~DblpParser() {
+    // unblock both stages if the caller stopped early
+    chunks.close();
+    batches.close();
+    reader.join();
+    parser.join();
+}
+
+void DblpParser::fail() {
+    std::lock_guard<std::mutex> lock(errorMutex);
+    if (!error) {
+        error = std::current_exception();
+    }
+}
+
+void DblpParser::read() {
+    try {
+        while (*input) {
+            std::string chunk(CHUNK_SIZE, '\0');
+            input->read(&chunk[0], chunk.size());
+            chunk.resize(input->gcount());
+            if (chunk.empty() || !chunks.push(std::move(chunk))) {
+                break;
+            }
+        }
+    } catch (...) {
+        fail();
+    }
+    chunks.close();
+}
+
+bool DblpParser::nextBatch(std::vector<Record>& batch) {
+    bool got = batches.pop(batch);
+    if (!got) {
+        std::lock_guard<std::mutex> lock(errorMutex);
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+    return got;
+}
+
+uint64_t DblpParser::bytesRead() const {
+    return numBytes;
+}
+
+uint64_t DblpParser::entries() const {
+    return numEntries;
+}
+
+double DblpParser::seconds() const {
+    int64_t nanos = elapsedNanos;
+    if (nanos < 0) {
+        nanos = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - started).count();
+    }
+    return nanos / 1e9;
+}
+
+double DblpParser::megabytesPerSecond() const {
+    double elapsed = seconds();
+    return elapsed > 0 ? numBytes / (1024.0 * 1024.0) / elapsed : 0;
+}
+
+// take the next chunk, dropping what has been consumed
+bool DblpParser::fill() {
+    if (exhausted) {
+        return false;
+    }
+
+    std::string chunk;
+    if (!chunks.pop(chunk)) {
+        exhausted = true;
+        return false;
+    }
+
+    numBytes += chunk.size();
+    buffer.erase(0, pos);
+    pos = 0;
+    buffer += chunk;
+    return true;
+}
+
+inline int DblpParser::peek() {
+    while (pos == buffer.size()) {
+        if (!fill()) {
+            return -1;
+        }
+    }
+    return (unsigned char)buffer[pos];
+}
+
+inline int DblpParser::get() {
+    int c = peek();
+    if (c >= 0) {
+        pos++;
+    }
+    return c;
+}
+
+bool DblpParser::startsWith(const char* prefix) {
+    size_t length = strlen(prefix);
+    while (buffer.size() - pos < length) {
+        if (!fill()) {
+            return false;
+        }
+    }
+    return buffer.compare(pos, length, prefix) == 0;
+}
+
+// move past the next terminator, appending what is before it to skipped
+bool DblpParser::readPast(const char* terminator, std::string* skipped) {
+    size_t length = strlen(terminator);
+    while (true) {
+        size_t found = buffer.find(terminator, pos);
+        // keep a possible prefix of the terminator for the next chunk
+        size_t end = found != std::string::npos ? found
+            : buffer.size() - pos >= length ? buffer.size() - length + 1 : pos;
+        if (skipped) {
+            skipped->append(buffer, pos, end - pos);
+        }
+        pos = end;
+
+        if (found != std::string::npos) {
+            pos += length;
+            return true;
+        }
+        if (!fill()) {
+            if (skipped) {
+                skipped->append(buffer, pos, std::string::npos);
+            }
+            pos = buffer.size();
+            return false;
+        }
+    }
+}
+
+// after '&', decode up to ';', unknown entities are kept as they are
+void DblpParser::appendEntity(std::string& out) {
+    std::string name;
+    int c;
+    while ((c = peek()) >= 0 && c != ';' && c != '<' && c != '&' && name.size() < 32) {
+        name += char(get());
+    }
+
+    if (c != ';' || name.empty()) {
+        out += '&';
+        out += name;
+        return;
+    }
+    get();
+
+    if (name[0] == '#') {
+        char* end = nullptr;
+        unsigned long code = name.size() > 1 && (name[1] == 'x' || name[1] == 'X')
+            ? strtoul(name.c_str() + 2, &end, 16) : strtoul(name.c_str() + 1, &end, 10);
+        if (end != nullptr && *end == '\0' && code > 0 && code <= 0x10FFFF) {
+            appendUtf8(out, code);
+            return;
+        }
+    } else {
+        auto entity = dblpEntities().find(name);
+        if (entity != dblpEntities().end()) {
+            appendUtf8(out, entity->second);
+            return;
+        }
+    }
+
+    out += '&';
+    out += name;
+    out += ';';
+}
+
+std::string DblpParser::readName() {
+    std::string name;
+    int c;
+    while ((c = peek()) >= 0 && !isspace(c) && c != '>' && c != '/') {
+        name += char(get());
+    }
+    return name;
+}
+
+// after '<': read a start or end tag into name, skipping declarations,
+// comments and processing instructions (false for those)
+bool DblpParser::readTag(std::string& name, bool& closing, bool& empty) {
+    closing = false;
+    empty = false;
+
+    int c = peek();
+    if (c == '?') {
+        readPast("?>", nullptr);
+        return false;
+    }
+    if (c == '!') {
+        get();
+        if (peek() == '-') {
+            readPast("-->", nullptr);
+        } else {
+            // <!DOCTYPE ...> with an optional [internal subset]
+            int depth = 0;
+            while ((c = get()) >= 0) {
+                if (c == '[') depth++;
+                else if (c == ']') depth--;
+                else if (c == '>' && depth <= 0) break;
+            }
+        }
+        return false;
+    }
+    if (c == '/') {
+        get();
+        closing = true;
+    }
+
+    name = readName();
+
+    // attributes are not needed, skip them (quoted values may hold '>')
+    char quote = 0;
+    int last = 0;
+    while ((c = get()) >= 0) {
+        if (quote) {
+            if (c == quote) quote = 0;
+        } else if (c == '"' || c == '\'') {
+            quote = c;
+        } else if (c == '>') {
+            break;
+        }
+        last = c;
+    }
+    empty = last == '/';
+    return true;
+}
+
+void DblpParser::parse() {
+    try {
+        std::vector<Record> batch;
+        Record record;
+        std::string field;      // field being read, empty outside fields
+        std::string text;
+        int depth = 0;          // elements open, the root is depth 1
+        int skipDepth = 0;      // inside an element that is not kept if > 0
+        bool inEntry = false;
+
+        std::unordered_map<std::string, size_t> fieldIndex;
+        for (size_t i = 0; i < DBLP_FIELDS.size(); i++) {
+            fieldIndex[DBLP_FIELDS[i]] = i;
+        }
+        fieldIndex["author"] = fieldIndex["authors"];
+        fieldIndex["editor"] = fieldIndex["editors"];
+        const size_t yearField = fieldIndex["year"];
+
+        auto newRecord = [&] {
+            record.assign(DBLP_FIELDS.size(), Field());
+            record[fieldIndex["authors"]] = std::vector<std::string>();
+            record[fieldIndex["editors"]] = std::vector<std::string>();
+        };
+
+        auto endField = [&] {
+            auto index = fieldIndex.find(field);
+            if (index == fieldIndex.end()) {
+                return;
+            }
+
+            Field& value = record[index->second];
+            if (index->second == yearField) {
+                if (std::holds_alternative<std::monostate>(value)) {
+                    bool digits = !text.empty() && text.find_first_not_of("0123456789") == std::string::npos;
+                    value = digits && text.size() < 10 ? std::stoll(text) : 0LL;
+                }
+            } else if (std::vector<std::string>* list = std::get_if<std::vector<std::string>>(&value)) {
+                if (!text.empty()) {
+                    list->push_back(text);
+                }
+            } else if (std::holds_alternative<std::monostate>(value) && !text.empty()) {
+                value = text;
+            }
+        };
+
+        while (true) {
+            int c = get();
+            if (c < 0) {
+                break;
+            }
+
+            if (c != '<') {
+                // text runs up to the next markup or entity
+                size_t end = buffer.find_first_of(field.empty() ? "<" : "<&", pos);
+                end = end == std::string::npos ? buffer.size() : end;
+                if (field.empty()) {
+                    pos = end;
+                } else if (c == '&') {
+                    appendEntity(text);
+                } else {
+                    text += char(c);
+                    text.append(buffer, pos, end - pos);
+                    pos = end;
+                }
+                continue;
+            }
+
+            // CDATA inside a field is text
+            if (!field.empty() && startsWith("![CDATA[")) {
+                pos += 8;
+                readPast("]]>", &text);
+                continue;
+            }
+
+            std::string name;
+            bool closing, empty;
+            if (!readTag(name, closing, empty)) {
+                continue;
+            }
+
+            if (!closing) {
+                depth++;
+                if (skipDepth == 0 && depth == 2) {
+                    inEntry = false;
+                    for (const char* type : DBLP_ENTRY_TYPES) {
+                        inEntry |= name == type;
+                    }
+                    if (inEntry) {
+                        newRecord();
+                    } else {
+                        skipDepth = depth;
+                    }
+                } else if (inEntry && depth == 3) {
+                    field = name;
+                    text.clear();
+                }
+                if (!empty) {
+                    continue;
+                }
+            }
+
+            // an end tag, or the end of <tag/>
+            if (skipDepth == depth) {
+                skipDepth = 0;
+            } else if (inEntry && depth == 3 && !field.empty()) {
+                endField();
+                field.clear();
+            } else if (inEntry && depth == 2) {
+                inEntry = false;
+                if (std::holds_alternative<std::monostate>(record[yearField])) {
+                    record[yearField] = 0LL;
+                }
+                numEntries++;
+                batch.push_back(std::move(record));
+                if (batch.size() >= batchSize) {
+                    if (!batches.push(std::move(batch))) {
+                        break;
+                    }
+                    batch.clear();
+                }
+            }
+            depth--;
+        }
+
+        if (!batch.empty()) {
+            batches.push(std::move(batch));
+        }
+    } catch (...) {
+        fail();
+    }
+
+    elapsedNanos = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - started).count();
+    // stop the reader too if parsing ended early
+    chunks.close();
+    batches.close();
+}
+
+#endif
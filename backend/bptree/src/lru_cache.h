@@ -0,0 +1,147 @@
+/*
+    Copyright (C) 2025 Yuesong Feng
+    Copyright (C) 2025 ParaN3xus
+*/
+
+#ifndef LRU_CACHE_H
+#define LRU_CACHE_H
+
+#include <list>
+#include <mutex>
+#include <memory>
+#include <atomic>
+#include <utility>
+#include <cstdint>
+#include <unordered_map>
+
+struct CacheStats {
+    uint64_t hits;
+    uint64_t misses;
+    size_t entries;
+    size_t bytes;
+};
+
+// Least recently used values by int id, bounded by the bytes sizeOf gives
+// them. Ids are spread over shards with a lock and an LRU list each, so
+// readers of different ids rarely wait for each other; every shard keeps
+// its share of the capacity. A capacity of 0 disables the cache.
+template<typename ValT>
+class LruCache {
+public:
+    typedef size_t (*SizeOf)(const ValT&);
+
+    LruCache(size_t capacity, SizeOf sizeOf, size_t numShards = 16);
+
+    // copies the value of id into value if it is cached
+    bool get(int id, ValT& value);
+    void put(int id, const ValT& value);
+    void invalidate(int id);
+    CacheStats stats() const;
+
+private:
+    struct Shard {
+        std::mutex mutex;
+        std::list<std::pair<int, ValT>> lru;    // most recently used first
+        std::unordered_map<int, typename std::list<std::pair<int, ValT>>::iterator> entries;
+        size_t bytes = 0;
+    };
+
+    size_t shardCapacity;
+    SizeOf sizeOf;
+    size_t numShards;
+    std::unique_ptr<Shard[]> shards;
+    std::atomic<uint64_t> hits;
+    std::atomic<uint64_t> misses;
+
+    Shard& shard(int id) const;
+    void evict(Shard& shard, typename std::list<std::pair<int, ValT>>::iterator it);
+};
+
+template<typename ValT>
+LruCache<ValT>::LruCache(size_t capacity, SizeOf sizeOf, size_t numShards)
+    : shardCapacity(capacity / numShards), sizeOf(sizeOf), numShards(numShards),
+    shards(new Shard[numShards]), hits(0), misses(0) {}
+
+template<typename ValT>
+typename LruCache<ValT>::Shard& LruCache<ValT>::shard(int id) const {
+    // consecutive ids, often read together, go to different shards
+    return shards[(uint32_t(id) * 2654435761u >> 16) % numShards];
+}
+
+template<typename ValT>
+void LruCache<ValT>::evict(Shard& shard, typename std::list<std::pair<int, ValT>>::iterator it) {
+    shard.bytes -= sizeOf(it->second);
+    shard.entries.erase(it->first);
+    shard.lru.erase(it);
+}
+
+template<typename ValT>
+bool LruCache<ValT>::get(int id, ValT& value) {
+    if (shardCapacity == 0) {
+        return false;
+    }
+
+    Shard& shard = this->shard(id);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+
+    auto it = shard.entries.find(id);
+    if (it == shard.entries.end()) {
+        misses++;
+        return false;
+    }
+    shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+    value = it->second->second;
+    hits++;
+    return true;
+}
+
+template<typename ValT>
+void LruCache<ValT>::put(int id, const ValT& value) {
+    size_t size = sizeOf(value);
+    if (size > shardCapacity) {
+        return;
+    }
+
+    Shard& shard = this->shard(id);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+
+    auto it = shard.entries.find(id);
+    if (it != shard.entries.end()) {
+        evict(shard, it->second);
+    }
+    while (shard.bytes + size > shardCapacity) {
+        evict(shard, std::prev(shard.lru.end()));
+    }
+
+    shard.lru.emplace_front(id, value);
+    shard.entries.emplace(id, shard.lru.begin());
+    shard.bytes += size;
+}
+
+template<typename ValT>
+void LruCache<ValT>::invalidate(int id) {
+    if (shardCapacity == 0) {
+        return;
+    }
+
+    Shard& shard = this->shard(id);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+
+    auto it = shard.entries.find(id);
+    if (it != shard.entries.end()) {
+        evict(shard, it->second);
+    }
+}
+
+template<typename ValT>
+CacheStats LruCache<ValT>::stats() const {
+    CacheStats stats{ hits, misses, 0, 0 };
+    for (size_t i = 0; i < numShards; i++) {
+        std::lock_guard<std::mutex> lock(shards[i].mutex);
+        stats.entries += shards[i].entries.size();
+        stats.bytes += shards[i].bytes;
+    }
+    return stats;
+}
+
+#endif
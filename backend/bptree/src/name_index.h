@@ -0,0 +1,244 @@
+/*
+    Copyright (C) 2025 Yuesong Feng
+    Copyright (C) 2025 ParaN3xus
+*/
+
+#ifndef NAME_INDEX_H
+#define NAME_INDEX_H
+
+#include <vector>
+#include <string>
+#include <string_view>
+#include <cstdint>
+#include <mutex>
+#include <utility>
+#include <algorithm>
+#include <unordered_map>
+
+#include "string_dict.h"
+#include "tokenizer.h"
+
+// Approximate lookup of the names of a StringDict. Names are compared in
+// a folded form: lowercase, Latin letters without diacritics, the DBLP
+// disambiguation number (" 0001") dropped and anything but letters and
+// digits as one space. Every folded name is split into trigrams, padded
+// so the ends count, with the ids of the names of each trigram in a
+// sorted list.
+//
+// A name within edit distance d of the query shares all but at most 3d
+// of its trigrams, so only names in enough of the lists are candidates,
+// and those are found from the shortest lists; the distance of each
+// candidate is computed to keep the real matches. Names interned since
+// the last search are indexed when the next one starts.
+class NameIndex {
+public:
+    // (id, edit distance) of the up to limit names closest to name within
+    // maxDistance, by distance, ties by id; only ids below numIds count
+    std::vector<std::pair<int, int>> search(const StringDict& dict, const std::string& name,
+        int maxDistance, size_t limit, size_t numIds = SIZE_MAX);
+
+    // forgets the indexed names, for a dict that was cleared
+    void clear();
+
+    static std::u32string fold(std::string_view name);
+
+private:
+    std::vector<std::u32string> folded;     // by id
+    std::unordered_map<uint64_t, uint32_t> trigramIds;
+    std::vector<std::vector<int>> postings; // by trigram id, ascending
+    std::vector<uint16_t> counts;   // by id, zero between searches
+    std::mutex mutex;
+
+    static std::vector<uint64_t> trigrams(const std::u32string& folded);
+    static int distance(const std::u32string& a, const std::u32string& b, int maxDistance);
+    void update(const StringDict& dict);
+};
+
+std::u32string NameIndex::fold(std::string_view name) {
+    // base letters of U+00C0..U+017F
+    static constexpr std::string_view LATIN =
+        "aaaaaaaceeeeiiiidnooooo ouuuuyts" "aaaaaaaceeeeiiiidnooooo ouuuuyty"
+        "aaaaaaccccccccddddeeeeeeeeeegggggggghhhhiiiiiiiiiiiijjkkkllllllllll"
+        "nnnnnnnnnoooooooorrrrrrssssssssttttttuuuuuuuuuuuuwwyyyzzzzzzs";
+    static_assert(LATIN.size() == 0x180 - 0xC0, "one letter per character");
+
+    std::u32string text = tokenizer::lower(tokenizer::decodeUtf8(std::string(name)));
+
+    // the disambiguation number of DBLP, e.g. "Wei Wang 0001"
+    size_t end = text.size();
+    size_t digits = 0;
+    while (digits < end && tokenizer::isDecimal(text[end - 1 - digits])) {
+        digits++;
+    }
+    if (digits == 4 && end > 4 && tokenizer::isSpace(text[end - 5])) {
+        end -= 5;
+    }
+
+    std::u32string result;
+    bool space = false;
+    for (size_t i = 0; i < end; i++) {
+        char32_t c = text[i];
+        if (c >= 0x300 && c < 0x370) {
+            // combining marks
+            continue;
+        }
+        if (c >= 0xC0 && c < 0x180) {
+            c = char32_t(LATIN[c - 0xC0]);
+        }
+        if (!tokenizer::isAlnum(c)) {
+            space = !result.empty();
+            continue;
+        }
+        if (space) {
+            result += U' ';
+            space = false;
+        }
+        result += c;
+    }
+    return result;
+}
+
+std::vector<uint64_t> NameIndex::trigrams(const std::u32string& folded) {
+    // two spaces before and one after, so a name of n characters has n + 1
+    std::u32string padded = U"  " + folded + U" ";
+    std::vector<uint64_t> result;
+    for (size_t i = 0; i + 3 <= padded.size(); i++) {
+        result.push_back(uint64_t(padded[i]) << 42 | uint64_t(padded[i + 1]) << 21 | uint64_t(padded[i + 2]));
+    }
+    std::sort(result.begin(), result.end());
+    result.erase(std::unique(result.begin(), result.end()), result.end());
+    return result;
+}
+
+// edit distance of a and b, or maxDistance + 1 if it is more than that
+int NameIndex::distance(const std::u32string& a, const std::u32string& b, int maxDistance) {
+    int n = a.size();
+    int m = b.size();
+    if (std::abs(n - m) > maxDistance) {
+        return maxDistance + 1;
+    }
+
+    // only cells within maxDistance of the diagonal can stay in range
+    const int OUT = maxDistance + 1;
+    std::vector<int> previous(m + 1), current(m + 1);
+    for (int j = 0; j <= m; j++) {
+        previous[j] = std::min(j, OUT);
+    }
+    for (int i = 1; i <= n; i++) {
+        int first = std::max(1, i - maxDistance);
+        int last = std::min(m, i + maxDistance);
+        current[first - 1] = first == 1 ? std::min(i, OUT) : OUT;
+        int best = current[first - 1];
+        for (int j = first; j <= last; j++) {
+            int cost = previous[j - 1] + (a[i - 1] != b[j - 1]);
+            cost = std::min(cost, previous[j] + 1);
+            cost = std::min(cost, current[j - 1] + 1);
+            current[j] = std::min(cost, OUT);
+            best = std::min(best, current[j]);
+        }
+        if (last < m) {
+            current[last + 1] = OUT;
+        }
+        if (best > maxDistance) {
+            return OUT;
+        }
+        std::swap(previous, current);
+    }
+    return previous[m];
+}
+
+void NameIndex::update(const StringDict& dict) {
+    for (size_t id = folded.size(); id < dict.size(); id++) {
+        folded.push_back(fold(dict.at(id)));
+        for (uint64_t trigram : trigrams(folded.back())) {
+            auto it = trigramIds.emplace(trigram, uint32_t(postings.size())).first;
+            if (it->second == postings.size()) {
+                postings.emplace_back();
+            }
+            postings[it->second].push_back(int(id));
+        }
+    }
+}
+
+void NameIndex::clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+    folded.clear();
+    trigramIds.clear();
+    postings.clear();
+    counts.clear();
+}
+
+std::vector<std::pair<int, int>> NameIndex::search(const StringDict& dict, const std::string& name,
+    int maxDistance, size_t limit, size_t numIds) {
+    std::lock_guard<std::mutex> lock(mutex);
+    update(dict);
+
+    std::vector<std::pair<int, int>> result;
+    std::u32string query = fold(name);
+    if (query.empty() || limit == 0 || maxDistance < 0) {
+        return result;
+    }
+
+    std::vector<const std::vector<int>*> lists;
+    std::vector<uint64_t> queryTrigrams = trigrams(query);
+    for (uint64_t trigram : queryTrigrams) {
+        auto it = trigramIds.find(trigram);
+        if (it != trigramIds.end()) {
+            lists.push_back(&postings[it->second]);
+        }
+    }
+    std::sort(lists.begin(), lists.end(), [](const std::vector<int>* a, const std::vector<int>* b) {
+        return a->size() < b->size();
+    });
+
+    // a match has at least needed of the query trigrams; short queries
+    // with a large distance still need one
+    int needed = std::max<int>(1, int(queryTrigrams.size()) - 3 * maxDistance);
+    if (int(lists.size()) < needed) {
+        return result;
+    }
+
+    // a match is in at least one of the lists.size() - needed + 1
+    // shortest lists; the longer ones are only searched for candidates
+    size_t shortLists = lists.size() - needed + 1;
+    std::vector<int> candidates;
+    counts.resize(folded.size(), 0);
+    for (size_t i = 0; i < shortLists; i++) {
+        for (int id : *lists[i]) {
+            if (counts[id]++ == 0) {
+                candidates.push_back(id);
+            }
+        }
+    }
+
+    for (int id : candidates) {
+        int count = counts[id];
+        counts[id] = 0;
+        if (size_t(id) >= numIds || std::abs(int(folded[id].size()) - int(query.size())) > maxDistance) {
+            continue;
+        }
+        for (size_t i = shortLists; i < lists.size() && count < needed; i++) {
+            count += std::binary_search(lists[i]->begin(), lists[i]->end(), id);
+        }
+        if (count < needed) {
+            continue;
+        }
+        int d = distance(query, folded[id], maxDistance);
+        if (d <= maxDistance) {
+            result.emplace_back(id, d);
+        }
+    }
+
+    auto closer = [](const std::pair<int, int>& a, const std::pair<int, int>& b) {
+        return a.second != b.second ? a.second < b.second : a.first < b.first;
+    };
+    if (result.size() > limit) {
+        std::partial_sort(result.begin(), result.begin() + limit, result.end(), closer);
+        result.resize(limit);
+    } else {
+        std::sort(result.begin(), result.end(), closer);
+    }
+    return result;
+}
+
+#endif
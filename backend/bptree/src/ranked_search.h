@@ -0,0 +1,168 @@
+/*
+    Copyright (C) 2025 Yuesong Feng
+    Copyright (C) 2025 ParaN3xus
+*/
+
+#ifndef RANKED_SEARCH_H
+#define RANKED_SEARCH_H
+
+#include <vector>
+#include <queue>
+#include <cmath>
+#include <algorithm>
+#include <utility>
+#include <limits>
+
+#include "column_store.h"
+
+struct ScoredId {
+    int id;
+    double score;
+};
+
+// The k articles with the best BM25 score for the keywords, best first,
+// ties by smaller id. Postings come from a keyword id -> [article id]
+// index (a BPTree or a snapshot of one); an article holds a keyword once,
+// so every term frequency is 1 and the document length is the number of
+// keywords of the title in columns. The number of articles and their
+// average length are those of columns unless given (above 0), so they can
+// be those of the articles keywordIndex holds.
+//
+// Evaluated with MaxScore: keywords are sorted by the most they can add
+// to a score, and the lists of the cheapest keywords, which together
+// cannot lift an article into the top k, are only probed for the
+// articles the other lists bring up.
+template<typename Index>
+std::vector<ScoredId> searchBm25(Index& keywordIndex, const ColumnStore& columns,
+    std::vector<int> keywordIds, size_t k, double k1 = 1.2, double b = 0.75,
+    size_t numArticles = 0, double averageKeywords = 0) {
+    std::vector<ScoredId> result;
+    std::sort(keywordIds.begin(), keywordIds.end());
+    keywordIds.erase(std::unique(keywordIds.begin(), keywordIds.end()), keywordIds.end());
+    if (numArticles == 0) {
+        numArticles = columns.size();
+    }
+    if (averageKeywords <= 0) {
+        averageKeywords = columns.averageKeywordCount();
+    }
+    if (k == 0 || numArticles == 0) {
+        return result;
+    }
+
+    struct Term {
+        std::vector<int> postings;  // ascending
+        double idf;
+        double maxScore;
+        size_t position = 0;
+    };
+
+    double articles = double(numArticles);
+    double averageLength = std::max(averageKeywords, 1.0);
+    // what a keyword adds to the score of an article with length keywords
+    auto weight = [&](double idf, size_t length) {
+        return idf * (k1 + 1) / (1 + k1 * (1 - b + b * double(length) / averageLength));
+    };
+
+    std::vector<Term> terms;
+    for (int keywordId : keywordIds) {
+        std::vector<int>* postings = keywordId < 0 ? nullptr : keywordIndex.find(keywordId);
+        if (!postings || postings->empty()) {
+            continue;
+        }
+        Term term;
+        term.postings = *postings;
+        if (!std::is_sorted(term.postings.begin(), term.postings.end())) {
+            std::sort(term.postings.begin(), term.postings.end());
+        }
+        double df = double(term.postings.size());
+        term.idf = std::log(1 + (articles - df + 0.5) / (df + 0.5));
+        // the shortest title has one keyword
+        term.maxScore = weight(term.idf, 1);
+        terms.push_back(std::move(term));
+    }
+    if (terms.empty()) {
+        return result;
+    }
+
+    std::sort(terms.begin(), terms.end(), [](const Term& x, const Term& y) {
+        return x.maxScore < y.maxScore;
+    });
+    // bound[i]: the most terms 0..i together add
+    std::vector<double> bound(terms.size());
+    for (size_t i = 0; i < terms.size(); i++) {
+        bound[i] = terms[i].maxScore + (i > 0 ? bound[i - 1] : 0.0);
+    }
+
+    // the top k so far, the worst on top
+    auto worse = [](const ScoredId& x, const ScoredId& y) {
+        return x.score != y.score ? x.score > y.score : x.id < y.id;
+    };
+    std::priority_queue<ScoredId, std::vector<ScoredId>, decltype(worse)> top(worse);
+    double threshold = 0;
+    // terms before essential cannot bring an article into the top k alone
+    size_t essential = 0;
+
+    const int END = std::numeric_limits<int>::max();
+    auto current = [&terms, END](size_t i) {
+        const Term& term = terms[i];
+        return term.position < term.postings.size() ? term.postings[term.position] : END;
+    };
+
+    while (essential < terms.size()) {
+        int id = END;
+        for (size_t i = essential; i < terms.size(); i++) {
+            id = std::min(id, current(i));
+        }
+        if (id == END) {
+            break;
+        }
+
+        size_t length = columns.keywordCount(id);
+        double score = 0;
+        for (size_t i = essential; i < terms.size(); i++) {
+            if (current(i) == id) {
+                score += weight(terms[i].idf, length);
+                terms[i].position++;
+            }
+        }
+        // the other lists are probed while they can still matter; articles
+        // come in id order, so one tying the k-th is never better
+        for (size_t i = essential; i-- > 0;) {
+            if (top.size() == k && score + bound[i] <= threshold) {
+                break;
+            }
+            Term& term = terms[i];
+            term.position = std::lower_bound(term.postings.begin() + term.position, term.postings.end(), id)
+                - term.postings.begin();
+            if (current(i) == id) {
+                score += weight(term.idf, length);
+            }
+        }
+
+        if (top.size() < k) {
+            top.push({ id, score });
+        }
+        else if (score > threshold) {
+            top.pop();
+            top.push({ id, score });
+        }
+        else {
+            continue;
+        }
+        if (top.size() == k) {
+            threshold = top.top().score;
+            while (essential < terms.size() && bound[essential] <= threshold) {
+                essential++;
+            }
+        }
+    }
+
+    result.resize(top.size());
+    for (size_t i = result.size(); i-- > 0;) {
+        result[i] = top.top();
+        top.pop();
+    }
+    return result;
+}
+
+#endif
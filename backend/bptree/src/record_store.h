@@ -0,0 +1,643 @@
+/*
+    Copyright (C) 2025 Yuesong Feng
+    Copyright (C) 2025 ParaN3xus
+*/
+
+#ifndef RECORD_STORE_H
+#define RECORD_STORE_H
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <variant>
+#include <optional>
+#include <mutex>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <cerrno>
+#include <algorithm>
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "lru_cache.h"
+
+// A record is a list of fields, each null, an integer, a string or a list
+// of strings. What the fields mean is up to the caller.
+typedef std::variant<std::monostate, long long, std::string, std::vector<std::string>> Field;
+typedef std::vector<Field> Record;
+
+// Records are appended to segment files records_<n>.seg as
+//
+//   uint32 payload length, int32 id, payload
+//
+// where the payload is a uint16 field count and, for every field, a uint8
+// type followed by an int64, a uint32 length and the bytes of a string, or a
+// uint32 count and that many strings. Putting an id again appends a new
+// version, the old bytes are left behind.
+//
+// records.idx holds a dense id -> (segment, offset) array. It is rewritten
+// by flush(); records appended after the last flush are found again by
+// scanning the segments past the point the index covers.
+//
+// Decoded records are kept in an LRU cache of cacheSize bytes in front of
+// the segments, put() drops the cached version of its id.
+class RecordStore {
+public:
+    RecordStore(const std::string& directory, size_t maxSegmentSize = 256 * 1024 * 1024,
+        size_t cacheSize = 64 * 1024 * 1024);
+    ~RecordStore();
+
+    RecordStore(const RecordStore&) = delete;
+    RecordStore& operator=(const RecordStore&) = delete;
+
+    void put(int id, const Record& record);
+    std::optional<Record> get(int id);
+    std::vector<std::optional<Record>> getMany(const std::vector<int>& ids);
+    bool contains(int id);
+    size_t size();
+    std::vector<int> ids();
+    void flush();
+    // drops every record and removes the segments and the index
+    void clear();
+    CacheStats cacheStats() const;
+
+private:
+    enum FieldType : uint8_t { NONE = 0, INT = 1, STRING = 2, STRING_LIST = 3 };
+
+    struct Location {
+        uint32_t segment;   // NO_SEGMENT if the id has no record
+        uint32_t offset;
+    };
+
+    struct Segment {
+        std::string path;
+        const char* data;   // mapping of the first mappedSize bytes
+        size_t mappedSize;
+        size_t fileSize;
+    };
+
+    struct IndexHeader {
+        char magic[8];
+        uint32_t version;
+        uint32_t numSegments;       // segments the index covers
+        uint64_t lastSegmentSize;   // bytes of the last of them it covers
+        uint64_t numIds;
+    };
+
+    static constexpr uint32_t NO_SEGMENT = UINT32_MAX;
+    static constexpr uint32_t INDEX_VERSION = 1;
+    static constexpr size_t RECORD_HEADER_SIZE = 2 * sizeof(uint32_t);
+    // appended bytes read with pread before a segment is mapped again
+    static constexpr size_t MIN_REMAP_SIZE = 4 * 1024 * 1024;
+
+    std::string directory;
+    size_t maxSegmentSize;
+    std::vector<Location> locations;
+    std::vector<Segment> segments;
+    size_t numRecords;
+    int activeFd;   // append descriptor of the last segment
+    std::mutex mutex;
+    LruCache<Record> cache;
+
+    std::string segmentPath(size_t segment) const;
+    std::string indexPath() const;
+    void openActiveSegment();
+    void loadIndex(uint32_t* numSegments, uint64_t* lastSegmentSize);
+    void scanSegment(uint32_t segment, uint64_t from);
+    void setLocation(int id, Location location);
+    const char* recordAt(Location location, std::string& buffer);
+    std::optional<Record> getLocked(int id);
+
+    static size_t recordSize(const Record& record);
+    static void encode(const Record& record, std::string& out);
+    static Record decode(const char* payload, size_t length);
+};
+
+template<typename T>
+inline void appendValue(std::string& out, T value) {
+    out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template<typename T>
+inline T readValue(const char*& position, const char* end) {
+    if (position + sizeof(T) > end) {
+        throw std::runtime_error("record is truncated");
+    }
+    T value;
+    memcpy(&value, position, sizeof(T));
+    position += sizeof(T);
+    return value;
+}
+
+// pread of exactly length bytes at offset
+inline bool readAt(int fd, char* data, size_t length, uint64_t offset) {
+    while (length > 0) {
+        ssize_t result = pread(fd, data, length, offset);
+        if (result < 0 && errno == EINTR) {
+            continue;
+        }
+        if (result <= 0) {
+            return false;
+        }
+        data += result;
+        length -= result;
+        offset += result;
+    }
+    return true;
+}
+
+inline std::string readString(const char*& position, const char* end) {
+    uint32_t length = readValue<uint32_t>(position, end);
+    if (position + length > end) {
+        throw std::runtime_error("record is truncated");
+    }
+    std::string value(position, length);
+    position += length;
+    return value;
+}
+
+RecordStore::RecordStore(const std::string& directory, size_t maxSegmentSize, size_t cacheSize)
+    : directory(directory), maxSegmentSize(maxSegmentSize), numRecords(0), activeFd(-1),
+    cache(cacheSize, &RecordStore::recordSize) {
+    mkdir(directory.c_str(), 0755);
+
+    for (size_t i = 0;; i++) {
+        struct stat st;
+        std::string path = segmentPath(i);
+        if (stat(path.c_str(), &st) != 0) {
+            break;
+        }
+        segments.push_back(Segment{ path, nullptr, 0, size_t(st.st_size) });
+    }
+
+    uint32_t indexedSegments = 0;
+    uint64_t lastSegmentSize = 0;
+    loadIndex(&indexedSegments, &lastSegmentSize);
+
+    // records appended after the index was last flushed
+    for (uint32_t i = indexedSegments == 0 ? 0 : indexedSegments - 1; i < segments.size(); i++) {
+        scanSegment(i, i + 1 == indexedSegments ? lastSegmentSize : 0);
+    }
+
+    if (segments.empty()) {
+        segments.push_back(Segment{ segmentPath(0), nullptr, 0, 0 });
+    }
+    openActiveSegment();
+}
+
+RecordStore::~RecordStore() {
+    flush();
+    for (Segment& segment : segments) {
+        if (segment.data) {
+            munmap(const_cast<char*>(segment.data), segment.mappedSize);
+        }
+    }
+    if (activeFd >= 0) {
+        close(activeFd);
+    }
+}
+
+std::string RecordStore::segmentPath(size_t segment) const {
+    return directory + "/records_" + std::to_string(segment) + ".seg";
+}
+
+std::string RecordStore::indexPath() const {
+    return directory + "/records.idx";
+}
+
+void RecordStore::openActiveSegment() {
+    if (activeFd >= 0) {
+        close(activeFd);
+    }
+    activeFd = open(segments.back().path.c_str(), O_WRONLY | O_APPEND | O_CREAT, 0644);
+    if (activeFd < 0) {
+        throw std::runtime_error("cannot open " + segments.back().path + " for writing");
+    }
+}
+
+void RecordStore::loadIndex(uint32_t* numSegments, uint64_t* lastSegmentSize) {
+    std::ifstream infile(indexPath(), std::ios::binary);
+    if (!infile) {
+        return;
+    }
+
+    IndexHeader header;
+    infile.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (!infile || memcmp(header.magic, "RECIDX", 7) != 0 || header.version != INDEX_VERSION
+        || header.numSegments > segments.size()) {
+        std::cerr << "Ignoring invalid record index " << indexPath() << ", rebuilding it" << std::endl;
+        return;
+    }
+
+    infile.seekg(0, std::ios::end);
+    uint64_t fileSize = infile.tellg();
+    if ((fileSize - sizeof(header)) % sizeof(Location) != 0
+        || header.numIds != (fileSize - sizeof(header)) / sizeof(Location)) {
+        std::cerr << "Record index " << indexPath() << " is truncated, rebuilding it" << std::endl;
+        return;
+    }
+    infile.seekg(sizeof(header));
+
+    locations.resize(header.numIds);
+    infile.read(reinterpret_cast<char*>(locations.data()), header.numIds * sizeof(Location));
+    if (!infile) {
+        std::cerr << "Record index " << indexPath() << " is truncated, rebuilding it" << std::endl;
+        locations.clear();
+        return;
+    }
+
+    // a stale index may point past what the segments hold now
+    bool valid = header.numSegments == 0
+        || header.lastSegmentSize <= segments[header.numSegments - 1].fileSize;
+    for (size_t id = 0; valid && id < locations.size(); id++) {
+        const Location& location = locations[id];
+        if (location.segment == NO_SEGMENT) {
+            continue;
+        }
+        uint64_t end = location.segment + 1 == header.numSegments
+            ? header.lastSegmentSize : location.segment < header.numSegments
+            ? segments[location.segment].fileSize : 0;
+        valid = uint64_t(location.offset) + RECORD_HEADER_SIZE <= end;
+    }
+    if (!valid) {
+        std::cerr << "Record index " << indexPath() << " does not match the segments, rebuilding it"
+            << std::endl;
+        locations.clear();
+        return;
+    }
+
+    for (const Location& location : locations) {
+        if (location.segment != NO_SEGMENT) {
+            numRecords++;
+        }
+    }
+
+    *numSegments = header.numSegments;
+    *lastSegmentSize = header.lastSegmentSize;
+}
+
+void RecordStore::scanSegment(uint32_t segment, uint64_t from) {
+    std::ifstream infile(segments[segment].path, std::ios::binary);
+    infile.seekg(from);
+
+    uint64_t offset = from;
+    while (offset + RECORD_HEADER_SIZE <= segments[segment].fileSize) {
+        uint32_t length;
+        int32_t id;
+        infile.read(reinterpret_cast<char*>(&length), sizeof(length));
+        infile.read(reinterpret_cast<char*>(&id), sizeof(id));
+
+        if (!infile || offset + RECORD_HEADER_SIZE + length > segments[segment].fileSize) {
+            break;
+        }
+
+        setLocation(id, Location{ segment, uint32_t(offset) });
+        offset += RECORD_HEADER_SIZE + length;
+        infile.seekg(offset);
+    }
+
+    // a record cut short by a crash, drop it so that appends stay aligned
+    if (offset < segments[segment].fileSize) {
+        std::cerr << "Truncating partial record at " << segments[segment].path << ":" << offset << std::endl;
+        if (truncate(segments[segment].path.c_str(), offset) != 0) {
+            throw std::runtime_error("cannot truncate " + segments[segment].path);
+        }
+        segments[segment].fileSize = offset;
+    }
+}
+
+void RecordStore::setLocation(int id, Location location) {
+    if (id < 0) {
+        throw std::invalid_argument("record ids must not be negative");
+    }
+    if (size_t(id) >= locations.size()) {
+        locations.resize(size_t(id) + 1, Location{ NO_SEGMENT, 0 });
+    }
+    if (locations[id].segment == NO_SEGMENT) {
+        numRecords++;
+    }
+    locations[id] = location;
+}
+
+void RecordStore::put(int id, const Record& record) {
+    std::string buffer;
+    appendValue<uint32_t>(buffer, 0);
+    appendValue<int32_t>(buffer, id);
+    encode(record, buffer);
+
+    uint32_t length = buffer.size() - RECORD_HEADER_SIZE;
+    memcpy(&buffer[0], &length, sizeof(length));
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (id < 0) {
+        throw std::invalid_argument("record ids must not be negative");
+    }
+
+    if (segments.back().fileSize > 0 && segments.back().fileSize + buffer.size() > maxSegmentSize) {
+        segments.push_back(Segment{ segmentPath(segments.size()), nullptr, 0, 0 });
+        openActiveSegment();
+    }
+
+    Segment& segment = segments.back();
+    if (segment.fileSize + buffer.size() > UINT32_MAX) {
+        throw std::runtime_error("record does not fit in a segment");
+    }
+
+    size_t written = 0;
+    while (written < buffer.size()) {
+        ssize_t result = write(activeFd, buffer.data() + written, buffer.size() - written);
+        if (result < 0) {
+            throw std::runtime_error("cannot write to " + segment.path);
+        }
+        written += result;
+    }
+
+    setLocation(id, Location{ uint32_t(segments.size() - 1), uint32_t(segment.fileSize) });
+    segment.fileSize += buffer.size();
+    cache.invalidate(id);
+}
+
+// the record header at location, in the mapping of its segment or, for a
+// record appended since the segment was mapped, read into buffer. The
+// segment is mapped again only once the part appended since is large, so
+// reads between appends don't map it every time.
+const char* RecordStore::recordAt(Location location, std::string& buffer) {
+    Segment& segment = segments[location.segment];
+    uint64_t offset = location.offset;
+    if (offset + RECORD_HEADER_SIZE > segment.fileSize) {
+        throw std::runtime_error("record location past the end of " + segment.path);
+    }
+
+    size_t unmapped = segment.fileSize - segment.mappedSize;
+    if (!segment.data || unmapped > std::max(segment.mappedSize / 2, MIN_REMAP_SIZE)) {
+        if (segment.data) {
+            munmap(const_cast<char*>(segment.data), segment.mappedSize);
+            segment.data = nullptr;
+            segment.mappedSize = 0;
+        }
+
+        int fd = open(segment.path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw std::runtime_error("cannot open " + segment.path);
+        }
+        void* data = mmap(nullptr, segment.fileSize, PROT_READ, MAP_SHARED, fd, 0);
+        close(fd);
+        if (data == MAP_FAILED) {
+            throw std::runtime_error("cannot map " + segment.path);
+        }
+
+        segment.data = static_cast<const char*>(data);
+        segment.mappedSize = segment.fileSize;
+    }
+
+    uint32_t length;
+    if (offset + RECORD_HEADER_SIZE <= segment.mappedSize) {
+        memcpy(&length, segment.data + offset, sizeof(length));
+        if (offset + RECORD_HEADER_SIZE + length > segment.fileSize) {
+            throw std::runtime_error("record at " + segment.path + ":" + std::to_string(offset)
+                + " is truncated");
+        }
+        if (offset + RECORD_HEADER_SIZE + length <= segment.mappedSize) {
+            return segment.data + offset;
+        }
+    }
+
+    // past the mapping, read with a single pread once the length is known
+    int fd = open(segment.path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("cannot open " + segment.path);
+    }
+    buffer.resize(RECORD_HEADER_SIZE);
+    bool ok = readAt(fd, &buffer[0], RECORD_HEADER_SIZE, offset);
+    if (ok) {
+        memcpy(&length, buffer.data(), sizeof(length));
+        ok = offset + RECORD_HEADER_SIZE + length <= segment.fileSize;
+    }
+    if (ok) {
+        buffer.resize(RECORD_HEADER_SIZE + length);
+        ok = readAt(fd, &buffer[RECORD_HEADER_SIZE], length, offset + RECORD_HEADER_SIZE);
+    }
+    close(fd);
+    if (!ok) {
+        throw std::runtime_error("record at " + segment.path + ":" + std::to_string(offset)
+            + " is truncated");
+    }
+    return buffer.data();
+}
+
+std::optional<Record> RecordStore::getLocked(int id) {
+    if (id < 0 || size_t(id) >= locations.size() || locations[id].segment == NO_SEGMENT) {
+        return std::nullopt;
+    }
+
+    std::string buffer;
+    const char* header = recordAt(locations[id], buffer);
+    uint32_t length;
+    memcpy(&length, header, sizeof(length));
+
+    // cached under the store lock, so a put() of the id can't be overtaken
+    Record record = decode(header + RECORD_HEADER_SIZE, length);
+    cache.put(id, record);
+    return record;
+}
+
+std::optional<Record> RecordStore::get(int id) {
+    Record record;
+    if (cache.get(id, record)) {
+        return record;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    return getLocked(id);
+}
+
+std::vector<std::optional<Record>> RecordStore::getMany(const std::vector<int>& ids) {
+    std::vector<std::optional<Record>> result(ids.size());
+    std::vector<size_t> missed;
+    for (size_t i = 0; i < ids.size(); i++) {
+        Record record;
+        if (cache.get(ids[i], record)) {
+            result[i] = std::move(record);
+        } else {
+            missed.push_back(i);
+        }
+    }
+
+    if (!missed.empty()) {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (size_t i : missed) {
+            result[i] = getLocked(ids[i]);
+        }
+    }
+    return result;
+}
+
+bool RecordStore::contains(int id) {
+    std::lock_guard<std::mutex> lock(mutex);
+    return id >= 0 && size_t(id) < locations.size() && locations[id].segment != NO_SEGMENT;
+}
+
+size_t RecordStore::size() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return numRecords;
+}
+
+std::vector<int> RecordStore::ids() {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    std::vector<int> result;
+    result.reserve(numRecords);
+    for (size_t id = 0; id < locations.size(); id++) {
+        if (locations[id].segment != NO_SEGMENT) {
+            result.push_back(id);
+        }
+    }
+    return result;
+}
+
+void RecordStore::flush() {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (activeFd >= 0) {
+        fsync(activeFd);
+    }
+
+    IndexHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, "RECIDX", 7);
+    header.version = INDEX_VERSION;
+    header.numSegments = segments.size();
+    header.lastSegmentSize = segments.back().fileSize;
+    header.numIds = locations.size();
+
+    std::string tempPath = indexPath() + ".tmp";
+    std::ofstream outfile(tempPath, std::ios::binary | std::ios::trunc);
+    if (!outfile) {
+        std::cerr << "Error opening file for writing!" << std::endl;
+        return;
+    }
+
+    outfile.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    outfile.write(reinterpret_cast<const char*>(locations.data()), locations.size() * sizeof(Location));
+    outfile.close();
+
+    if (!outfile || std::rename(tempPath.c_str(), indexPath().c_str()) != 0) {
+        std::cerr << "Error writing record index " << indexPath() << std::endl;
+        std::remove(tempPath.c_str());
+    }
+}
+
+void RecordStore::clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    for (size_t id = 0; id < locations.size(); id++) {
+        if (locations[id].segment != NO_SEGMENT) {
+            cache.invalidate(id);
+        }
+    }
+    locations.clear();
+    numRecords = 0;
+
+    // the index goes first, segments without one are scanned again
+    std::remove(indexPath().c_str());
+    for (Segment& segment : segments) {
+        if (segment.data) {
+            munmap(const_cast<char*>(segment.data), segment.mappedSize);
+        }
+        std::remove(segment.path.c_str());
+    }
+    segments.assign(1, Segment{ segmentPath(0), nullptr, 0, 0 });
+    openActiveSegment();
+}
+
+CacheStats RecordStore::cacheStats() const {
+    return cache.stats();
+}
+
+// approximate memory of a decoded record
+size_t RecordStore::recordSize(const Record& record) {
+    size_t size = sizeof(Record) + record.size() * sizeof(Field);
+    for (const Field& field : record) {
+        if (const std::string* value = std::get_if<std::string>(&field)) {
+            size += value->capacity();
+        }
+        else if (const std::vector<std::string>* values = std::get_if<std::vector<std::string>>(&field)) {
+            for (const std::string& value : *values) {
+                size += sizeof(std::string) + value.capacity();
+            }
+        }
+    }
+    return size;
+}
+
+void RecordStore::encode(const Record& record, std::string& out) {
+    appendValue<uint16_t>(out, record.size());
+
+    for (const Field& field : record) {
+        if (std::holds_alternative<long long>(field)) {
+            appendValue<uint8_t>(out, INT);
+            appendValue<int64_t>(out, std::get<long long>(field));
+        }
+        else if (std::holds_alternative<std::string>(field)) {
+            const std::string& value = std::get<std::string>(field);
+            appendValue<uint8_t>(out, STRING);
+            appendValue<uint32_t>(out, value.size());
+            out.append(value);
+        }
+        else if (std::holds_alternative<std::vector<std::string>>(field)) {
+            const std::vector<std::string>& values = std::get<std::vector<std::string>>(field);
+            appendValue<uint8_t>(out, STRING_LIST);
+            appendValue<uint32_t>(out, values.size());
+            for (const std::string& value : values) {
+                appendValue<uint32_t>(out, value.size());
+                out.append(value);
+            }
+        }
+        else {
+            appendValue<uint8_t>(out, NONE);
+        }
+    }
+}
+
+Record RecordStore::decode(const char* payload, size_t length) {
+    const char* position = payload;
+    const char* end = payload + length;
+
+    uint16_t numFields = readValue<uint16_t>(position, end);
+    Record record(numFields);
+
+    for (uint16_t i = 0; i < numFields; i++) {
+        switch (readValue<uint8_t>(position, end)) {
+        case INT:
+            record[i] = (long long)readValue<int64_t>(position, end);
+            break;
+        case STRING:
+            record[i] = readString(position, end);
+            break;
+        case STRING_LIST: {
+            uint32_t count = readValue<uint32_t>(position, end);
+            std::vector<std::string> values;
+            values.reserve(count);
+            for (uint32_t j = 0; j < count; j++) {
+                values.push_back(readString(position, end));
+            }
+            record[i] = std::move(values);
+            break;
+        }
+        case NONE:
+            break;
+        default:
+            throw std::runtime_error("record has an unknown field type");
+        }
+    }
+
+    return record;
+}
+
+#endif
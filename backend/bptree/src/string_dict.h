@@ -0,0 +1,218 @@
+/*
+    Copyright (C) 2025 Yuesong Feng
+    Copyright (C) 2025 ParaN3xus
+*/
+
+#ifndef STRING_DICT_H
+#define STRING_DICT_H
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <string_view>
+#include <cstdio>
+#include <cstdint>
+#include <cerrno>
+#include <cstring>
+#include <functional>
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
+
+// Interns strings as dense ids 0, 1, 2, ... in first-seen order. All the
+// strings sit in one arena laid out like the file after its magic, every
+// string as uint32 length + bytes, so opening is a single read and flush()
+// appends the arena past what is already in the file. Strings are found
+// through an open-addressing table of ids, no string is stored twice.
+class StringDict {
+public:
+    StringDict(const std::string& path);
+
+    int intern(std::string_view str);
+    int find(std::string_view str) const;     // -1 if not interned
+    // valid until the next intern()
+    std::string_view at(int id) const;
+    size_t size() const;
+    // appends the new strings and syncs the file, false if it failed
+    bool flush();
+    // drops every string and removes the file
+    void clear();
+
+private:
+    std::string path;
+    std::string arena;
+    std::vector<uint64_t> offsets;  // of the bytes of string id in arena
+    std::vector<int32_t> table;     // ids by hash, -1 for a free slot
+    size_t persisted;   // bytes of arena already in the file
+    bool hasFile;       // the file exists and has a valid magic
+
+    size_t slot(std::string_view str) const;
+    void add(uint64_t offset);
+};
+
+#define STRING_DICT_MAGIC "STRDICT"
+
+StringDict::StringDict(const std::string& path) : path(path), persisted(0), hasFile(false) {
+    table.assign(1024, -1);
+
+    std::ifstream infile(path, std::ios::binary | std::ios::ate);
+    if (!infile) {
+        return;
+    }
+    std::streamoff fileSize = infile.tellg();
+    infile.seekg(0);
+
+    char magic[8];
+    infile.read(magic, sizeof(magic));
+    if (!infile || memcmp(magic, STRING_DICT_MAGIC, sizeof(magic)) != 0) {
+        std::cerr << "Ignoring invalid string dictionary " << path << std::endl;
+        return;
+    }
+    hasFile = true;
+
+    arena.resize(fileSize - sizeof(magic));
+    infile.read(&arena[0], arena.size());
+    arena.resize(infile.gcount());
+
+    // a partial string a crash may have left at the end is dropped
+    uint64_t pos = 0;
+    while (pos + sizeof(uint32_t) <= arena.size()) {
+        uint32_t length;
+        memcpy(&length, arena.data() + pos, sizeof(length));
+        if (pos + sizeof(length) + length > arena.size()) {
+            break;
+        }
+        add(pos + sizeof(length));
+        pos += sizeof(length) + length;
+    }
+    arena.resize(pos);
+    persisted = pos;
+}
+
+size_t StringDict::slot(std::string_view str) const {
+    size_t mask = table.size() - 1;
+    size_t i = std::hash<std::string_view>()(str) & mask;
+    while (table[i] >= 0 && at(table[i]) != str) {
+        i = (i + 1) & mask;
+    }
+    return i;
+}
+
+// index the string whose bytes start at offset as the next id
+void StringDict::add(uint64_t offset) {
+    offsets.push_back(offset);
+
+    // at most half full, so probes stay short
+    if (offsets.size() * 2 > table.size()) {
+        table.assign(table.size() * 2, -1);
+        for (size_t id = 0; id + 1 < offsets.size(); id++) {
+            table[slot(at(id))] = id;
+        }
+    }
+    table[slot(at(offsets.size() - 1))] = offsets.size() - 1;
+}
+
+int StringDict::intern(std::string_view str) {
+    int id = table[slot(str)];
+    if (id >= 0) {
+        return id;
+    }
+
+    uint32_t length = str.size();
+    arena.append(reinterpret_cast<const char*>(&length), sizeof(length));
+    arena.append(str.data(), str.size());
+    add(arena.size() - length);
+    return offsets.size() - 1;
+}
+
+int StringDict::find(std::string_view str) const {
+    return table[slot(str)];
+}
+
+std::string_view StringDict::at(int id) const {
+    if (id < 0 || size_t(id) >= offsets.size()) {
+        throw std::out_of_range("no string with id " + std::to_string(id));
+    }
+    uint32_t length;
+    memcpy(&length, arena.data() + offsets[id] - sizeof(length), sizeof(length));
+    return std::string_view(arena.data() + offsets[id], length);
+}
+
+size_t StringDict::size() const {
+    return offsets.size();
+}
+
+bool StringDict::flush() {
+    if (persisted == arena.size() && hasFile) {
+        return true;
+    }
+
+    // drop a partial string a crash may have left after the persisted ones
+    if (hasFile && truncate(path.c_str(), sizeof(STRING_DICT_MAGIC) + persisted) != 0) {
+        std::cerr << "Error truncating " << path << std::endl;
+        return false;
+    }
+
+    // a new (or invalid) file is started over
+    int fd = open(path.c_str(), O_WRONLY | O_CREAT | (hasFile ? O_APPEND : O_TRUNC), 0644);
+    if (fd < 0) {
+        std::cerr << "Error opening " << path << " for writing" << std::endl;
+        return false;
+    }
+
+    auto writeAll = [fd](const char* data, size_t size) {
+        while (size > 0) {
+            ssize_t written = write(fd, data, size);
+            if (written < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return false;
+            }
+            data += written;
+            size -= written;
+        }
+        return true;
+    };
+
+    // the ids are referenced by columns and indices written after this, so
+    // the strings are synced first
+    if (!hasFile) {
+        persisted = 0;
+    }
+    bool ok = (hasFile || writeAll(STRING_DICT_MAGIC, 8))
+        && writeAll(arena.data() + persisted, arena.size() - persisted)
+        && fsync(fd) == 0;
+    ok = close(fd) == 0 && ok;
+    if (!ok) {
+        std::cerr << "Error writing " << path << std::endl;
+        return false;
+    }
+
+    // a new file is only durable once its directory is synced
+    if (!hasFile) {
+        size_t slash = path.rfind('/');
+        std::string dir = slash == std::string::npos ? "." : path.substr(0, slash + 1);
+        int dirFd = open(dir.c_str(), O_RDONLY | O_DIRECTORY);
+        if (dirFd >= 0) {
+            fsync(dirFd);
+            close(dirFd);
+        }
+    }
+
+    hasFile = true;
+    persisted = arena.size();
+    return true;
+}
+
+void StringDict::clear() {
+    arena.clear();
+    offsets.clear();
+    table.assign(1024, -1);
+    persisted = 0;
+    hasFile = false;
+    std::remove(path.c_str());
+}
+
+#endif
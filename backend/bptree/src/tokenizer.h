@@ -0,0 +1,521 @@
+/*
+    Copyright (C) 2025 Yuesong Feng
+    Copyright (C) 2025 ParaN3xus
+*/
+
+#ifndef TOKENIZER_H
+#define TOKENIZER_H
+
+#include <vector>
+#include <string>
+#include <string_view>
+#include <cstdint>
+#include <unordered_set>
+
+// Keywords of a title the way extract_keywords_basic used to find them:
+// lowercase, split like NLTK's word_tokenize (punkt sentences, then the
+// Treebank rules), keep the tokens that are alphanumeric and not one of
+// NLTK's English stopwords. Only the rules that can change which
+// alphanumeric tokens come out are reproduced.
+
+// NLTK's English stopwords that can be alphanumeric tokens
+static constexpr std::string_view STOPWORDS[] = {
+    "i", "me", "my", "myself", "we", "our", "ours", "ourselves", "you", "your",
+    "yours", "yourself", "yourselves", "he", "him", "his", "himself", "she", "her", "hers",
+    "herself", "it", "its", "itself", "they", "them", "their", "theirs", "themselves", "what",
+    "which", "who", "whom", "this", "that", "these", "those", "am", "is", "are",
+    "was", "were", "be", "been", "being", "have", "has", "had", "having", "do",
+    "does", "did", "doing", "a", "an", "the", "and", "but", "if", "or",
+    "because", "as", "until", "while", "of", "at", "by", "for", "with", "about",
+    "against", "between", "into", "through", "during", "before", "after", "above", "below", "to",
+    "from", "up", "down", "in", "out", "on", "off", "over", "under", "again",
+    "further", "then", "once", "here", "there", "when", "where", "why", "how", "all",
+    "any", "both", "each", "few", "more", "most", "other", "some", "such", "no",
+    "nor", "not", "only", "own", "same", "so", "than", "too", "very", "s",
+    "t", "can", "will", "just", "don", "should", "now", "d", "ll", "m",
+    "o", "re", "ve", "y", "ain", "aren", "couldn", "didn", "doesn", "hadn",
+    "hasn", "haven", "isn", "ma", "mightn", "mustn", "needn", "shan", "shouldn", "wasn",
+    "weren", "won", "wouldn"
+};
+
+constexpr size_t NUM_STOPWORDS = sizeof(STOPWORDS) / sizeof(STOPWORDS[0]);
+
+// Perfect hash of the stopwords, built by the compiler (hash and
+// displace): a word's bucket gives the seed that puts it in its own slot.
+constexpr size_t STOPWORD_BUCKETS = 64;
+constexpr size_t STOPWORD_SLOTS = 256;
+
+constexpr uint32_t stopwordHash(std::string_view word, uint32_t seed) {
+    uint32_t hash = 2166136261u ^ seed;
+    for (char c : word) {
+        hash = (hash ^ uint8_t(c)) * 16777619u;
+    }
+    return hash ^ (hash >> 15);
+}
+
+struct StopwordTable {
+    uint32_t seeds[STOPWORD_BUCKETS];
+    int16_t slots[STOPWORD_SLOTS];
+};
+
+constexpr StopwordTable buildStopwordTable() {
+    StopwordTable table{};
+    for (size_t i = 0; i < STOPWORD_SLOTS; i++) {
+        table.slots[i] = -1;
+    }
+
+    size_t bucketSize[STOPWORD_BUCKETS] = {};
+    size_t members[STOPWORD_BUCKETS][NUM_STOPWORDS] = {};
+    for (size_t i = 0; i < NUM_STOPWORDS; i++) {
+        size_t bucket = stopwordHash(STOPWORDS[i], 0) % STOPWORD_BUCKETS;
+        members[bucket][bucketSize[bucket]++] = i;
+    }
+
+    // the largest buckets are placed first, while most slots are free
+    for (size_t size = NUM_STOPWORDS; size > 0; size--) {
+        for (size_t bucket = 0; bucket < STOPWORD_BUCKETS; bucket++) {
+            if (bucketSize[bucket] != size) {
+                continue;
+            }
+
+            for (uint32_t seed = 1;; seed++) {
+                if (seed > 1000000) {
+                    throw "no perfect hash seed for a stopword bucket";
+                }
+
+                size_t slots[NUM_STOPWORDS] = {};
+                bool free = true;
+                for (size_t i = 0; i < size && free; i++) {
+                    slots[i] = stopwordHash(STOPWORDS[members[bucket][i]], seed) % STOPWORD_SLOTS;
+                    free = table.slots[slots[i]] == -1;
+                    for (size_t j = 0; j < i && free; j++) {
+                        free = slots[j] != slots[i];
+                    }
+                }
+
+                if (free) {
+                    for (size_t i = 0; i < size; i++) {
+                        table.slots[slots[i]] = members[bucket][i];
+                    }
+                    table.seeds[bucket] = seed;
+                    break;
+                }
+            }
+        }
+    }
+    return table;
+}
+
+static constexpr StopwordTable STOPWORD_TABLE = buildStopwordTable();
+
+constexpr bool isStopword(std::string_view word) {
+    uint32_t seed = STOPWORD_TABLE.seeds[stopwordHash(word, 0) % STOPWORD_BUCKETS];
+    int slot = STOPWORD_TABLE.slots[stopwordHash(word, seed) % STOPWORD_SLOTS];
+    return slot >= 0 && STOPWORDS[slot] == word;
+}
+
+constexpr bool allStopwordsFound() {
+    for (std::string_view word : STOPWORDS) {
+        if (!isStopword(word)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static_assert(allStopwordsFound(), "stopword perfect hash is broken");
+static_assert(!isStopword("graph") && !isStopword("") && !isStopword("thes"),
+    "stopword perfect hash accepts non-stopwords");
+
+// alphanumeric abbreviations of punkt's English model that end a word
+// with a period without ending the sentence
+inline const std::unordered_set<std::string>& punktAbbreviations() {
+    static const std::unordered_set<std::string> abbreviations = {
+        "mr", "mrs", "ms", "dr", "prof", "jr", "sr", "st", "vs", "inc", "corp", "co", "ltd",
+        "no", "gen", "gov", "sen", "rep", "lt", "col", "sgt", "capt", "mt", "ft", "rev",
+        "jan", "feb", "mar", "apr", "jun", "jul", "aug", "sep", "sept", "oct", "nov", "dec",
+        "ala", "ariz", "ark", "calif", "colo", "conn", "del", "fla", "ga", "ill", "ind",
+        "kan", "ky", "la", "md", "mass", "mich", "minn", "miss", "mo", "mont", "neb", "nev",
+        "okla", "ore", "pa", "tenn", "tex", "va", "vt", "wash", "wis", "wyo", "cf", "al"
+    };
+    return abbreviations;
+}
+
+namespace tokenizer {
+
+inline std::u32string decodeUtf8(const std::string& text) {
+    std::u32string result;
+    result.reserve(text.size());
+
+    for (size_t i = 0; i < text.size();) {
+        uint8_t c = text[i];
+        int length = c < 0x80 ? 1 : (c >> 5) == 0x6 ? 2 : (c >> 4) == 0xE ? 3 : (c >> 3) == 0x1E ? 4 : 0;
+        if (length == 0 || i + length > text.size()) {
+            result += U'�';
+            i++;
+            continue;
+        }
+
+        char32_t code = length == 1 ? c : c & (0x7F >> length);
+        bool valid = true;
+        for (int j = 1; j < length; j++) {
+            uint8_t next = text[i + j];
+            valid &= (next >> 6) == 0x2;
+            code = (code << 6) | (next & 0x3F);
+        }
+        result += valid ? code : U'�';
+        i += valid ? length : 1;
+    }
+    return result;
+}
+
+inline void appendUtf8(std::string& out, char32_t code) {
+    if (code < 0x80) {
+        out += char(code);
+    } else if (code < 0x800) {
+        out += char(0xC0 | (code >> 6));
+        out += char(0x80 | (code & 0x3F));
+    } else if (code < 0x10000) {
+        out += char(0xE0 | (code >> 12));
+        out += char(0x80 | ((code >> 6) & 0x3F));
+        out += char(0x80 | (code & 0x3F));
+    } else {
+        out += char(0xF0 | (code >> 18));
+        out += char(0x80 | ((code >> 12) & 0x3F));
+        out += char(0x80 | ((code >> 6) & 0x3F));
+        out += char(0x80 | (code & 0x3F));
+    }
+}
+
+// str.isspace, what str.split() splits on
+inline bool isSpace(char32_t c) {
+    return (c >= 0x09 && c <= 0x0D) || (c >= 0x1C && c <= 0x20) || c == 0x85 || c == 0xA0
+        || c == 0x1680 || (c >= 0x2000 && c <= 0x200A) || c == 0x2028 || c == 0x2029
+        || c == 0x202F || c == 0x205F || c == 0x3000;
+}
+
+inline bool isDecimal(char32_t c) {
+    return (c >= '0' && c <= '9') || (c >= 0x660 && c <= 0x669) || (c >= 0x6F0 && c <= 0x6F9)
+        || (c >= 0x966 && c <= 0x96F) || (c >= 0xFF10 && c <= 0xFF19);
+}
+
+// str.isalnum for one character: letters (L*) and numbers (N*) of the
+// scripts that show up in DBLP titles
+inline bool isAlnum(char32_t c) {
+    if (c < 0x80) {
+        return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+    }
+    if (c < 0x100) {
+        return c == 0xAA || c == 0xB5 || c == 0xBA || c == 0xB2 || c == 0xB3 || c == 0xB9
+            || (c >= 0xBC && c <= 0xBE) || (c >= 0xC0 && c != 0xD7 && c != 0xF7);
+    }
+    if (c <= 0x2C1) return true;                                    // Latin extended, IPA
+    if (c >= 0x2C6 && c <= 0x2D1) return true;                      // modifier letters
+    if (c >= 0x2E0 && c <= 0x2E4) return true;
+    if (c == 0x2EC || c == 0x2EE) return true;
+    if (c >= 0x370 && c <= 0x3FF) {                                 // Greek
+        return c != 0x375 && c != 0x37E && c != 0x384 && c != 0x385 && c != 0x387 && c != 0x3F6;
+    }
+    if (c >= 0x400 && c <= 0x52F) return c < 0x482 || c > 0x489;    // Cyrillic
+    if (c >= 0x531 && c <= 0x587) return c < 0x557 || c > 0x560;    // Armenian
+    if (c >= 0x5D0 && c <= 0x5EA) return true;                      // Hebrew
+    if (c >= 0x620 && c <= 0x64A) return true;                      // Arabic
+    if (isDecimal(c)) return true;
+    if (c >= 0x1E00 && c <= 0x1FFF) return true;                    // Latin/Greek additional
+    if (c == 0x2070 || c == 0x2071 || (c >= 0x2074 && c <= 0x2079) || c == 0x207F) return true;
+    if (c >= 0x2080 && c <= 0x2089) return true;                    // subscript digits
+    if (c >= 0x2150 && c <= 0x2189) return true;                    // number forms
+    if ((c >= 0x2460 && c <= 0x249B) || (c >= 0x24EA && c <= 0x24FF)) return true;
+    if (c >= 0x3041 && c <= 0x3096) return true;                    // Hiragana
+    if (c >= 0x309D && c <= 0x30FF) return c != 0x30A0 && c != 0x30FB;    // Katakana
+    if (c >= 0x3400 && c <= 0x4DBF) return true;                    // CJK
+    if (c >= 0x4E00 && c <= 0x9FFF) return true;
+    if (c >= 0xAC00 && c <= 0xD7A3) return true;                    // Hangul
+    if (c >= 0xF900 && c <= 0xFAFF) return true;
+    if ((c >= 0xFF21 && c <= 0xFF3A) || (c >= 0xFF41 && c <= 0xFF5A)) return true;
+    if (c >= 0xFF66 && c <= 0xFF9D) return true;
+    if (c >= 0x1D400 && c <= 0x1D7FF) return c != 0x1D6C1 && c != 0x1D6DB && c != 0x1D6FB
+        && c != 0x1D715 && c != 0x1D735 && c != 0x1D74F && c != 0x1D76F && c != 0x1D789
+        && c != 0x1D7A9 && c != 0x1D7C3;
+    return false;
+}
+
+// regex \w
+inline bool isWord(char32_t c) {
+    return c == '_' || isAlnum(c);
+}
+
+inline bool isCased(char32_t c);
+
+// str.lower for one character, except the sigma and dotted I cases
+inline char32_t lowerChar(char32_t c) {
+    if (c < 0x80) {
+        return c >= 'A' && c <= 'Z' ? c + 0x20 : c;
+    }
+    if (c >= 0xC0 && c <= 0xDE && c != 0xD7) return c + 0x20;
+    if (c >= 0x100 && c <= 0x17F) {
+        if (c == 0x178) return 0xFF;
+        if (c == 0x130 || c == 0x131 || c == 0x138 || c == 0x149 || c == 0x17F) return c;
+        bool oddUpper = (c >= 0x139 && c <= 0x148) || (c >= 0x179 && c <= 0x17E);
+        return (c % 2 == (oddUpper ? 1 : 0)) ? c + 1 : c;
+    }
+    if (c >= 0x391 && c <= 0x3AB && c != 0x3A2) return c + 0x20;
+    if (c == 0x386) return 0x3AC;
+    if (c >= 0x388 && c <= 0x38A) return c + 0x25;
+    if (c == 0x38C) return 0x3CC;
+    if (c == 0x38E || c == 0x38F) return c + 0x3F;
+    if (c >= 0x410 && c <= 0x42F) return c + 0x20;
+    if (c >= 0x400 && c <= 0x40F) return c + 0x50;
+    if ((c >= 0x460 && c <= 0x481) || (c >= 0x48A && c <= 0x4BF) || (c >= 0x4D0 && c <= 0x52F)) {
+        return c % 2 == 0 ? c + 1 : c;
+    }
+    if (c == 0x4C0) return 0x4CF;
+    if (c >= 0x4C1 && c <= 0x4CE) return c % 2 == 1 ? c + 1 : c;
+    if (c >= 0x531 && c <= 0x556) return c + 0x30;
+    if ((c >= 0x1E00 && c <= 0x1E95) || (c >= 0x1EA0 && c <= 0x1EFF)) {
+        return c % 2 == 0 ? c + 1 : c;
+    }
+    if (c >= 0xFF21 && c <= 0xFF3A) return c + 0x20;
+    return c;
+}
+
+inline bool isCased(char32_t c) {
+    return lowerChar(c) != c || (c >= 'a' && c <= 'z') || (c >= 0xDF && c <= 0xFF && c != 0xF7)
+        || (c >= 0x100 && c <= 0x17F) || (c >= 0x3AC && c <= 0x3CE) || (c >= 0x430 && c <= 0x45F);
+}
+
+// str.islower for one character
+inline bool isLower(char32_t c) {
+    return isCased(c) && lowerChar(c) == c;
+}
+
+inline std::u32string lower(const std::u32string& text) {
+    std::u32string result;
+    result.reserve(text.size());
+
+    for (size_t i = 0; i < text.size(); i++) {
+        char32_t c = text[i];
+        if (c == 0x130) {
+            // İ lowers to i + combining dot above
+            result += U'i';
+            result += char32_t(0x307);
+        } else if (c == 0x3A3) {
+            // final sigma after a cased letter that is not followed by one
+            bool after = i > 0 && isCased(text[i - 1]);
+            bool before = i + 1 < text.size() && isCased(text[i + 1]);
+            result += after && !before ? char32_t(0x3C2) : char32_t(0x3C3);
+        } else {
+            result += lowerChar(c);
+        }
+    }
+    return result;
+}
+
+inline bool isOneOf(char32_t c, std::u32string_view chars) {
+    return chars.find(c) != std::u32string_view::npos;
+}
+
+inline std::string toUtf8(const std::u32string& text, size_t begin, size_t end) {
+    std::string result;
+    for (size_t i = begin; i < end; i++) {
+        appendUtf8(result, text[i]);
+    }
+    return result;
+}
+
+// punkt's ##number## type, without its final period
+inline bool isPunktNumber(const std::u32string& text, size_t begin, size_t end) {
+    size_t i = begin;
+    if (i < end && text[i] == '-') i++;
+    if (i < end && (text[i] == '.' || text[i] == ',')) i++;
+    if (i >= end || !isDecimal(text[i])) return false;
+    for (i++; i < end; i++) {
+        if (!isDecimal(text[i]) && !isOneOf(text[i], U",.-")) return false;
+    }
+    return true;
+}
+
+// Whether the period at p ends a sentence for punkt. next is the first
+// character of what follows (0 at the end of the text).
+inline bool isSentenceBreak(const std::u32string& text, size_t p, char32_t next) {
+    // punkt's token: the non-space run before the period, cut at its
+    // non-word characters, without leading word-start punctuation
+    size_t begin = p;
+    while (begin > 0 && !isSpace(text[begin - 1]) && !isOneOf(text[begin - 1], U")\";}]*:@'({[!?")) {
+        begin--;
+    }
+    while (begin < p && isOneOf(text[begin], U"(\"`{[:;&#*@)}]-,")) {
+        begin++;
+    }
+
+    if (punktAbbreviations().count(toUtf8(text, begin, p))) {
+        return false;
+    }
+
+    // numbers and initials go on when the next word is lowercase
+    bool initial = p - begin == 1 && isWord(text[begin]) && !isDecimal(text[begin]);
+    if (initial || isPunktNumber(text, begin, p)) {
+        return !(isLower(next) || (next != 0 && isOneOf(next, U";:,.!?")));
+    }
+    return true;
+}
+
+} // namespace tokenizer
+
+inline std::vector<std::string> extractKeywords(const std::string& title) {
+    using namespace tokenizer;
+
+    const std::u32string text = lower(decodeUtf8(title));
+    const size_t n = text.size();
+    const char32_t SPACE = ' ';
+
+    // spaceBefore[i]: NLTK inserts a space before text[i], spaceBefore[n]
+    // is the padding at the end
+    std::vector<bool> spaceBefore(n + 1, false);
+    auto isolate = [&](size_t begin, size_t end) {
+        spaceBefore[begin] = true;
+        spaceBefore[end] = true;
+    };
+    auto at = [&](size_t i) -> char32_t { return i < n ? text[i] : 0; };
+
+    // sentence final periods, split off by the Treebank final period rule
+    for (size_t p = 0; p < n; p++) {
+        if (text[p] != '.' || (p > 0 && text[p - 1] == '.') || at(p + 1) == '.') {
+            continue;
+        }
+
+        size_t end = p + 1;
+        while (end < n && isOneOf(text[end], U"])}>\"'")) end++;
+        size_t rest = end;
+        while (rest < n && isSpace(text[rest])) rest++;
+        if (rest == n) {
+            isolate(p, p + 1);
+            continue;
+        }
+
+        char32_t after = at(p + 1);
+        char32_t next = 0;
+        if (after != 0 && isOneOf(after, U"?!)\";}]*:@'({[")) {
+            next = after;
+        } else if (isSpace(after)) {
+            size_t i = p + 1;
+            while (i < n && isSpace(text[i])) i++;
+            next = at(i);
+        } else {
+            continue;
+        }
+
+        if (isSentenceBreak(text, p, next)) {
+            isolate(p, p + 1);
+        }
+    }
+
+    for (size_t i = 0; i < n; i++) {
+        char32_t c = text[i];
+
+        // quotes, brackets and the always separated punctuation
+        if (isOneOf(c, U"\"`«“‘„»”’;@#$%&?!*[](){}<>")) {
+            isolate(i, i + 1);
+        } else if (c == '\'' && isWord(at(i + 1)) && !isWord(at(i + 2))
+            && !isOneOf(at(i + 1), U"mtsdn")) {
+            // 'x: a quote before a one letter word
+            spaceBefore[i + 1] = true;
+        } else if ((c == ':' || c == ',') && !isDecimal(at(i + 1))) {
+            isolate(i, i + 1);
+            // the regex consumed the next character, it cannot match itself
+            if (i + 1 < n) i++;
+        } else if (c == '.' && at(i + 1) == '.') {
+            size_t end = i;
+            while (end < n && text[end] == '.') end++;
+            isolate(i, end);
+            i = end - 1;
+        } else if (c == '-' && at(i + 1) == '-') {
+            isolate(i, i + 2);
+            i++;
+        } else if (c == '\'' && at(i + 1) == '\'') {
+            isolate(i, i + 2);
+            i++;
+        }
+    }
+
+    auto spaceAt = [&](size_t i) { return i >= n || spaceBefore[i] || text[i] == SPACE; };
+    // a literal space follows position i, after the spaces added so far
+    auto spaceAfter = [&](size_t i) { return i + 1 >= n || spaceBefore[i + 1] || text[i + 1] == SPACE; };
+
+    // ' followed by a space, and the clitics ('s 'm 'd 'll 're 've n't)
+    for (size_t i = 1; i < n; i++) {
+        if (text[i] != '\'' || spaceBefore[i]) {
+            continue;
+        }
+        char32_t before = text[i - 1];
+        if (before == '\'' || before == SPACE) {
+            continue;
+        }
+
+        if (spaceAfter(i)) {
+            spaceBefore[i] = true;
+        } else if (isOneOf(at(i + 1), U"smd") && spaceAfter(i + 1)) {
+            spaceBefore[i] = true;
+        } else if (((at(i + 1) == 'l' && at(i + 2) == 'l') || (at(i + 1) == 'r' && at(i + 2) == 'e')
+            || (at(i + 1) == 'v' && at(i + 2) == 'e')) && spaceAfter(i + 2)) {
+            spaceBefore[i] = true;
+        } else if (before == 'n' && at(i + 1) == 't' && spaceAfter(i + 1)
+            && i >= 2 && text[i - 2] != '\'' && text[i - 2] != SPACE && !spaceBefore[i - 1]) {
+            spaceBefore[i - 1] = true;
+        }
+    }
+
+    // contractions NLTK splits inside a word
+    static const std::u32string contractions[][2] = {
+        { U"can", U"not" }, { U"gim", U"me" }, { U"gon", U"na" }, { U"got", U"ta" },
+        { U"lem", U"me" }, { U"wan", U"na" }, { U"d", U"'ye" }, { U"more", U"'n" }
+    };
+    for (size_t i = 0; i < n; i++) {
+        if ((i > 0 && isWord(text[i - 1])) || !isWord(text[i])) {
+            continue;
+        }
+        for (const auto& contraction : contractions) {
+            size_t first = contraction[0].size();
+            size_t length = first + contraction[1].size();
+            if (text.compare(i, length, contraction[0] + contraction[1]) != 0 || isWord(at(i + length))) {
+                continue;
+            }
+            // wanna only before whitespace
+            if (contraction[0] == U"wan" && !(spaceAt(i + length) || isSpace(at(i + length)))) {
+                continue;
+            }
+            spaceBefore[i + first] = true;
+        }
+    }
+
+    std::vector<std::string> keywords;
+    size_t begin = 0;
+    bool alnum = true;
+    for (size_t i = 0; i <= n; i++) {
+        if (i == n || spaceBefore[i] || isSpace(text[i])) {
+            if (i > begin && alnum) {
+                std::string token = toUtf8(text, begin, i);
+                if (!isStopword(token)) {
+                    keywords.push_back(std::move(token));
+                }
+            }
+            begin = i < n && isSpace(text[i]) ? i + 1 : i;
+            alnum = true;
+        }
+        if (i < n && !isSpace(text[i])) {
+            alnum &= isAlnum(text[i]);
+        }
+    }
+    return keywords;
+}
+
+inline std::vector<std::vector<std::string>> extractKeywords(const std::vector<std::string>& titles) {
+    std::vector<std::vector<std::string>> result;
+    result.reserve(titles.size());
+    for (const std::string& title : titles) {
+        result.push_back(extractKeywords(title));
+    }
+    return result;
+}
+
+#endif
@@ -5,45 +5,291 @@ namespace py = pybind11;
 
 
 #include "bptree.h"
+#include "composite_key.h"
+#include "record_store.h"
+#include "column_store.h"
+#include "dblp_parser.h"
+#include "tokenizer.h"
+#include "bulk_import.h"
+#include "ranked_search.h"
+
+namespace pybind11 {
+namespace detail {
+// (keyword id, year) tuples in Python
+template<>
+struct type_caster<KeywordYear> {
+    PYBIND11_TYPE_CASTER(KeywordYear, _("Tuple[int, int]"));
+
+    bool load(handle src, bool convert) {
+        make_caster<std::pair<int, int>> pair;
+        if (!pair.load(src, convert)) {
+            return false;
+        }
+        std::pair<int, int> key = cast_op<std::pair<int, int>>(pair);
+        value = { key.first, key.second };
+        return true;
+    }
+
+    static handle cast(const KeywordYear& src, return_value_policy, handle) {
+        return make_tuple(src.keyword_id, src.year).release();
+    }
+};
+}
+}
+
 PYBIND11_MODULE(_bptree, m) {
 
+    py::class_<CacheStats>(m, "CacheStats")
+        .def_readonly("hits", &CacheStats::hits)
+        .def_readonly("misses", &CacheStats::misses)
+        .def_readonly("entries", &CacheStats::entries)
+        .def_readonly("bytes", &CacheStats::bytes)
+        .def_property_readonly("hit_rate", [](const CacheStats& self) {
+            uint64_t lookups = self.hits + self.misses;
+            return lookups == 0 ? 0.0 : double(self.hits) / lookups;
+        });
+
+    py::class_<BPTree<int, std::string>::Snapshot>(m, "BPTreeIntStrSnapshot")
+        .def("find", &BPTree<int, std::string>::Snapshot::find, py::return_value_policy::copy)
+        .def("keys", &BPTree<int, std::string>::Snapshot::keys)
+        .def("values", &BPTree<int, std::string>::Snapshot::values)
+        .def("release", &BPTree<int, std::string>::Snapshot::release);
+
     py::class_<BPTree<int, std::string>>(m, "BPTreeIntStr")
         .def(py::init<int>())
         .def("insert", &BPTree<int, std::string>::insert)
         .def("update", &BPTree<int, std::string>::update)
-        .def("find", &BPTree<int, std::string>::find)
-        .def("deserialize", &BPTree<int, std::string>::deserialize)
+        .def("find", &BPTree<int, std::string>::find, py::return_value_policy::copy)
+        .def("deserialize", &BPTree<int, std::string>::deserialize, py::call_guard<py::gil_scoped_release>())
+        .def("deserialize_lazy", &BPTree<int, std::string>::deserializeLazy,
+            py::arg("filename"), py::arg("budget"), py::call_guard<py::gil_scoped_release>())
         .def("serialize", &BPTree<int, std::string>::serialize)
         .def("keys", &BPTree<int, std::string>::keys)
-        .def("values", &BPTree<int, std::string>::values);
+        .def("values", &BPTree<int, std::string>::values)
+        .def("leaf_pool_stats", &BPTree<int, std::string>::leafPoolStats)
+        .def("snapshot", &BPTree<int, std::string>::snapshot, py::keep_alive<0, 1>());
+
+    py::class_<BPTree<int, std::vector<int>>::Snapshot>(m, "BPTreeIntVecIntSnapshot")
+        .def("find", &BPTree<int, std::vector<int>>::Snapshot::find, py::return_value_policy::copy)
+        .def("count", &BPTree<int, std::vector<int>>::Snapshot::count)
+        .def("keys", &BPTree<int, std::vector<int>>::Snapshot::keys)
+        .def("values", &BPTree<int, std::vector<int>>::Snapshot::values)
+        .def("release", &BPTree<int, std::vector<int>>::Snapshot::release);
 
     py::class_<BPTree<int, std::vector<int>>>(m, "BPTreeIntVecInt")
         .def(py::init<int>())
         .def("insert", &BPTree<int, std::vector<int>>::insert)
         .def("update", &BPTree<int, std::vector<int>>::update)
-        .def("find", &BPTree<int, std::vector<int>>::find)
-        .def("deserialize", &BPTree<int, std::vector<int>>::deserialize)
+        .def("find", &BPTree<int, std::vector<int>>::find, py::return_value_policy::copy)
+        .def("count", &BPTree<int, std::vector<int>>::count)
+        .def("range", &BPTree<int, std::vector<int>>::range)
+        .def("append", &BPTree<int, std::vector<int>>::append<int>)
+        .def("deserialize", &BPTree<int, std::vector<int>>::deserialize, py::call_guard<py::gil_scoped_release>())
+        .def("deserialize_lazy", &BPTree<int, std::vector<int>>::deserializeLazy,
+            py::arg("filename"), py::arg("budget"), py::call_guard<py::gil_scoped_release>())
         .def("serialize", &BPTree<int, std::vector<int>>::serialize)
         .def("keys", &BPTree<int, std::vector<int>>::keys)
-        .def("values", &BPTree<int, std::vector<int>>::values);
+        .def("values", &BPTree<int, std::vector<int>>::values)
+        .def("leaf_pool_stats", &BPTree<int, std::vector<int>>::leafPoolStats)
+        .def("snapshot", &BPTree<int, std::vector<int>>::snapshot, py::keep_alive<0, 1>());
+
+    py::class_<BPTree<std::wstring, int>::Snapshot>(m, "BPTreeWStrIntSnapshot")
+        .def("find", &BPTree<std::wstring, int>::Snapshot::find, py::return_value_policy::copy)
+        .def("keys", &BPTree<std::wstring, int>::Snapshot::keys)
+        .def("values", &BPTree<std::wstring, int>::Snapshot::values)
+        .def("release", &BPTree<std::wstring, int>::Snapshot::release);
 
     py::class_<BPTree<std::wstring, int>>(m, "BPTreeWStrInt")
         .def(py::init<int>())
         .def("insert", &BPTree<std::wstring, int>::insert)
         .def("update", &BPTree<std::wstring, int>::update)
-        .def("find", &BPTree<std::wstring, int>::find)
-        .def("deserialize", &BPTree<std::wstring, int>::deserialize)
+        .def("find", &BPTree<std::wstring, int>::find, py::return_value_policy::copy)
+        .def("deserialize", &BPTree<std::wstring, int>::deserialize, py::call_guard<py::gil_scoped_release>())
+        .def("deserialize_lazy", &BPTree<std::wstring, int>::deserializeLazy,
+            py::arg("filename"), py::arg("budget"), py::call_guard<py::gil_scoped_release>())
         .def("serialize", &BPTree<std::wstring, int>::serialize)
         .def("keys", &BPTree<std::wstring, int>::keys)
-        .def("values", &BPTree<std::wstring, int>::values);
+        .def("values", &BPTree<std::wstring, int>::values)
+        .def("leaf_pool_stats", &BPTree<std::wstring, int>::leafPoolStats)
+        .def("snapshot", &BPTree<std::wstring, int>::snapshot, py::keep_alive<0, 1>());
+
+    py::class_<BPTree<std::wstring, std::vector<int>>::Snapshot>(m, "BPTreeWStrVecIntSnapshot")
+        .def("find", &BPTree<std::wstring, std::vector<int>>::Snapshot::find, py::return_value_policy::copy)
+        .def("count", &BPTree<std::wstring, std::vector<int>>::Snapshot::count)
+        .def("keys", &BPTree<std::wstring, std::vector<int>>::Snapshot::keys)
+        .def("values", &BPTree<std::wstring, std::vector<int>>::Snapshot::values)
+        .def("release", &BPTree<std::wstring, std::vector<int>>::Snapshot::release);
 
     py::class_<BPTree<std::wstring, std::vector<int>>>(m, "BPTreeWStrVecInt")
         .def(py::init<int>())
         .def("insert", &BPTree<std::wstring, std::vector<int>>::insert)
         .def("update", &BPTree<std::wstring, std::vector<int>>::update)
-        .def("find", &BPTree<std::wstring, std::vector<int>>::find)
-        .def("deserialize", &BPTree<std::wstring, std::vector<int>>::deserialize)
+        .def("find", &BPTree<std::wstring, std::vector<int>>::find, py::return_value_policy::copy)
+        .def("count", &BPTree<std::wstring, std::vector<int>>::count)
+        .def("append", &BPTree<std::wstring, std::vector<int>>::append<int>)
+        .def("deserialize", &BPTree<std::wstring, std::vector<int>>::deserialize, py::call_guard<py::gil_scoped_release>())
+        .def("deserialize_lazy", &BPTree<std::wstring, std::vector<int>>::deserializeLazy,
+            py::arg("filename"), py::arg("budget"), py::call_guard<py::gil_scoped_release>())
         .def("serialize", &BPTree<std::wstring, std::vector<int>>::serialize)
         .def("keys", &BPTree<std::wstring, std::vector<int>>::keys)
-        .def("values", &BPTree<std::wstring, std::vector<int>>::values);
+        .def("values", &BPTree<std::wstring, std::vector<int>>::values)
+        .def("leaf_pool_stats", &BPTree<std::wstring, std::vector<int>>::leafPoolStats)
+        .def("snapshot", &BPTree<std::wstring, std::vector<int>>::snapshot, py::keep_alive<0, 1>());
+
+    py::class_<BPTree<KeywordYear, std::vector<int>>::Snapshot>(m, "BPTreeKeywordYearVecIntSnapshot")
+        .def("find", &BPTree<KeywordYear, std::vector<int>>::Snapshot::find, py::return_value_policy::copy)
+        .def("count", &BPTree<KeywordYear, std::vector<int>>::Snapshot::count)
+        .def("range", &BPTree<KeywordYear, std::vector<int>>::Snapshot::range)
+        .def("keys", &BPTree<KeywordYear, std::vector<int>>::Snapshot::keys)
+        .def("values", &BPTree<KeywordYear, std::vector<int>>::Snapshot::values)
+        .def("release", &BPTree<KeywordYear, std::vector<int>>::Snapshot::release);
+
+    py::class_<BPTree<KeywordYear, std::vector<int>>>(m, "BPTreeKeywordYearVecInt")
+        .def(py::init<int>())
+        .def("insert", &BPTree<KeywordYear, std::vector<int>>::insert)
+        .def("update", &BPTree<KeywordYear, std::vector<int>>::update)
+        .def("find", &BPTree<KeywordYear, std::vector<int>>::find, py::return_value_policy::copy)
+        .def("count", &BPTree<KeywordYear, std::vector<int>>::count)
+        .def("range", &BPTree<KeywordYear, std::vector<int>>::range)
+        .def("append", &BPTree<KeywordYear, std::vector<int>>::append<int>)
+        .def("deserialize", &BPTree<KeywordYear, std::vector<int>>::deserialize, py::call_guard<py::gil_scoped_release>())
+        .def("deserialize_lazy", &BPTree<KeywordYear, std::vector<int>>::deserializeLazy,
+            py::arg("filename"), py::arg("budget"), py::call_guard<py::gil_scoped_release>())
+        .def("serialize", &BPTree<KeywordYear, std::vector<int>>::serialize)
+        .def("keys", &BPTree<KeywordYear, std::vector<int>>::keys)
+        .def("values", &BPTree<KeywordYear, std::vector<int>>::values)
+        .def("leaf_pool_stats", &BPTree<KeywordYear, std::vector<int>>::leafPoolStats)
+        .def("snapshot", &BPTree<KeywordYear, std::vector<int>>::snapshot, py::keep_alive<0, 1>());
+
+    py::class_<RecordStore>(m, "RecordStore")
+        .def(py::init<const std::string&, size_t, size_t>(),
+            py::arg("directory"), py::arg("max_segment_size") = 256 * 1024 * 1024,
+            py::arg("cache_size") = 64 * 1024 * 1024)
+        .def("put", &RecordStore::put)
+        .def("get", &RecordStore::get, py::call_guard<py::gil_scoped_release>())
+        .def("get_many", &RecordStore::getMany, py::call_guard<py::gil_scoped_release>())
+        .def("contains", &RecordStore::contains)
+        .def("__len__", &RecordStore::size)
+        .def("ids", &RecordStore::ids)
+        .def("flush", &RecordStore::flush)
+        .def("cache_stats", &RecordStore::cacheStats);
+
+    m.attr("DBLP_FIELDS") = DBLP_FIELDS;
+
+    py::class_<DblpParser>(m, "DblpParser")
+        .def("__iter__", [](DblpParser& self) -> DblpParser& { return self; })
+        .def("__next__", [](DblpParser& self) {
+            std::vector<Record> batch;
+            bool got;
+            {
+                py::gil_scoped_release release;
+                got = self.nextBatch(batch);
+            }
+            if (!got) {
+                throw py::stop_iteration();
+            }
+            return batch;
+        })
+        .def_property_readonly("bytes_read", &DblpParser::bytesRead)
+        .def_property_readonly("entries", &DblpParser::entries)
+        .def_property_readonly("seconds", &DblpParser::seconds)
+        .def_property_readonly("mb_per_second", &DblpParser::megabytesPerSecond);
+
+    m.def("parse_dblp", [](const std::string& data, size_t batchSize) {
+        return new DblpParser(std::make_unique<std::istringstream>(data), batchSize);
+    }, py::arg("data"), py::arg("batch_size") = 1000);
+
+    m.def("parse_dblp_file", [](const std::string& path, size_t batchSize) {
+        auto input = std::make_unique<std::ifstream>(path, std::ios::binary);
+        if (!*input) {
+            throw std::runtime_error("cannot open " + path);
+        }
+        return new DblpParser(std::move(input), batchSize);
+    }, py::arg("path"), py::arg("batch_size") = 1000);
+
+    m.def("extract_keywords", py::overload_cast<const std::vector<std::string>&>(&extractKeywords),
+        py::arg("titles"), py::call_guard<py::gil_scoped_release>());
+
+    py::class_<YearlyKeywordCounts>(m, "YearlyKeywordCounts")
+        .def_readonly("articles", &YearlyKeywordCounts::articles)
+        .def_readonly("keyword_ids", &YearlyKeywordCounts::keywordIds)
+        .def_readonly("counts", &YearlyKeywordCounts::counts);
+
+    py::class_<ColumnStore>(m, "ColumnStore")
+        .def(py::init<const std::string&>(), py::arg("directory"))
+        .def("put", &ColumnStore::put,
+            py::arg("article_id"), py::arg("year"), py::arg("authors"), py::arg("keywords"))
+        .def("contains", &ColumnStore::contains)
+        .def("__len__", &ColumnStore::size)
+        .def("average_keyword_count", &ColumnStore::averageKeywordCount)
+        .def("year", &ColumnStore::year)
+        .def("author_ids", &ColumnStore::authorIds)
+        .def("keyword_ids", &ColumnStore::keywordIds)
+        .def("author_dict_size", [](ColumnStore& self) {
+            return self.authors().size();
+        })
+        .def("keyword_dict_size", [](ColumnStore& self) {
+            return self.keywords().size();
+        })
+        .def("find_author", [](ColumnStore& self, const std::string& name) {
+            return self.authors().find(name);
+        })
+        .def("author_names", [](ColumnStore& self, const std::vector<int>& ids) {
+            std::vector<std::string> names;
+            for (int id : ids) names.emplace_back(self.authors().at(id));
+            return names;
+        })
+        .def("find_keyword", [](ColumnStore& self, const std::string& keyword) {
+            return self.keywords().find(keyword);
+        })
+        .def("keyword_names", [](ColumnStore& self, const std::vector<int>& ids) {
+            std::vector<std::string> names;
+            for (int id : ids) names.emplace_back(self.keywords().at(id));
+            return names;
+        })
+        .def("coauthors", [](ColumnStore& self, int authorId) {
+            return self.coauthors().coauthors(authorId);
+        })
+        .def("top_coauthors", [](ColumnStore& self, int authorId, size_t k) {
+            return self.coauthors().topCoauthors(authorId, k);
+        }, py::arg("author_id"), py::arg("k"))
+        .def("find_authors_fuzzy", &ColumnStore::findAuthorsFuzzy,
+            py::arg("name"), py::arg("max_distance"), py::arg("limit"), py::arg("num_authors") = SIZE_MAX,
+            py::call_guard<py::gil_scoped_release>())
+        .def("top_authors", [](ColumnStore& self, size_t k) {
+            return self.coauthors().topAuthors(k);
+        })
+        .def("author_articles", [](ColumnStore& self, int authorId) {
+            return self.coauthors().articles(authorId);
+        })
+        .def("shared_articles", [](ColumnStore& self, int authorId, int otherId) {
+            return self.coauthors().sharedArticles(authorId, otherId);
+        })
+        .def("intern_keywords", &ColumnStore::internKeywords,
+            py::arg("titles"), py::call_guard<py::gil_scoped_release>())
+        .def("yearly_keyword_counts", &ColumnStore::yearlyKeywordCounts,
+            py::arg("excluded_keyword_ids") = std::vector<int>(), py::arg("limit") = 0,
+            py::arg("threads") = 0, py::arg("max_article_id") = INT_MAX, py::call_guard<py::gil_scoped_release>())
+        .def("flush", &ColumnStore::flush);
+
+    py::class_<BulkImportStats>(m, "BulkImportStats")
+        .def_readonly("articles", &BulkImportStats::articles)
+        .def_readonly("bytes", &BulkImportStats::bytes)
+        .def_readonly("seconds", &BulkImportStats::seconds);
+
+    m.def("bulk_import", &bulkImport,
+        py::arg("paths"), py::arg("record_fields"), py::arg("records"), py::arg("columns"),
+        py::arg("author_index"), py::arg("title_index"), py::arg("keyword_index"), py::arg("date_index"),
+        py::arg("keyword_year_index"), py::arg("first_id") = 1, py::arg("threads") = 0, py::call_guard<py::gil_scoped_release>());
+
+    py::class_<ScoredId>(m, "ScoredId")
+        .def_readonly("id", &ScoredId::id)
+        .def_readonly("score", &ScoredId::score);
+
+    m.def("search_bm25", &searchBm25<BPTree<int, std::vector<int>>::Snapshot>,
+        py::arg("keyword_index"), py::arg("columns"), py::arg("keyword_ids"), py::arg("k"),
+        py::arg("k1") = 1.2, py::arg("b") = 0.75, py::arg("num_articles") = 0, py::arg("average_keywords") = 0);
+    m.def("search_bm25", &searchBm25<BPTree<int, std::vector<int>>>,
+        py::arg("keyword_index"), py::arg("columns"), py::arg("keyword_ids"), py::arg("k"),
+        py::arg("k1") = 1.2, py::arg("b") = 0.75, py::arg("num_articles") = 0, py::arg("average_keywords") = 0);
 }
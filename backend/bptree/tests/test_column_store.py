@@ -0,0 +1,41 @@
+import tempfile
+import unittest
+
+from bptree import ColumnStore
+
+
+class AuthorRankingTest(unittest.TestCase):
+    def setUp(self):
+        self.directory = tempfile.TemporaryDirectory()
+        self.columns = ColumnStore(self.directory.name)
+
+    def tearDown(self):
+        self.directory.cleanup()
+
+    def top_authors(self):
+        # author name -> article count, most articles first
+        ranked = self.columns.top_authors(10)
+        names = self.columns.author_names([author_id for author_id, _ in ranked])
+        return [(name, count) for name, (_, count) in zip(names, ranked)]
+
+    def test_reput_with_changed_authors(self):
+        self.columns.put(1, 2020, ["A", "B"], [])
+        self.columns.put(2, 2020, ["A", "C"], [])
+        self.columns.put(3, 2020, ["A"], [])
+        # article 1 loses A
+        self.columns.put(1, 2020, ["B"], [])
+
+        self.assertEqual(self.top_authors(), [("A", 2), ("B", 1), ("C", 1)])
+        self.assertEqual(self.columns.top_coauthors(self.columns.find_author("A"), 10),
+                         [(self.columns.find_author("C"), 1)])
+
+    def test_reput_drops_author_without_articles(self):
+        self.columns.put(1, 2020, ["A", "B"], [])
+        self.columns.put(1, 2020, ["B"], [])
+
+        self.assertEqual(self.top_authors(), [("B", 1)])
+        self.assertEqual(self.columns.author_articles(self.columns.find_author("A")), [])
+
+
+if __name__ == "__main__":
+    unittest.main()
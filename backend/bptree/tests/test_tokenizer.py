@@ -0,0 +1,37 @@
+import os
+import unittest
+
+from bptree import extract_keywords
+
+try:
+    from nltk.corpus import stopwords
+    from nltk.tokenize import word_tokenize
+
+    stopwords.words('english')
+    word_tokenize("A title.")
+    HAVE_NLTK = True
+except (ImportError, LookupError):
+    HAVE_NLTK = False
+
+TITLES = os.path.join(os.path.dirname(__file__), "data", "titles.txt")
+
+
+@unittest.skipUnless(HAVE_NLTK, "needs nltk with the punkt_tab and stopwords data")
+class NltkParityTest(unittest.TestCase):
+    # extract_keywords replaces word_tokenize in backend/utils/xml_parser.py,
+    # both must give the same keywords for every title
+    def test_titles(self):
+        with open(TITLES, encoding="utf-8") as f:
+            titles = [line.rstrip("\n") for line in f if line.strip()]
+
+        stop_words = set(stopwords.words('english'))
+        expected = [[word for word in word_tokenize(title.lower())
+                     if word.isalnum() and word not in stop_words] for title in titles]
+
+        for title, keywords, nltk_keywords in zip(titles, extract_keywords(titles), expected):
+            with self.subTest(title=title):
+                self.assertEqual(keywords, nltk_keywords)
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,73 @@
+/*
+    Copyright (C) 2025 Yuesong Feng
+    Copyright (C) 2025 ParaN3xus
+*/
+
+#ifndef CRC32C_H
+#define CRC32C_H
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+
+#if defined(__x86_64__)
+#include <nmmintrin.h>
+#endif
+
+// CRC32C (Castagnoli), with the SSE4.2 crc32 instruction when the CPU has
+// it and a table otherwise.
+
+inline const uint32_t* crc32cTable() {
+    static const struct Table {
+        uint32_t entries[256];
+        Table() {
+            for (uint32_t i = 0; i < 256; i++) {
+                uint32_t crc = i;
+                for (int bit = 0; bit < 8; bit++) {
+                    crc = (crc >> 1) ^ (0x82F63B78u & (0u - (crc & 1)));
+                }
+                entries[i] = crc;
+            }
+        }
+    } table;
+    return table.entries;
+}
+
+inline uint32_t crc32cSoftware(uint32_t crc, const char* data, size_t length) {
+    const uint32_t* table = crc32cTable();
+    for (size_t i = 0; i < length; i++) {
+        crc = table[(crc ^ uint8_t(data[i])) & 0xFF] ^ (crc >> 8);
+    }
+    return crc;
+}
+
+#if defined(__x86_64__)
+__attribute__((target("sse4.2")))
+inline uint32_t crc32cHardware(uint32_t crc, const char* data, size_t length) {
+    uint64_t crc64 = crc;
+    for (; length >= sizeof(uint64_t); data += sizeof(uint64_t), length -= sizeof(uint64_t)) {
+        uint64_t word;
+        memcpy(&word, data, sizeof(word));
+        crc64 = _mm_crc32_u64(crc64, word);
+    }
+    crc = uint32_t(crc64);
+    for (; length > 0; data++, length--) {
+        crc = _mm_crc32_u8(crc, uint8_t(*data));
+    }
+    return crc;
+}
+#endif
+
+// crc of data following the crc of what came before it (0 to start)
+inline uint32_t crc32c(const char* data, size_t length, uint32_t previous = 0) {
+    uint32_t crc = ~previous;
+#if defined(__x86_64__)
+    static const bool hardware = __builtin_cpu_supports("sse4.2");
+    if (hardware) {
+        return ~crc32cHardware(crc, data, length);
+    }
+#endif
+    return ~crc32cSoftware(crc, data, length);
+}
+
+#endif
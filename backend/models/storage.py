@@ -1,75 +1,208 @@
 import os
+import bisect
 import pickle
-from typing import List, Dict, Optional
-from bptree import BPTreeIntStr, BPTreeIntVecInt, BPTreeWStrInt, BPTreeWStrVecInt
+import threading
+import numpy
+from collections import namedtuple
+from typing import List, Dict, Optional, Tuple
+from bptree import BPTreeIntStr, BPTreeIntVecInt, BPTreeWStrInt, BPTreeWStrVecInt, RecordStore, ColumnStore
+from bptree import BPTreeKeywordYearVecInt
+from bptree import BulkImportStats, bulk_import, search_bm25
 from backend.models.article import Article
 from backend.utils.xml_parser import extract_keywords_basic
-from pivoter import pivoter
-from functools import lru_cache
-from cachetools import cached
+from pivoter import pivoter, pivoter_local, pivoter_incremental, pivoter_estimate, PivoterCancelled
+from pivoter import CliqueSnapshot, save_snapshot
+from cachetools import cached, LRUCache
 
 # 256MB
 MAX_FILE_SIZE = 256 * 1024 * 1024
+# decoded records kept in memory, 64MB
+RECORD_CACHE_SIZE = 64 * 1024 * 1024
+# leaves of each index kept in memory, read from its file when reached, 32MB
+INDEX_LEAF_BUDGET = 32 * 1024 * 1024
+# per-author clique count tables kept, one per max_k
+CLIQUE_AUTHOR_CACHE_SIZE = 4
+# yearly keyword tables kept, one per limit
+YEARLY_KEYWORDS_CACHE_SIZE = 8
+
+# article fields in the order they are stored in a record
+RECORD_FIELDS = ("article_id", "title", "keywords", "ee", "year", "authors", "booktitle", "url",
+                 "editors", "pages", "publisher", "isbn", "volume", "series", "school", "journal")
+
+# snapshots of the indices that requests read, so a request sees the
+# indices as they were after a whole batch of an import. The columns and
+# the coauthor index are not copied; what was published of them is the
+# articles up to max_article_id and the first num_authors author ids, with
+# the article count and average keywords of the columns for BM25.
+IndexView = namedtuple("IndexView", ["author", "title", "keyword", "date", "keyword_year",
+                                     "max_article_id", "num_authors", "num_articles", "average_keywords"])
 
 
 class LiteratureStorage:
     def __init__(self, storage_dir: str, order: int = 64):
         self.storage_dir = storage_dir
+        # pickled articles of older versions, only read to migrate them
         self.binary_dir = os.path.join(storage_dir, "binary")
         self.index_dir = os.path.join(storage_dir, "index")
+        self.index_order = order
 
-        os.makedirs(self.binary_dir, exist_ok=True)
         os.makedirs(self.index_dir, exist_ok=True)
 
-        # literature_id -> (filename, offset, len)
-        self.main_index = BPTreeIntStr(order)
-        # author -> [literature_id]
-        self.author_index = BPTreeWStrVecInt(order)
+        # literature_id -> article record
+        self.records = RecordStore(os.path.join(
+            storage_dir, "records"), MAX_FILE_SIZE, RECORD_CACHE_SIZE)
+        # literature_id -> year, author ids, keyword ids for the statistics
+        self.columns = ColumnStore(os.path.join(storage_dir, "columns"))
+        # author id -> [literature_id], ids of the names in the columns
+        self.author_index = BPTreeIntVecInt(order)
         # title -> literature_id
         self.title_index = BPTreeWStrInt(order)
-        # keyword -> [literature_id]
-        self.keyword_index = BPTreeWStrVecInt(order)
+        # keyword id -> [literature_id]
+        self.keyword_index = BPTreeIntVecInt(order)
         # year -> [literature_id]
         self.date_index = BPTreeIntVecInt(order)
+        # (keyword id, year) -> [literature_id], the years of a keyword in a row
+        self.keyword_year_index = BPTreeKeywordYearVecInt(order)
+        # what requests read, published after every change
+        self.view = None
+
+        # coauthor graph kept after the first clique count, later imports
+        # only count the cliques that contain their new edges
+        self.clique_graph = None
+        self.clique_graph_ids = None
+        # coauthor edges added to clique_graph after it was built
+        self.clique_graph_edges = []
+        # max_k -> (counts, number of clique_graph_edges they include)
+        self.clique_counts = {}
+        # guards the graph and its edges, articles may be added while a
+        # count runs with the GIL released
+        self.clique_graph_lock = threading.RLock()
+        # one count at a time, so only the count that recorded them trims
+        # the edges
+        self.clique_count_lock = threading.Lock()
 
         self._load_indices()
         self.max_article_id = self._get_max_article_id()
-        self.current_bin_file = self._get_current_bin_file()
+        self._migrate_legacy_records()
+        self._build_columns()
+        self._rebuild_damaged_indices()
+        self._migrate_name_indices()
+        self._publish()
+
+        # coauthor graph and clique counts of a previous run, tagged with
+        # the max_article_id they were computed at
+        self.clique_snapshot_path = os.path.join(self.index_dir, "cliques.snap")
+        self.clique_snapshot = self._load_clique_snapshot()
+        # whether clique_graph is exactly the graph of clique_snapshot
+        self.clique_graph_matches_snapshot = False
 
         # self.benchmark()
 
+    def _index_files(self) -> dict:
+        return {
+            "author": (self.author_index, os.path.join(self.index_dir, "author_id_index.dat")),
+            "title": (self.title_index, os.path.join(self.index_dir, "title_index.dat")),
+            "keyword": (self.keyword_index, os.path.join(self.index_dir, "keyword_id_index.dat")),
+            "date": (self.date_index, os.path.join(self.index_dir, "date_index.dat")),
+            "keyword_year": (self.keyword_year_index, os.path.join(self.index_dir, "keyword_year_index.dat")),
+        }
+
     def _load_indices(self):
-        main_index_file = os.path.join(self.index_dir, "main_index.dat")
-        author_index_file = os.path.join(self.index_dir, "author_index.dat")
-        title_index_file = os.path.join(self.index_dir, "title_index.dat")
-        keyword_index_file = os.path.join(self.index_dir, "keyword_index.dat")
-        date_index_file = os.path.join(self.index_dir, "date_index.dat")
-
-        if os.path.exists(main_index_file):
-            self.main_index.deserialize(main_index_file)
-        if os.path.exists(author_index_file):
-            self.author_index.deserialize(author_index_file)
-        if os.path.exists(title_index_file):
-            self.title_index.deserialize(title_index_file)
-        if os.path.exists(keyword_index_file):
-            self.keyword_index.deserialize(keyword_index_file)
-        if os.path.exists(date_index_file):
-            self.date_index.deserialize(date_index_file)
+        # indices whose file failed its checks, rebuilt once the columns are up
+        self.damaged_indices = []
+
+        def load(name, index, index_file):
+            try:
+                index.deserialize_lazy(index_file, INDEX_LEAF_BUDGET)
+            except RuntimeError as e:
+                print(f"{e}, rebuilding the {name} index")
+                self.damaged_indices.append(name)
+
+        # loading releases the GIL, so the files load side by side
+        loaders = [threading.Thread(target=load, args=(name, index, index_file))
+                   for name, (index, index_file) in self._index_files().items()
+                   if os.path.exists(index_file)]
+        for loader in loaders:
+            loader.start()
+        for loader in loaders:
+            loader.join()
+
+        # an index newer than the other files is built like a damaged one
+        missing = [name for name, (_, index_file) in self._index_files().items()
+                   if not os.path.exists(index_file)]
+        if len(missing) < len(self._index_files()):
+            self.damaged_indices.extend(missing)
+
+        # ids past the end of a dict are of names it lost, interned again
+        # they get other ids; such an index is built again from scratch
+        top = 2 ** 31 - 1
+        authors, keywords = self.columns.author_dict_size(), self.columns.keyword_dict_size()
+        lost_ids = {
+            "author": lambda: self.author_index.range(authors, top),
+            "keyword": lambda: self.keyword_index.range(keywords, top),
+            "keyword_year": lambda: self.keyword_year_index.range((keywords, -top - 1), (top, top)),
+        }
+        for name, lost in lost_ids.items():
+            if name not in self.damaged_indices and lost():
+                print(f"The {name} index has ids past its names, rebuilding it")
+                self.damaged_indices.append(name)
+                index, _ = self._index_files()[name]
+                setattr(self, f"{name}_index", type(index)(self.index_order))
+
+    def _rebuild_damaged_indices(self) -> None:
+        if not self.damaged_indices:
+            return
+
+        index_files = self._index_files()
+        for name in self.damaged_indices:
+            # the damaged file is kept aside
+            index_file = index_files[name][1]
+            if os.path.exists(index_file):
+                os.replace(index_file, index_file + ".corrupt")
+
+        article_ids = sorted(self.records.ids())
+        if "author" in self.damaged_indices:
+            for article_id in article_ids:
+                for author_id in self.columns.author_ids(article_id):
+                    self.author_index.append(author_id, article_id)
+        if "keyword" in self.damaged_indices:
+            for article_id in article_ids:
+                for keyword_id in self.columns.keyword_ids(article_id):
+                    self.keyword_index.append(keyword_id, article_id)
+        if "date" in self.damaged_indices:
+            for article_id in article_ids:
+                self.date_index.append(self.columns.year(article_id), article_id)
+        if "keyword_year" in self.damaged_indices:
+            for article_id in article_ids:
+                year = self.columns.year(article_id)
+                for keyword_id in self.columns.keyword_ids(article_id):
+                    self.keyword_year_index.append((keyword_id, year), article_id)
+        if "title" in self.damaged_indices:
+            # duplicates get the titles add_article gave them
+            for article in self.get_articles_by_ids(article_ids):
+                if self.title_index.find(article.title) is None:
+                    self.title_index.insert(article.title, article.article_id)
+                else:
+                    self.title_index.insert(
+                        f"{article.title} - dup id({article.article_id})", article.article_id)
+
+        self._save_indices()
+        self.damaged_indices = []
 
     def _save_indices(self):
-        self.main_index.serialize(os.path.join(
-            self.index_dir, "main_index.dat"))
-        self.author_index.serialize(os.path.join(
-            self.index_dir, "author_index.dat"))
-        self.title_index.serialize(os.path.join(
-            self.index_dir, "title_index.dat"))
-        self.keyword_index.serialize(os.path.join(
-            self.index_dir, "keyword_index.dat"))
-        self.date_index.serialize(os.path.join(
-            self.index_dir, "date_index.dat"))
-
-        with open(os.path.join(self.storage_dir, "max_article_id"), "w") as f:
+        self.records.flush()
+        self.columns.flush()
+        # serialize raises RuntimeError if an index cannot be written; the
+        # max_article_id of the files on disk only moves on once all are
+        for index, index_file in self._index_files().values():
+            index.serialize(index_file)
+
+        max_id_path = os.path.join(self.storage_dir, "max_article_id")
+        with open(max_id_path + ".tmp", "w") as f:
             f.write(str(self.max_article_id))
+            f.flush()
+            os.fsync(f.fileno())
+        os.replace(max_id_path + ".tmp", max_id_path)
 
     def _get_max_article_id(self) -> int:
         max_id_path = os.path.join(self.storage_dir, "max_article_id")
@@ -83,74 +216,119 @@ class LiteratureStorage:
 
         return 0
 
-    def _get_current_bin_file(self) -> str:
-        bin_files = [f for f in os.listdir(
-            self.binary_dir) if f.startswith("articles_")]
+    def _migrate_legacy_records(self) -> None:
+        # articles used to be pickled into binary/articles_*.bin, located
+        # by "file,offset,len" strings in index/main_index.dat
+        main_index_file = os.path.join(self.index_dir, "main_index.dat")
+        if not os.path.exists(main_index_file):
+            return
+
+        main_index = BPTreeIntStr(64)
+        main_index.deserialize(main_index_file)
+
+        article_ids = main_index.keys()
+        print(f"Migrating {len(article_ids)} articles to the record store...")
 
-        if not bin_files:
-            return os.path.join(self.binary_dir, "articles_1.bin")
+        for article_id in article_ids:
+            file_path, offset, length = main_index.find(article_id).split(',')
 
-        latest_file = sorted(bin_files, key=lambda f: int(
-            f.split('_')[1].split('.')[0]))[-1]
-        file_path = os.path.join(self.binary_dir, latest_file)
+            with open(os.path.join(self.binary_dir, file_path), 'rb') as f:
+                f.seek(int(offset))
+                article_dict = pickle.loads(f.read(int(length)))
 
-        if os.path.getsize(file_path) >= MAX_FILE_SIZE:
-            start_id = int(latest_file.split('_')[2].split('.')[0]) + 1
-            new_file = f"articles_{start_id}.bin"
-            return os.path.join(self.binary_dir, new_file)
+            self.records.put(article_id, self._article_record(
+                Article.from_dict(article_dict)))
 
-        return file_path
+        self.records.flush()
+
+        # the bin files are left in place, the old index is kept aside
+        os.replace(main_index_file, main_index_file + ".migrated")
+
+    def _build_columns(self) -> None:
+        # the columns are derived from the records, fill them in when they
+        # are missing or behind (first run, or a crash before their flush)
+        if len(self.columns) == len(self.records):
+            return
+
+        print(f"Building columns for {len(self.records)} articles...")
+        for article in self.get_articles_by_ids(self.records.ids()):
+            self._put_columns(article)
+
+        self.columns.flush()
+
+    def _migrate_name_indices(self) -> None:
+        # the author and keyword indices used to be keyed by the names in
+        # index/author_index.dat and index/keyword_index.dat
+        migrated = []
+        for name, index, find in (("author", self.author_index, self.columns.find_author),
+                                  ("keyword", self.keyword_index, self.columns.find_keyword)):
+            old_file = os.path.join(self.index_dir, f"{name}_index.dat")
+            if not os.path.exists(old_file):
+                continue
+
+            old_index = BPTreeWStrVecInt(64)
+            old_index.deserialize(old_file)
+            print(f"Migrating the {name} index to {name} ids...")
+
+            for key, article_ids in zip(old_index.keys(), old_index.values()):
+                key_id = find(key)
+                if key_id >= 0:
+                    index.insert(key_id, article_ids)
+            migrated.append(old_file)
+
+        if not migrated:
+            return
+
+        self._save_indices()
+        # the old indices are kept aside
+        for old_file in migrated:
+            os.replace(old_file, old_file + ".migrated")
+
+    def _put_columns(self, article: Article) -> None:
+        self.columns.put(article.article_id, article.year or 0,
+                         article.authors or [], article.keywords or [])
+
+    @staticmethod
+    def _article_record(article: Article) -> list:
+        data = article.to_dict()
+        return [data[field] for field in RECORD_FIELDS]
+
+    @staticmethod
+    def _record_article(record: list) -> Article:
+        return Article.from_dict(dict(zip(RECORD_FIELDS, record)))
+
+    def _publish(self) -> None:
+        # a view is dropped with the last request still reading it; until
+        # then the trees keep the nodes it sees
+        self.view = IndexView(self.author_index.snapshot(), self.title_index.snapshot(),
+                              self.keyword_index.snapshot(), self.date_index.snapshot(),
+                              self.keyword_year_index.snapshot(),
+                              self.max_article_id, self.columns.author_dict_size(),
+                              len(self.columns), self.columns.average_keyword_count())
 
     def _clear_cache(self) -> None:
-        self.count_cliques_with_progress.cache.clear()
-        self.get_yearly_keyword_frequencies.cache_clear()
-        self.get_author_article_counts.cache_clear()
+        self.count_author_cliques.cache.clear()
+        self.get_yearly_keyword_frequencies.cache.clear()
 
     def add_article(self, article: Article, save_immediately=True) -> int:
         if article.article_id is None:
             self.max_article_id += 1
             article.article_id = self.max_article_id
 
-        article_data = pickle.dumps(article.to_dict())
-
-        current_file_path = self.current_bin_file
-        if os.path.exists(current_file_path) and os.path.getsize(current_file_path) + len(article_data) > MAX_FILE_SIZE:
-            # new file
-            start_id = article.article_id
-            new_file = f"articles_{start_id}.bin"
-            self.current_bin_file = os.path.join(self.binary_dir, new_file)
-            current_file_path = self.current_bin_file
+        self.records.put(article.article_id, self._article_record(article))
+        self._put_columns(article)
 
-        # write data
-        with open(current_file_path, 'ab') as f:
-            offset = f.tell()
-            f.write(article_data)
+        self._add_clique_graph_edges(article.authors)
 
-        rel_path = os.path.relpath(current_file_path, self.binary_dir)
+        # update author index, by the ids the columns gave the names
+        for author_id in self.columns.author_ids(article.article_id):
+            self.author_index.append(author_id, article.article_id)
 
-        # update main index
-        location_info = f"{rel_path},{offset},{len(article_data)}"
-        self.main_index.insert(article.article_id, location_info)
-
-        # update author index
-        for author in article.authors:
-            author_articles = self.author_index.find(author)
-            if author_articles is None:
-                self.author_index.insert(author, [article.article_id])
-            else:
-                if article.article_id not in author_articles:
-                    author_articles.append(article.article_id)
-                    self.author_index.update(author, author_articles)
-
-        # update keyword index
-        for keyword in article.keywords:
-            kw_articles = self.keyword_index.find(keyword)
-            if kw_articles is None:
-                self.keyword_index.insert(keyword, [article.article_id])
-            else:
-                if article.article_id not in kw_articles:
-                    kw_articles.append(article.article_id)
-                    self.keyword_index.update(keyword, kw_articles)
+        # update keyword and keyword-year index
+        year = self.columns.year(article.article_id)
+        for keyword_id in self.columns.keyword_ids(article.article_id):
+            self.keyword_index.append(keyword_id, article.article_id)
+            self.keyword_year_index.append((keyword_id, year), article.article_id)
 
         # update title index
         if self.title_index.find(article.title) is None:
@@ -164,20 +342,51 @@ class LiteratureStorage:
             self.title_index.insert(new_title, article.article_id)
 
         # update date index
-        year_articles = self.date_index.find(article.year)
-        if year_articles is None:
-            self.date_index.insert(article.year, [article.article_id])
-        else:
-            if article.article_id not in year_articles:
-                year_articles.append(article.article_id)
-                self.date_index.update(article.year, year_articles)
+        self.date_index.append(article.year, article.article_id)
 
         if save_immediately:
             self._save_indices()
+            self._publish()
             self._clear_cache()
 
         return article.article_id
 
+    def add_articles(self, articles: List[Article], save_immediately=True) -> List[int]:
+        article_ids = [self.add_article(article, save_immediately=False)
+                       for article in articles]
+        self._publish()
+
+        if save_immediately:
+            self._save_indices()
+            self._clear_cache()
+
+        return article_ids
+
+    def bulk_import(self, xml_paths: List[str], threads: int = 0) -> BulkImportStats:
+        # offline rebuild: the files are parsed on threads (0 for one per
+        # core) and every index is built once from the merged runs
+        if self.max_article_id != 0 or len(self.records) != 0:
+            raise ValueError("bulk import needs an empty storage")
+
+        try:
+            stats = bulk_import(xml_paths, list(RECORD_FIELDS), self.records, self.columns,
+                                self.author_index, self.title_index, self.keyword_index, self.date_index,
+                                self.keyword_year_index,
+                                first_id=1, threads=threads)
+        except Exception:
+            # the stores were cleared, the indices may be partly loaded;
+            # empty ones let the import be retried
+            for name, (index, _) in self._index_files().items():
+                setattr(self, f"{name}_index", type(index)(self.index_order))
+            self._publish()
+            raise
+        self.max_article_id = stats.articles
+
+        self._save_indices()
+        self._publish()
+        self._clear_cache()
+        return stats
+
     def benchmark(self, iterations=10000):
         import time
         import random
@@ -194,10 +403,10 @@ class LiteratureStorage:
             print("ERR: nothing to test!")
             return
 
-        all_article_ids = self.main_index.keys()
-        all_authors = self.author_index.keys()
+        all_article_ids = self.records.ids()
+        all_authors = self.columns.author_names(self.author_index.keys())
         all_titles = self.title_index.keys()
-        all_keywords = self.keyword_index.keys()
+        all_keywords = self.columns.keyword_names(self.keyword_index.keys())
 
         if not all_article_ids or not all_authors or not all_titles:
             print("ERR: not enough data to test!")
@@ -328,6 +537,26 @@ class LiteratureStorage:
                     keyword_search_timings) > 1 else 0
             ])
 
+            # whole titles as queries, top 10
+            print("benchmarking search_articles_ranked...")
+            ranked_search_timings = []
+            for i in range(iterations):
+                title = random_titles[i % len(random_titles)]
+                start_time = time.time()
+                self.search_articles_ranked(title, 10)
+                ranked_search_timings.append(time.time() - start_time)
+
+            detailed_timing["search_articles_ranked"] = ranked_search_timings
+            results.append([
+                "search_articles_ranked",
+                statistics.mean(ranked_search_timings),
+                statistics.median(ranked_search_timings),
+                min(ranked_search_timings),
+                max(ranked_search_timings),
+                statistics.stdev(ranked_search_timings) if len(
+                    ranked_search_timings) > 1 else 0
+            ])
+
         print("benchmarking get_yearly_keyword_frequencies...")
         start_time = time.time()
         self.get_yearly_keyword_frequencies()
@@ -348,180 +577,474 @@ class LiteratureStorage:
         headers = ["Function", "Avg", "Med", "Min", "Max", "Std"]
         print(tabulate(results, headers=headers, tablefmt="grid", floatfmt=".8f"))
 
-    def get_article_by_id(self, article_id: int) -> Optional[Article]:
-        location_info = self.main_index.find(article_id)
-        if location_info is None:
-            return None
+        cache_stats = self.records.cache_stats()
+        print(f"record cache: {cache_stats.hit_rate:.1%} hits, {cache_stats.entries} records, "
+              f"{cache_stats.bytes / 1024 / 1024:.1f} MB")
+        for name, (index, _) in self._index_files().items():
+            pool_stats = index.leaf_pool_stats()
+            print(f"{name} index leaves: {pool_stats.hit_rate:.1%} hits, {pool_stats.entries} in memory, "
+                  f"{pool_stats.bytes / 1024 / 1024:.1f} MB")
+
+    def benchmark_pivoter(self, max_ks=(3, 4, 5, 6, 8, 10, 15, 20, None), iterations=3):
+        import time
+        import statistics
+        from tabulate import tabulate
 
-        file_path, offset, length = location_info.split(',')
-        offset, length = int(offset), int(length)
+        print("building coauthor graph...")
+        start_time = time.time()
+        adjacency_list = self.build_adjacency_list_with_progress()
+        build_time = time.time() - start_time
 
-        full_path = os.path.join(self.binary_dir, file_path)
+        num_edges = sum(len(neighbors) for neighbors in adjacency_list) // 2
+        print(f"{len(adjacency_list)} authors, {num_edges} edges, built in {build_time:.2f}s")
 
-        with open(full_path, 'rb') as f:
-            f.seek(offset)
-            article_data = f.read(length)
+        results = []
+        for max_k in max_ks:
+            print(f"benchmarking pivoter with max_k={max_k}...")
+            timings = []
+            for _ in range(iterations):
+                start_time = time.time()
+                counts = pivoter(adjacency_list, max_k)
+                timings.append(time.time() - start_time)
 
-        try:
-            article_dict = pickle.loads(article_data)
-            return Article.from_dict(article_dict)
-        except Exception as e:
-            print(f"Error loading article {article_id}: {e}")
+            results.append([
+                "full" if max_k is None else max_k,
+                max(counts.keys()),
+                statistics.mean(timings),
+                min(timings),
+                max(timings),
+            ])
+
+        print("\n--- Pivoter Benchmark Results (Unit: Second) ---")
+        headers = ["max_k", "Largest Clique", "Avg", "Min", "Max"]
+        print(tabulate(results, headers=headers, tablefmt="grid", floatfmt=".4f"))
+
+    def get_article_by_id(self, article_id: int) -> Optional[Article]:
+        record = self.records.get(article_id)
+        if record is None:
             return None
 
+        return self._record_article(record)
+
+    def get_articles_by_ids(self, article_ids: List[int]) -> List[Article]:
+        # one native call reads and decodes every record
+        return [self._record_article(record)
+                for record in self.records.get_many(article_ids) if record is not None]
+
     def get_articles_by_author(self, author: str) -> List[Article]:
-        article_ids = self.author_index.find(author)
+        article_ids = self.view.author.find(self.columns.find_author(author))
         if article_ids is None:
             return []
 
-        return [self.get_article_by_id(article_id) for article_id in article_ids]
+        return self.get_articles_by_ids(article_ids)
 
     def get_article_by_title(self, title: str) -> Optional[Article]:
-        article_id = self.title_index.find(title)
+        article_id = self.view.title.find(title)
         if article_id is None:
             return None
 
         return self.get_article_by_id(article_id)
 
-    def get_collaborators(self, author: str) -> Dict[str, int]:
-        articles = self.get_articles_by_author(author)
-        collaborators = {}
-
-        for article in articles:
-            for coauthor in article.authors:
-                if coauthor != author:
-                    if coauthor in collaborators.keys():
-                        collaborators[coauthor] += 1
-                    else:
-                        collaborators[coauthor] = 1
+    def get_collaborators(self, author: str, limit: Optional[int] = None) -> Dict[str, int]:
+        author_id = self._find_published_author(author)
+        if author_id < 0:
+            return {}
+
+        # the coauthor index keeps the counts, most shared articles first
+        # when only the top ones are wanted; authors of an import still
+        # running are left out, its articles count already
+        num_authors = self.view.num_authors
+        if limit is None:
+            counts = self.columns.coauthors(author_id)
+        else:
+            # enough for limit once the unpublished authors are left out
+            unpublished = self.columns.author_dict_size() - num_authors
+            counts = self.columns.top_coauthors(author_id, limit + unpublished)
+        counts = [(coauthor_id, count) for coauthor_id, count in counts
+                  if coauthor_id < num_authors][:limit]
+        names = self.columns.author_names([coauthor_id for coauthor_id, _ in counts])
 
-        return collaborators
+        return {name: count for name, (_, count) in zip(names, counts)}
 
     def get_collaborators_only(self, author: str) -> List[str]:
-        articles = self.get_articles_by_author(author)
-        collaborators = set()
-
-        for article in articles:
-            for coauthor in article.authors:
-                if coauthor != author:
-                    collaborators.add(coauthor)
+        author_id = self._find_published_author(author)
+        if author_id < 0:
+            return []
 
-        return list(collaborators)
+        num_authors = self.view.num_authors
+        return self.columns.author_names(
+            [coauthor_id for coauthor_id, _ in self.columns.coauthors(author_id) if coauthor_id < num_authors])
 
     def get_coauthor_articles(self, author: str, coauthor: str) -> List[Article]:
-        articles = self.get_articles_by_author(author)
-        articles = [
-            article for article in articles if coauthor in article.authors]
-
-        return articles
+        author_id = self._find_published_author(author)
+        coauthor_id = self._find_published_author(coauthor)
+        if author_id < 0 or coauthor_id < 0:
+            return []
 
-    def search_articles_by_keywords(self, keywords_pattern: str) -> List[Article]:
-        kws = extract_keywords_basic(keywords_pattern)
+        # ascending, the articles of an import still running come last
+        shared = self.columns.shared_articles(author_id, coauthor_id)
+        published = bisect.bisect_right(shared, self.view.max_article_id)
+        return self.get_articles_by_ids(shared[:published])
 
-        result_set = set(self.keyword_index.find(kws[0]))
+    def _find_published_author(self, author: str) -> int:
+        # -1 for names only interned by an import still running
+        author_id = self.columns.find_author(author)
+        return author_id if author_id < self.view.num_authors else -1
 
-        for kw in kws[1:]:
-            result_set.intersection_update(set(self.keyword_index.find(kw)))
+    def find_authors_fuzzy(self, name: str, max_distance: int = 2, limit: int = 10) -> List[Tuple[str, int, int]]:
+        # (name, edit distance, articles) of the authors closest to name,
+        # ignoring case, accents and the DBLP disambiguation number
+        matches = self.columns.find_authors_fuzzy(name, max_distance, limit, self.view.num_authors)
+        names = self.columns.author_names([author_id for author_id, _ in matches])
+        author_index = self.view.author
 
-        matched_articles = [self.get_article_by_id(id) for id in result_set]
-        return matched_articles
+        return [(author, distance, author_index.count(author_id))
+                for author, (author_id, distance) in zip(names, matches)]
 
-    @lru_cache(maxsize=None)
-    def get_author_article_counts(self) -> Dict[str, int]:
-        author_counts = {}
+    def search_articles_by_keywords(self, keywords_pattern: str) -> List[Article]:
+        kws = extract_keywords_basic(keywords_pattern)
+        keyword_index = self.view.keyword
 
-        all_authors = self.author_index.keys()
+        # every keyword must match, one not in the index matches nothing
+        posting_lists = [keyword_index.find(self.columns.find_keyword(kw)) for kw in kws]
+        if not posting_lists or None in posting_lists:
+            return []
 
-        for author in all_authors:
-            articles = self.author_index.find(author)
-            if articles:
-                author_counts[author] = len(articles)
+        result_set = set(posting_lists[0])
 
-        return author_counts
+        for article_ids in posting_lists[1:]:
+            result_set.intersection_update(article_ids)
 
-    @lru_cache(maxsize=None)
-    def get_yearly_keyword_frequencies(self) -> Dict[int, Dict[str, float]]:
-        yearly_keywords = {}
-        yearly_total_articles = {}
+        matched_articles = self.get_articles_by_ids(list(result_set))
+        return matched_articles
 
-        years = self.date_index.keys()[1:]
-        article_ids_per_year = self.date_index.values()[1:]
-        for year, article_ids in zip(years, article_ids_per_year):
-            if year == 0:
+    def search_articles_ranked(self, keywords_pattern: str, limit: int = 20) -> List[Tuple[Article, float]]:
+        # the limit best articles by BM25 over the keywords of the titles,
+        # any keyword may match
+        keyword_ids = [self.columns.find_keyword(kw) for kw in extract_keywords_basic(keywords_pattern)]
+        view = self.view
+        scored = search_bm25(view.keyword, self.columns, keyword_ids, limit,
+                             num_articles=view.num_articles, average_keywords=view.average_keywords)
+
+        articles = {article.article_id: article
+                    for article in self.get_articles_by_ids([result.id for result in scored])}
+        return [(articles[result.id], result.score) for result in scored if result.id in articles]
+
+    def get_author_article_counts(self, limit: Optional[int] = None) -> Dict[str, int]:
+        if limit is None:
+            # count() reads the list length without copying the list
+            author_index = self.view.author
+            author_ids = author_index.keys()
+            return {author: author_index.count(author_id)
+                    for author, author_id in zip(self.columns.author_names(author_ids), author_ids)}
+
+        # the coauthor index keeps the authors ranked by article count,
+        # counting the articles of an import still running
+        num_authors = self.view.num_authors
+        unpublished = self.columns.author_dict_size() - num_authors
+        ranked = [(author_id, count) for author_id, count in self.columns.top_authors(limit + unpublished)
+                  if author_id < num_authors][:limit]
+        names = self.columns.author_names([author_id for author_id, _ in ranked])
+
+        return {name: count for name, (_, count) in zip(names, ranked)}
+
+    def get_keyword_trend(self, keywords: List[str], first_year: int, last_year: int) -> Dict[str, Dict[int, int]]:
+        # one range scan over the years of each keyword
+        keyword_year_index = self.view.keyword_year
+        trend = {}
+        for keyword in keywords:
+            keyword_id = self.columns.find_keyword(keyword)
+            if keyword_id < 0:
+                trend[keyword] = {}
                 continue
-            yearly_total_articles[year] = len(article_ids)
-            yearly_keywords[year] = {}
+            trend[keyword] = {year: len(article_ids) for (_, year), article_ids in
+                              keyword_year_index.range((keyword_id, first_year), (keyword_id, last_year))}
 
-        keyword_count = 0
-
-        keywords = self.keyword_index.keys()
-        keyword_article_ids = self.keyword_index.values()
+        return trend
 
+    @cached(cache=LRUCache(maxsize=YEARLY_KEYWORDS_CACHE_SIZE),
+            key=lambda self, limit=None: (limit, self.view.max_article_id))
+    def get_yearly_keyword_frequencies(self, limit: Optional[int] = None) -> Dict[int, Dict[str, float]]:
+        # keywords of every year by frequency, only the first limit of them
+        # are converted to Python when a limit is given
         blacklist = ["based", "of", "the", "using", "via"]
-        filtered_data = [(word, ids) for word, ids in zip(
-            keywords, keyword_article_ids) if word not in blacklist]
+        excluded = [keyword_id for keyword_id in map(
+            self.columns.find_keyword, blacklist) if keyword_id >= 0]
 
-        article_to_year = {}
-        for year, article_ids in zip(years, article_ids_per_year):
-            for article_id in article_ids:
-                article_to_year[article_id] = year
+        if limit is not None and limit <= 0:
+            # the years without keywords; 0 means all to the native counts
+            return {year: {} for year in self.columns.yearly_keyword_counts(
+                excluded, 1, max_article_id=self.view.max_article_id)}
 
-        for keyword, article_ids in filtered_data:
-            keyword_count += 1
-            for article_id in article_ids:
-                year = article_to_year.get(article_id)
-                if year is not None:
-                    if keyword not in yearly_keywords[year]:
-                        yearly_keywords[year][keyword] = 0
-                    yearly_keywords[year][keyword] += 1
-
-        freq_count = 0
-        for year in yearly_keywords:
-            total = yearly_total_articles[year]
-            for keyword in yearly_keywords[year]:
-                yearly_keywords[year][keyword] = yearly_keywords[year][keyword] / total
-                freq_count += 1
+        yearly_keywords = {}
+        for year, counts in self.columns.yearly_keyword_counts(
+                excluded, limit or 0, max_article_id=self.view.max_article_id).items():
+            names = self.columns.keyword_names(counts.keyword_ids)
+            yearly_keywords[year] = {
+                name: count / counts.articles for name, count in zip(names, counts.counts)}
 
         return yearly_keywords
 
-    @cached(cache={}, key=lambda *args, **kwargs: 1)
-    def count_cliques_with_progress(self, progress_callback=None):
-        adjacency_list = self.build_adjacency_list_with_progress(
-            progress_callback)
+    def count_cliques_with_progress(self, progress_callback=None, max_k=None, cancel_token=None):
+        # a snapshot of the current data answers without building the graph
+        if self.clique_graph is None and self.clique_snapshot is not None \
+                and self.clique_snapshot.tag == self.max_article_id:
+            snapshot_counts = self.clique_snapshot.counts()
+            if max_k in snapshot_counts:
+                return {key: int(value) for key, value in snapshot_counts[max_k].items()}
+
+        self._build_clique_graph(progress_callback, cancel_token)
 
         if progress_callback:
             progress_callback("pivoter", 0, 100)
 
-        result = pivoter(adjacency_list)
+        with self.clique_count_lock:
+            counts = self._count_cliques(progress_callback, max_k, cancel_token)
 
         if progress_callback:
             progress_callback("pivoter", 100, 100)
 
-        result = {key: int(value) for key, value in result.items()}
+        return dict(counts)
 
-        return result
+    def _count_cliques(self, progress_callback, max_k, cancel_token) -> Dict[int, int]:
+        changed = not self.clique_graph_matches_snapshot
 
-    def build_adjacency_list_with_progress(self, progress_callback=None):
-        all_authors = list(self.author_index.keys())
-        author_to_id = {author: idx for idx, author in enumerate(all_authors)}
-        num_vertices = len(all_authors)
+        if max_k not in self.clique_counts:
+            def pivoter_progress(done, total):
+                progress_callback("pivoter", done, total)
 
-        adjacency_list = [set() for _ in range(num_vertices)]
+            progress = pivoter_progress if progress_callback else None
+
+            # the count covers the graph as it is now, the edges added while
+            # it runs are counted by the next one
+            with self.clique_graph_lock:
+                counted = len(self.clique_graph_edges)
+                use_snapshot = self.clique_graph_matches_snapshot
+                graph = None if use_snapshot else [set(neighbors) for neighbors in self.clique_graph]
 
-        total_authors = len(all_authors)
-        for idx, author in enumerate(all_authors):
-            author_id = author_to_id[author]
-            collaborators = self.get_collaborators_only(author)
+            # the count releases the GIL, other requests keep being served
+            if use_snapshot:
+                result = self.clique_snapshot.pivoter(
+                    max_k, progress=progress, cancel_token=cancel_token)
+            else:
+                result = pivoter(graph, max_k,
+                                 progress=progress, cancel_token=cancel_token)
+            counts = {key: int(value) for key, value in result.items()}
+            changed = True
+        else:
+            # only the cliques of the new edges, cheap enough to count
+            # while imports wait
+            with self.clique_graph_lock:
+                counts, counted_edges = self.clique_counts[max_k]
+                counts = dict(counts)
+
+                new_edges = self.clique_graph_edges[counted_edges:]
+                counted = counted_edges + len(new_edges)
+                if new_edges:
+                    result = pivoter_incremental(
+                        self._clique_neighborhoods(new_edges), new_edges, max_k)
+                    for key, value in result.items():
+                        counts[key] = counts.get(key, 0) + int(value)
+                    changed = True
+
+                # authors without coauthors add vertices but no edges
+                if self.clique_graph:
+                    counts[1] = len(self.clique_graph)
+
+        with self.clique_graph_lock:
+            self.clique_counts[max_k] = (counts, counted)
+            self._trim_clique_graph_edges()
+
+        if changed:
+            self._save_clique_snapshot()
+
+        return counts
+
+    def estimate_cliques(self, max_k=None, time_budget_ms=1000) -> Dict[int, Tuple[float, float, float]]:
+        # k -> (estimate, low, high) of a 95% confidence interval
+        self._build_clique_graph()
+
+        # exact counts kept up to date on import are as cheap as an estimate
+        if max_k in self.clique_counts:
+            counts = self.count_cliques_with_progress(max_k=max_k)
+            return {k: (count, count, count) for k, count in counts.items()}
+
+        # the budget only covers the sampling; a graph still matching the
+        # snapshot reuses its stored ordering instead of computing one
+        with self.clique_graph_lock:
+            use_snapshot = self.clique_graph_matches_snapshot
+        if use_snapshot:
+            return self.clique_snapshot.estimate(max_k, time_budget_ms)
+
+        return pivoter_estimate(self.clique_graph, max_k, time_budget_ms)
+
+    def _build_clique_graph(self, progress_callback=None, cancel_token=None) -> None:
+        with self.clique_graph_lock:
+            if self.clique_graph is not None:
+                return
+
+            if self.clique_snapshot is not None:
+                self._load_clique_graph_from_snapshot()
+                return
+
+            author_ids = self.view.author.keys()
+            clique_graph = self.build_adjacency_list_with_progress(
+                progress_callback, cancel_token, author_ids)
+            self.clique_graph_ids = {author: idx for idx, author in
+                                     enumerate(self.columns.author_names(author_ids))}
+            self.clique_graph_edges = []
+            self.clique_counts = {}
+            self.clique_graph = clique_graph
+            self.clique_graph_matches_snapshot = False
+
+    def _load_clique_snapshot(self) -> Optional[CliqueSnapshot]:
+        if not os.path.exists(self.clique_snapshot_path):
+            return None
+
+        try:
+            snapshot = CliqueSnapshot(self.clique_snapshot_path)
+        except RuntimeError as e:
+            print(f"Ignoring clique snapshot: {e}")
+            return None
+
+        # articles are only appended, a snapshot of a later state than the
+        # saved indices can't be used
+        if snapshot.tag > self.max_article_id:
+            return None
+
+        return snapshot
+
+    def _load_clique_graph_from_snapshot(self) -> None:
+        snapshot = self.clique_snapshot
+
+        self.clique_graph = snapshot.adjacency_list()
+        self.clique_graph_ids = {author: idx for idx,
+                                 author in enumerate(snapshot.labels())}
+        self.clique_graph_edges = []
+        self.clique_counts = {max_k: ({key: int(value) for key, value in counts.items()}, 0)
+                              for max_k, counts in snapshot.counts().items()}
+        self.clique_graph_matches_snapshot = True
+
+        # articles imported after the snapshot was taken
+        for article in self.get_articles_by_ids(list(range(snapshot.tag + 1, self.max_article_id + 1))):
+            self._add_clique_graph_edges(article.authors)
+
+    def _save_clique_snapshot(self) -> None:
+        # only a copy is taken under the lock, imports go on while it is
+        # written; the callers hold clique_count_lock, so one save at a time
+        with self.clique_graph_lock:
+            # only the counts that include every edge of the graph
+            counts = {max_k: {key: str(value) for key, value in counts.items()}
+                      for max_k, (counts, counted_edges) in self.clique_counts.items()
+                      if counted_edges == len(self.clique_graph_edges)}
+
+            labels = [None] * len(self.clique_graph)
+            for author, idx in self.clique_graph_ids.items():
+                labels[idx] = author
 
-            for collaborator in collaborators:
-                if collaborator in author_to_id:
-                    collaborator_id = author_to_id[collaborator]
+            graph = [set(neighbors) for neighbors in self.clique_graph]
+            edges = len(self.clique_graph_edges)
+            tag = self.max_article_id
 
-                    adjacency_list[author_id].add(collaborator_id)
-                    adjacency_list[collaborator_id].add(author_id)
+        try:
+            save_snapshot(self.clique_snapshot_path, graph, counts, tag, labels)
+            snapshot = CliqueSnapshot(self.clique_snapshot_path)
+        except RuntimeError as e:
+            print(f"Failed to save clique snapshot: {e}")
+            return
+
+        with self.clique_graph_lock:
+            self.clique_snapshot = snapshot
+            # vertices and edges are only appended, and only trimmed under
+            # clique_count_lock
+            self.clique_graph_matches_snapshot = \
+                len(self.clique_graph) == len(graph) and len(self.clique_graph_edges) == edges
+
+    def _add_clique_graph_edges(self, authors: List[str]) -> None:
+        with self.clique_graph_lock:
+            if self.clique_graph is None:
+                return
+
+            ids = []
+            for author in authors:
+                if author not in self.clique_graph_ids:
+                    self.clique_graph_ids[author] = len(self.clique_graph)
+                    self.clique_graph.append(set())
+                    self.clique_graph_matches_snapshot = False
+                ids.append(self.clique_graph_ids[author])
+
+            for i, u in enumerate(ids):
+                for v in ids[i + 1:]:
+                    if u != v and v not in self.clique_graph[u]:
+                        self.clique_graph[u].add(v)
+                        self.clique_graph[v].add(u)
+                        self.clique_graph_edges.append((u, v))
+                        self.clique_graph_matches_snapshot = False
+
+    def _clique_neighborhoods(self, edges) -> Dict[int, set]:
+        # endpoints of the new edges and their common neighbors
+        neighborhoods = {}
+        for u, v in edges:
+            for w in (self.clique_graph[u] & self.clique_graph[v]) | {u, v}:
+                neighborhoods[w] = self.clique_graph[w]
+
+        return neighborhoods
+
+    def _trim_clique_graph_edges(self) -> None:
+        # drop the edges every stored count already includes
+        counted = min(counted_edges for _,
+                      counted_edges in self.clique_counts.values())
+        if counted == 0:
+            return
+
+        del self.clique_graph_edges[:counted]
+        self.clique_counts = {max_k: (counts, counted_edges - counted)
+                              for max_k, (counts, counted_edges) in self.clique_counts.items()}
+
+    @cached(cache=LRUCache(maxsize=CLIQUE_AUTHOR_CACHE_SIZE), key=lambda self, max_k: max_k)
+    def count_author_cliques(self, max_k: int) -> Tuple[List[str], Dict[int, "numpy.ndarray"]]:
+        # vertex ids of the adjacency list are positions in author_ids
+        author_ids = self.view.author.keys()
+        all_authors = self.columns.author_names(author_ids)
+        adjacency_list = self.build_adjacency_list_with_progress(author_ids=author_ids)
+
+        _, local_counts = pivoter_local(adjacency_list, max_k)
+
+        return all_authors, local_counts
+
+    def get_top_clique_authors(self, k: int, limit: int = 100) -> List[Tuple[str, int]]:
+        all_authors, local_counts = self.count_author_cliques(k)
+        # no k-cliques when k is above the largest clique size
+        counts = local_counts.get(k)
+        if counts is None:
+            return []
+
+        top = numpy.argsort(counts)[::-1][:limit]
+        return [(all_authors[i], int(counts[i])) for i in top if counts[i] > 0]
+
+    def build_adjacency_list_with_progress(self, progress_callback=None, cancel_token=None, author_ids=None):
+        # vertices are the positions of the author ids, by default those
+        # of the published author index
+        all_author_ids = self.view.author.keys() if author_ids is None else author_ids
+        vertex_of = {author_id: idx for idx, author_id in enumerate(all_author_ids)}
+        num_vertices = len(all_author_ids)
+
+        adjacency_list = [set() for _ in range(num_vertices)]
 
-            if progress_callback and (idx % 1000 == 0 or idx == total_authors - 1):
-                progress_callback("build_adjacency_list",
-                                  idx + 1, total_authors)
+        total_authors = len(all_author_ids)
+        for idx, author_id in enumerate(all_author_ids):
+            for coauthor_id, _ in self.columns.coauthors(author_id):
+                if coauthor_id in vertex_of:
+                    coauthor_vertex = vertex_of[coauthor_id]
+
+                    adjacency_list[idx].add(coauthor_vertex)
+                    adjacency_list[coauthor_vertex].add(idx)
+
+            if idx % 1000 == 0 or idx == total_authors - 1:
+                if cancel_token and cancel_token.cancelled:
+                    raise PivoterCancelled("pivoter was cancelled")
+                if progress_callback:
+                    progress_callback("build_adjacency_list",
+                                      idx + 1, total_authors)
 
         return adjacency_list
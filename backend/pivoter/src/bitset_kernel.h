@@ -0,0 +1,328 @@
+/*
+    A C++ implement of Pivoter algorithm in "The power of pivoting for
+    exact clique counting." (WSDM 2020).
+
+    Copyright (C) 2011  Darren Strash
+    Copyright (C) 2020  Shweta Jain
+    Copyright (C) 2025  ParaN3xus
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+    Contact ParaN3xus by: paran3xus007@gmail.com
+*/
+
+#ifndef BITSET_KERNEL_H
+#define BITSET_KERNEL_H
+
+#include <cstdint>
+#include <cstring>
+#include <gmp.h>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+#include "misc.h"
+#include "neighbor_list.h"
+#include "local_counts.h"
+
+// roots with at most this many later neighbors are relabeled to 0..k-1 and
+// counted with the bitset kernel, larger ones fall back to neighborsInP.
+#ifndef BITSET_KERNEL_MAX_SIZE
+#define BITSET_KERNEL_MAX_SIZE 1024
+#endif
+
+typedef uint64_t word_t;
+
+inline int bitsetWords(int size) {
+    return (size + 63) >> 6;
+}
+
+inline void bitsetSet(word_t* set, int bit) {
+    set[bit >> 6] |= word_t(1) << (bit & 63);
+}
+
+inline void bitsetClear(word_t* set, int bit) {
+    set[bit >> 6] &= ~(word_t(1) << (bit & 63));
+}
+
+inline int bitsetCount(const word_t* a, int words) {
+    int count = 0;
+    for (int i = 0; i < words; i++) {
+        count += __builtin_popcountll(a[i]);
+    }
+    return count;
+}
+
+// The set operations below use AVX2 when the CPU has it, whatever the
+// compiler targets, so the module runs on CPUs without it.
+#if defined(__x86_64__)
+inline bool bitsetAvx2() {
+    static const bool avx2 = __builtin_cpu_supports("avx2");
+    return avx2;
+}
+
+// per-64-bit-lane popcount (Mula's nibble lookup)
+__attribute__((target("avx2")))
+inline __m256i popcount256(__m256i v) {
+    const __m256i lookup = _mm256_setr_epi8(
+        0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+        0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    const __m256i lowMask = _mm256_set1_epi8(0x0f);
+
+    __m256i lo = _mm256_and_si256(v, lowMask);
+    __m256i hi = _mm256_and_si256(_mm256_srli_epi16(v, 4), lowMask);
+    __m256i counts = _mm256_add_epi8(_mm256_shuffle_epi8(lookup, lo),
+        _mm256_shuffle_epi8(lookup, hi));
+
+    return _mm256_sad_epu8(counts, _mm256_setzero_si256());
+}
+
+// |a & b| of the first words / 4 * 4 words
+__attribute__((target("avx2")))
+inline int bitsetAndCountAvx2(const word_t* a, const word_t* b, int words) {
+    __m256i acc = _mm256_setzero_si256();
+    for (int i = 0; i + 4 <= words; i += 4) {
+        __m256i x = _mm256_and_si256(
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i)),
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i)));
+        acc = _mm256_add_epi64(acc, popcount256(x));
+    }
+    return _mm256_extract_epi64(acc, 0) + _mm256_extract_epi64(acc, 1)
+        + _mm256_extract_epi64(acc, 2) + _mm256_extract_epi64(acc, 3);
+}
+
+__attribute__((target("avx2")))
+inline void bitsetAndAvx2(word_t* dst, const word_t* a, const word_t* b, int words) {
+    for (int i = 0; i + 4 <= words; i += 4) {
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_and_si256(
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i)),
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i))));
+    }
+}
+
+__attribute__((target("avx2")))
+inline void bitsetAndNotAvx2(word_t* dst, const word_t* a, const word_t* b, int words) {
+    for (int i = 0; i + 4 <= words; i += 4) {
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_andnot_si256(
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i)),
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i))));
+    }
+}
+#endif
+
+// |a & b|
+inline int bitsetAndCount(const word_t* a, const word_t* b, int words) {
+    int i = 0;
+    int count = 0;
+#if defined(__x86_64__)
+    if (words >= 4 && bitsetAvx2()) {
+        count = bitsetAndCountAvx2(a, b, words);
+        i = words & ~3;
+    }
+#endif
+    for (; i < words; i++) {
+        count += __builtin_popcountll(a[i] & b[i]);
+    }
+    return count;
+}
+
+// dst = a & b
+inline void bitsetAnd(word_t* dst, const word_t* a, const word_t* b, int words) {
+    int i = 0;
+#if defined(__x86_64__)
+    if (words >= 4 && bitsetAvx2()) {
+        bitsetAndAvx2(dst, a, b, words);
+        i = words & ~3;
+    }
+#endif
+    for (; i < words; i++) {
+        dst[i] = a[i] & b[i];
+    }
+}
+
+// dst = a & ~b
+inline void bitsetAndNot(word_t* dst, const word_t* a, const word_t* b, int words) {
+    int i = 0;
+#if defined(__x86_64__)
+    if (words >= 4 && bitsetAvx2()) {
+        bitsetAndNotAvx2(dst, a, b, words);
+        i = words & ~3;
+    }
+#endif
+    for (; i < words; i++) {
+        dst[i] = a[i] & ~b[i];
+    }
+}
+
+void listAllCliquesBitsetRecursive(mpz_t* cliqueCounts,
+    const word_t* adjacency, int words, word_t* setStack,
+    int depth, int max_k, int rsize, int drop,
+    const int* globalId, LocalCliqueCounts* localCounts);
+
+// Buffers shared by every root handled by the bitset kernel, sized for the
+// largest such root so that they are allocated once per pivoter() call.
+struct BitsetWorkspace {
+    int capacity;       // max number of local vertices
+    int* localId;       // global vertex -> local id, -1 if not in the subgraph
+    word_t* adjacency;  // capacity rows of bitsetWords(capacity) words
+    word_t* setStack;   // P and candidates for every recursion depth
+};
+
+BitsetWorkspace* createBitsetWorkspace(int size, int capacity) {
+    BitsetWorkspace* workspace = new BitsetWorkspace();
+    int words = bitsetWords(capacity);
+
+    workspace->capacity = capacity;
+    workspace->localId = new int[size];
+    std::fill(workspace->localId, workspace->localId + size, -1);
+    workspace->adjacency = new word_t[size_t(capacity) * words + 1]();
+    workspace->setStack = new word_t[size_t(capacity + 2) * 2 * words + 1]();
+
+    return workspace;
+}
+
+void destroyBitsetWorkspace(BitsetWorkspace* workspace) {
+    delete[] workspace->localId;
+    delete[] workspace->adjacency;
+    delete[] workspace->setStack;
+    delete workspace;
+}
+
+// Count cliques whose earliest vertex (in the degeneracy ordering) is root.
+// The later neighbors of root are relabeled to 0..k-1 so that P and the
+// adjacency rows become k-bit sets.
+void listAllCliquesBitsetRoot(mpz_t* cliqueCounts, NeighborListArray** orderingArray,
+    int root, BitsetWorkspace* workspace, int max_k,
+    LocalCliqueCounts* localCounts = nullptr) {
+    NeighborListArray* rootList = orderingArray[root];
+    int k = rootList->laterDegree;
+    int words = bitsetWords(k);
+
+    for (int j = 0; j < k; j++) {
+        workspace->localId[rootList->later[j]] = j;
+    }
+
+    word_t* adjacency = workspace->adjacency;
+    memset(adjacency, 0, size_t(k) * words * sizeof(word_t));
+
+    // every edge inside the subgraph is the later-edge of one of its endpoints
+    for (int j = 0; j < k; j++) {
+        NeighborListArray* list = orderingArray[rootList->later[j]];
+        for (int l = 0; l < list->laterDegree; l++) {
+            int neighbor = workspace->localId[list->later[l]];
+            if (neighbor >= 0) {
+                bitsetSet(adjacency + size_t(j) * words, neighbor);
+                bitsetSet(adjacency + size_t(neighbor) * words, j);
+            }
+        }
+    }
+
+    // P is initially the whole subgraph
+    word_t* P = workspace->setStack;
+    memset(P, 0, words * sizeof(word_t));
+    for (int j = 0; j < k; j++) {
+        bitsetSet(P, j);
+    }
+
+    listAllCliquesBitsetRecursive(cliqueCounts,
+        adjacency, words, workspace->setStack,
+        0, max_k, 1, 0, rootList->later, localCounts);
+
+    for (int j = 0; j < k; j++) {
+        workspace->localId[rootList->later[j]] = -1;
+    }
+}
+
+void listAllCliquesBitsetRecursive(mpz_t* cliqueCounts,
+    const word_t* adjacency, int words, word_t* setStack,
+    int depth, int max_k, int rsize, int drop,
+    const int* globalId, LocalCliqueCounts* localCounts) {
+
+    // P and the candidates of this call live in setStack[depth]
+    word_t* P = setStack + size_t(depth) * 2 * words;
+    word_t* candidates = P + words;
+    word_t* newP = candidates + words;
+
+    int sizeOfP = bitsetCount(P, words);
+
+    if ((sizeOfP == 0) || (rsize - drop > max_k)) {
+        countCliquesAtLeaf(cliqueCounts, max_k, rsize, drop);
+        if (localCounts) {
+            countLocalCliquesAtLeaf(localCounts, rsize, drop);
+        }
+        return;
+    }
+
+    // find the vertex in P with the most neighbors in P
+    int pivot = -1;
+    int maxIntersectionSize = -1;
+
+    for (int w = 0; w < words && maxIntersectionSize < sizeOfP - 1; w++) {
+        word_t bits = P[w];
+        while (bits) {
+            int vertex = (w << 6) + __builtin_ctzll(bits);
+            bits &= bits - 1;
+
+            int numNeighborsInP = bitsetAndCount(adjacency + size_t(vertex) * words, P, words);
+
+            if (numNeighborsInP > maxIntersectionSize) {
+                pivot = vertex;
+                maxIntersectionSize = numNeighborsInP;
+
+                // adjacent to everything else in P, can't do better
+                if (maxIntersectionSize == sizeOfP - 1) {
+                    break;
+                }
+            }
+        }
+    }
+
+    // candidates are the non-neighbors of pivot in P (pivot included)
+    bitsetAndNot(candidates, P, adjacency + size_t(pivot) * words, words);
+
+    for (int w = 0; w < words; w++) {
+        word_t bits = candidates[w];
+        while (bits) {
+            int vertex = (w << 6) + __builtin_ctzll(bits);
+            bits &= bits - 1;
+
+            // a non-pivot would make R hold more than max_k vertices
+            if (vertex != pivot && rsize + 1 - drop > max_k) {
+                bitsetClear(P, vertex);
+                continue;
+            }
+
+            bitsetAnd(newP, P, adjacency + size_t(vertex) * words, words);
+
+            if (localCounts) {
+                pushLocalCliqueVertex(localCounts, globalId[vertex], vertex == pivot, rsize, drop);
+            }
+
+            if (vertex == pivot)
+                listAllCliquesBitsetRecursive(cliqueCounts,
+                    adjacency, words, setStack,
+                    depth + 1, max_k, rsize + 1, drop + 1, globalId, localCounts);
+            else
+                listAllCliquesBitsetRecursive(cliqueCounts,
+                    adjacency, words, setStack,
+                    depth + 1, max_k, rsize + 1, drop, globalId, localCounts);
+
+            // vertex moves to X for the remaining candidates
+            bitsetClear(P, vertex);
+        }
+    }
+}
+
+#endif // BITSET_KERNEL_H
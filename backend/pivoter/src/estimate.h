@@ -0,0 +1,170 @@
+/*
+    A C++ implement of Pivoter algorithm in "The power of pivoting for
+    exact clique counting." (WSDM 2020).
+
+    Copyright (C) 2011  Darren Strash
+    Copyright (C) 2020  Shweta Jain
+    Copyright (C) 2025  ParaN3xus
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+    Contact ParaN3xus by: paran3xus007@gmail.com
+*/
+
+
+#ifndef ESTIMATE_H
+#define ESTIMATE_H
+
+#include <cmath>
+#include <chrono>
+#include <random>
+#include <vector>
+#include <cstdint>
+#include <unordered_map>
+#include <gmp.h>
+
+#include "pivoter.h"
+
+// Unbiased estimate of the clique counts from a sample of roots.
+//
+// Every clique is counted at exactly one root, its earliest vertex in the
+// degeneracy ordering, so the counts are the sum of per-root counts. Roots
+// are drawn with replacement with probability proportional to
+// estimateRootWork() and each draw contributes its per-root count divided
+// by its probability (Hansen-Hurwitz), so the roots that hold most of the
+// cliques are the ones sampled most.
+struct CliqueCountEstimate {
+    long long samples;                  // number of roots drawn
+    std::vector<long double> estimate;  // estimate[k]
+    std::vector<long double> stdError;  // standard error of estimate[k]
+};
+
+// per-root counts fit in a long double, unlike a double, for any root
+// the bitset kernel can hold
+inline long double mpzToLongDouble(const mpz_t value) {
+    long exponent;
+    double mantissa = mpz_get_d_2exp(&exponent, value);
+    return std::ldexp((long double)mantissa, exponent);
+}
+
+// Draw roots until timeBudget has passed (and at least two roots were drawn
+// so that the error can be estimated). If every root gets drawn before
+// that, the exact counts are returned with no error. Takes ownership of orderingArray like
+// listAllCliquesDegeneracy_A.
+CliqueCountEstimate estimateCliqueCounts(NeighborListArray** orderingArray,
+    int size, int max_k, std::chrono::milliseconds timeBudget, uint64_t seed) {
+    auto start = std::chrono::steady_clock::now();
+
+    CliqueCountEstimate result;
+    result.samples = 0;
+    result.estimate.assign(max_k + 1, 0);
+    result.stdError.assign(max_k + 1, 0);
+
+    if (size == 0) {
+        delete[] orderingArray;
+        return result;
+    }
+
+    std::vector<double> weights(size);
+    double totalWeight = 0;
+    int capacity = 0;
+    for (int i = 0; i < size; i++) {
+        weights[i] = estimateRootWork(orderingArray[i]->laterDegree);
+        totalWeight += weights[i];
+        capacity = std::max(capacity, orderingArray[i]->laterDegree);
+    }
+
+    std::mt19937_64 rng(seed);
+    std::discrete_distribution<int> drawRoot(weights.begin(), weights.end());
+
+    // every sampled root goes to the bitset kernel, whatever its size
+    BitsetWorkspace* workspace = createBitsetWorkspace(size, capacity);
+
+    mpz_t* rootCounts = new mpz_t[max_k + 1];
+    for (int k = 0; k <= max_k; k++) {
+        mpz_init(rootCounts[k]);
+    }
+
+    // heavy roots are drawn many times, count them once
+    std::unordered_map<int, std::vector<long double>> counted;
+
+    // running mean and sum of squared deviations (Welford) of the draws
+    std::vector<long double> mean(max_k + 1, 0);
+    std::vector<long double> m2(max_k + 1, 0);
+
+    while (result.samples < 2
+        || std::chrono::steady_clock::now() - start < timeBudget) {
+        int root = drawRoot(rng);
+
+        auto cached = counted.find(root);
+        if (cached == counted.end()) {
+            for (int k = 0; k <= max_k; k++) {
+                mpz_set_ui(rootCounts[k], 0);
+            }
+
+            listAllCliquesBitsetRoot(rootCounts, orderingArray, root, workspace, max_k);
+
+            std::vector<long double> counts(max_k + 1);
+            for (int k = 0; k <= max_k; k++) {
+                counts[k] = mpzToLongDouble(rootCounts[k]);
+            }
+            cached = counted.emplace(root, std::move(counts)).first;
+        }
+
+        result.samples++;
+        long double probability = weights[root] / totalWeight;
+        for (int k = 0; k <= max_k; k++) {
+            long double draw = cached->second[k] / probability;
+            long double delta = draw - mean[k];
+            mean[k] += delta / result.samples;
+            m2[k] += delta * (draw - mean[k]);
+        }
+
+        // every root has been counted, the sum is exact
+        if ((int)counted.size() == size) {
+            break;
+        }
+    }
+
+    if ((int)counted.size() == size) {
+        for (auto& root : counted) {
+            for (int k = 0; k <= max_k; k++) {
+                result.estimate[k] += root.second[k];
+            }
+        }
+    }
+    else {
+        for (int k = 0; k <= max_k; k++) {
+            result.estimate[k] = mean[k];
+            result.stdError[k] = std::sqrt(m2[k] / (result.samples - 1) / result.samples);
+        }
+    }
+
+    for (int k = 0; k <= max_k; k++) {
+        mpz_clear(rootCounts[k]);
+    }
+    delete[] rootCounts;
+    destroyBitsetWorkspace(workspace);
+
+    for (int i = 0; i < size; i++) {
+        delete[] orderingArray[i]->later;
+        delete[] orderingArray[i]->earlier;
+        delete orderingArray[i];
+    }
+    delete[] orderingArray;
+
+    return result;
+}
+
+#endif // ESTIMATE_H
@@ -0,0 +1,162 @@
+/*
+    A C++ implement of Pivoter algorithm in "The power of pivoting for
+    exact clique counting." (WSDM 2020).
+
+    Copyright (C) 2011  Darren Strash
+    Copyright (C) 2020  Shweta Jain
+    Copyright (C) 2025  ParaN3xus
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+    Contact ParaN3xus by: paran3xus007@gmail.com
+*/
+
+#ifndef INCREMENTAL_H
+#define INCREMENTAL_H
+
+#include <set>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <stdexcept>
+#include <unordered_map>
+#include <gmp.h>
+
+#include "bitset_kernel.h"
+
+// neighbors of the vertices around the new edges (endpoints and their
+// common neighbors), taken from the graph that already has the new edges
+typedef std::unordered_map<int, std::set<int>> Neighborhoods;
+
+inline uint64_t edgeKey(int u, int v) {
+    if (u > v) std::swap(u, v);
+    return (uint64_t(uint32_t(u)) << 32) | uint32_t(v);
+}
+
+class NewEdgeCliqueCounter {
+public:
+    NewEdgeCliqueCounter(const Neighborhoods& neighborhoods,
+        const std::vector<std::pair<int, int>>& newEdges)
+        : neighborhoods(neighborhoods), newEdges(newEdges) {
+        for (size_t i = 0; i < newEdges.size(); i++) {
+            int u = newEdges[i].first;
+            int v = newEdges[i].second;
+
+            if (!hasEdge(u, v)) {
+                throw std::invalid_argument("new edge (" + std::to_string(u) + ", "
+                    + std::to_string(v) + ") is not in the graph");
+            }
+
+            // only the first copy of a duplicated edge is new
+            newEdgeIndex.emplace(edgeKey(u, v), i);
+        }
+
+        common.resize(newEdges.size());
+        maxCommon = 0;
+        for (size_t i = 0; i < newEdges.size(); i++) {
+            int u = newEdges[i].first;
+            int v = newEdges[i].second;
+
+            if (u == v || newEdgeIndex[edgeKey(u, v)] != i) {
+                continue;
+            }
+
+            const std::set<int>& uNeighbors = neighborhoods.at(u);
+            for (int w : neighborhoods.at(v)) {
+                if (w != u && uNeighbors.count(w)
+                    && inGraphBefore(u, w, i) && inGraphBefore(v, w, i)) {
+                    common[i].push_back(w);
+                }
+            }
+
+            maxCommon = std::max(maxCommon, int(common[i].size()));
+        }
+    }
+
+    // largest clique that contains a new edge
+    int maxCliqueSize() const {
+        return maxCommon + 2;
+    }
+
+    // Add the cliques that contain at least one new edge to cliqueCounts.
+    // Cliques whose first new edge (in newEdges order) is (u, v) are u, v
+    // plus a clique of their common neighborhood in the graph without the
+    // earlier new edges, so run the bitset kernel on that neighborhood with
+    // u and v already in R.
+    void count(mpz_t* cliqueCounts, int max_k) {
+        BitsetWorkspace* workspace = createBitsetWorkspace(0, maxCommon);
+
+        for (size_t i = 0; i < newEdges.size(); i++) {
+            int u = newEdges[i].first;
+            int v = newEdges[i].second;
+
+            if (u == v || newEdgeIndex[edgeKey(u, v)] != i) {
+                continue;
+            }
+
+            const std::vector<int>& vertices = common[i];
+            int k = vertices.size();
+            int words = bitsetWords(k);
+
+            std::unordered_map<int, int> localId;
+            for (int j = 0; j < k; j++) {
+                localId[vertices[j]] = j;
+            }
+
+            word_t* adjacency = workspace->adjacency;
+            memset(adjacency, 0, size_t(k) * words * sizeof(word_t));
+
+            for (int j = 0; j < k; j++) {
+                for (int w : neighborhoods.at(vertices[j])) {
+                    auto neighbor = localId.find(w);
+                    if (neighbor != localId.end() && inGraphBefore(vertices[j], w, i)) {
+                        bitsetSet(adjacency + size_t(j) * words, neighbor->second);
+                    }
+                }
+            }
+
+            word_t* P = workspace->setStack;
+            memset(P, 0, words * sizeof(word_t));
+            for (int j = 0; j < k; j++) {
+                bitsetSet(P, j);
+            }
+
+            listAllCliquesBitsetRecursive(cliqueCounts,
+                adjacency, words, workspace->setStack,
+                0, max_k, 2, 0, nullptr, nullptr);
+        }
+
+        destroyBitsetWorkspace(workspace);
+    }
+
+private:
+    const Neighborhoods& neighborhoods;
+    const std::vector<std::pair<int, int>>& newEdges;
+    std::unordered_map<uint64_t, size_t> newEdgeIndex;
+    std::vector<std::vector<int>> common;
+    int maxCommon;
+
+    bool hasEdge(int u, int v) const {
+        auto uNeighbors = neighborhoods.find(u);
+        return uNeighbors != neighborhoods.end() && uNeighbors->second.count(v);
+    }
+
+    // whether (u, v) is in the graph before new edge i is added
+    bool inGraphBefore(int u, int v, size_t i) const {
+        auto index = newEdgeIndex.find(edgeKey(u, v));
+        return index == newEdgeIndex.end() || index->second >= i;
+    }
+};
+
+#endif // INCREMENTAL_H
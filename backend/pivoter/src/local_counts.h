@@ -0,0 +1,113 @@
+/*
+    A C++ implement of Pivoter algorithm in "The power of pivoting for
+    exact clique counting." (WSDM 2020).
+
+    Copyright (C) 2011  Darren Strash
+    Copyright (C) 2020  Shweta Jain
+    Copyright (C) 2025  ParaN3xus
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+    Contact ParaN3xus by: paran3xus007@gmail.com
+*/
+
+#ifndef LOCAL_COUNTS_H
+#define LOCAL_COUNTS_H
+
+#include <cstring>
+#include <algorithm>
+
+// Per-vertex k-clique counts for k <= max_k (local counting in the paper).
+//
+// Along the recursion R is split into hold vertices (root and non-pivots)
+// and pivot vertices. A leaf with h holds and p pivots stands for the
+// cliques made of all holds plus any r of the pivots, so for k = h + r each
+// hold is in binom(p, r) of them and each pivot in binom(p - 1, r - 1).
+//
+// Counts are doubles: exact up to 2^53 and good enough to rank vertices
+// beyond that.
+struct LocalCliqueCounts {
+    int size;           // number of vertices
+    int max_k;
+    int maxDrop;        // largest possible number of pivots in R
+    double* counts;     // counts[k * size + vertex]
+    double* binomial;   // binomial[n * (max_k + 1) + r] = binom(n, r)
+    int* hold;          // hold vertices of the current R, root first
+    int* pivots;        // pivot vertices of the current R
+};
+
+LocalCliqueCounts* createLocalCliqueCounts(int size, int maxDrop, int max_k) {
+    LocalCliqueCounts* local = new LocalCliqueCounts();
+    local->size = size;
+    local->max_k = max_k;
+    local->maxDrop = maxDrop;
+    local->counts = new double[size_t(max_k + 1) * size]();
+    local->binomial = new double[size_t(maxDrop + 1) * (max_k + 1)]();
+    local->hold = new int[maxDrop + 2]();
+    local->pivots = new int[maxDrop + 2]();
+
+    // pascal's triangle, truncated at r = max_k
+    for (int n = 0; n <= maxDrop; n++) {
+        double* row = local->binomial + size_t(n) * (max_k + 1);
+        row[0] = 1;
+        for (int r = 1; r <= std::min(n, max_k); r++) {
+            double* prev = row - (max_k + 1);
+            row[r] = prev[r - 1] + prev[r];
+        }
+    }
+
+    return local;
+}
+
+void destroyLocalCliqueCounts(LocalCliqueCounts* local) {
+    delete[] local->counts;
+    delete[] local->binomial;
+    delete[] local->hold;
+    delete[] local->pivots;
+    delete local;
+}
+
+// record vertex as the next member of R, rsize and drop describe R before it
+inline void pushLocalCliqueVertex(LocalCliqueCounts* local, int vertex,
+    bool isPivot, int rsize, int drop) {
+    if (isPivot) {
+        local->pivots[drop] = vertex;
+    }
+    else {
+        local->hold[rsize - drop] = vertex;
+    }
+}
+
+void countLocalCliquesAtLeaf(LocalCliqueCounts* local, int rsize, int drop) {
+    int numHold = rsize - drop;
+    int maxR = std::min(drop, local->max_k - numHold);
+
+    for (int r = 0; r <= maxR; r++) {
+        double* kCounts = local->counts + size_t(numHold + r) * local->size;
+
+        double holdCount = local->binomial[size_t(drop) * (local->max_k + 1) + r];
+        for (int i = 0; i < numHold; i++) {
+            kCounts[local->hold[i]] += holdCount;
+        }
+
+        if (r > 0) {
+            double pivotCount = local->binomial[size_t(drop - 1) * (local->max_k + 1) + r - 1];
+            for (int i = 0; i < drop; i++) {
+                kCounts[local->pivots[i]] += pivotCount;
+            }
+        }
+    }
+}
+
+#endif // LOCAL_COUNTS_H
@@ -41,6 +41,10 @@ void moveFromRToXDegeneracyCliques(int vertex,
     int* vertexSets, int* vertexLookup,
     int* pBeginX, int* pBeginP, int* pBeginR);
 
+void moveFromPToXDegeneracyCliques(int vertex,
+    int* vertexSets, int* vertexLookup,
+    int* pBeginX, int* pBeginP, int* pBeginR);
+
 void moveToRDegeneracyCliques(int vertex,
     int* vertexSets, int* vertexLookup,
     int** neighborsInP, int* numNeighbors,
@@ -59,9 +63,37 @@ int findBestPivotNonNeighborsDegeneracyCliques(int** pivotNonNeighbors, int* num
     int** neighborsInP, int* numNeighbors,
     int beginX, int beginP, int beginR);
 
+void countCliquesAtLeaf(mpz_t* cliqueCounts, int max_k, int rsize, int drop);
+
 // Implementation
 
 
+// a leaf of the recursion holds rsize vertices, drop of which are pivots:
+// every subset of the pivots together with the other rsize - drop vertices
+// is a clique, so add binom(drop, i) to the count of (rsize - i)-cliques.
+void countCliquesAtLeaf(mpz_t* cliqueCounts, int max_k, int rsize, int drop) {
+    for (int i = drop; (i >= 0) && (rsize - i <= max_k); i--) {
+        int k = rsize - i;
+
+        mpz_t temp, n_mpz, i_mpz;
+        mpz_init(temp);
+        mpz_init(n_mpz);
+        mpz_init(i_mpz);
+
+        mpz_set_ui(n_mpz, drop);
+        mpz_set_ui(i_mpz, i);
+
+        mpz_bin_ui(temp, n_mpz, i);
+
+        mpz_add(cliqueCounts[k], cliqueCounts[k], temp);
+
+        mpz_clear(temp);
+        mpz_clear(n_mpz);
+        mpz_clear(i_mpz);
+    }
+}
+
+
 int findBestPivotNonNeighborsDegeneracyCliques(int** pivotNonNeighbors, int* numNonNeighbors,
     int* vertexSets, int* vertexLookup,
     int** neighborsInP, int* numNeighbors,
@@ -301,5 +333,19 @@ void moveFromRToXDegeneracyCliques(int vertex,
     *pBeginR = *pBeginR + 1;
 }
 
+void moveFromPToXDegeneracyCliques(int vertex,
+    int* vertexSets, int* vertexLookup,
+    int* pBeginX, int* pBeginP, int* pBeginR) {
+    int vertexLocation = vertexLookup[vertex];
+
+    //swap vertex into X and increment beginP
+    vertexSets[vertexLocation] = vertexSets[*pBeginP];
+    vertexLookup[vertexSets[*pBeginP]] = vertexLocation;
+    vertexSets[*pBeginP] = vertex;
+    vertexLookup[vertex] = *pBeginP;
+
+    *pBeginP = *pBeginP + 1;
+}
+
 
 #endif // MISC_H
@@ -30,19 +30,68 @@
 #include <cmath>
 #include <limits>
 #include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
 #include <gmp.h>
 
 #include "misc.h"
 #include "neighbor_list.h"
+#include "bitset_kernel.h"
+#include "local_counts.h"
 
 void listAllCliquesDegeneracyRecursive_A(mpz_t* cliqueCounts,
     int* vertexSets, int* vertexLookup,
     int** neighborsInP, int* numNeighbors,
     int beginX, int beginP, int beginR, int max_k,
-    int rsize, int drop);
+    int rsize, int drop, LocalCliqueCounts* localCounts);
+
+// Lets the caller follow and stop a count running on another thread.
+// Progress is in work units: a root is worth estimateRootWork() of its
+// later-degree, which is the largest its subproblem can be.
+struct PivoterControl {
+    const std::atomic<bool>* cancelled = nullptr;
+
+    // called between roots, at most once per progressInterval, with the
+    // work done so far and the total; returning false stops the count
+    std::function<bool(long long, long long)> onProgress;
+    std::chrono::milliseconds progressInterval{100};
+
+    long long done = 0;
+    long long total = 0;
+    std::chrono::steady_clock::time_point lastProgress;
+};
+
+// the root plus its later neighbors and the edges between them
+inline long long estimateRootWork(int laterDegree) {
+    return 1 + laterDegree + (long long)laterDegree * (laterDegree - 1) / 2;
+}
+
+// report progress if it is due, returns true if the count should stop
+bool pivoterShouldStop(PivoterControl* control) {
+    if (control->cancelled && control->cancelled->load(std::memory_order_relaxed)) {
+        return true;
+    }
 
-void listAllCliquesDegeneracy_A(mpz_t* cliqueCounts, NeighborListArray** orderingArray,
-    int size, int max_k) {
+    if (control->onProgress) {
+        auto now = std::chrono::steady_clock::now();
+        if (now - control->lastProgress >= control->progressInterval) {
+            control->lastProgress = now;
+            if (!control->onProgress(control->done, control->total)) {
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+// localCounts, if not null, also receives per-vertex counts for k <= max_k.
+// Returns false if control stopped the count before every root was done,
+// cliqueCounts then only holds part of the counts.
+bool listAllCliquesDegeneracy_A(mpz_t* cliqueCounts, NeighborListArray** orderingArray,
+    int size, int max_k, LocalCliqueCounts* localCounts = nullptr,
+    PivoterControl* control = nullptr) {
 
     // vertex sets are stored in an array like this: |--X--|--P--|
     int* vertexSets = new int[size]();
@@ -67,10 +116,50 @@ void listAllCliquesDegeneracy_A(mpz_t* cliqueCounts, NeighborListArray** orderin
     int beginP = 0;
     int beginR = size;
 
+    // small subproblems go to the bitset kernel, size its buffers for the
+    // largest of them
+    int bitsetCapacity = 0;
+    for (i = 0; i < size; i++) {
+        int laterDegree = orderingArray[i]->laterDegree;
+        if (laterDegree <= BITSET_KERNEL_MAX_SIZE) {
+            bitsetCapacity = std::max(bitsetCapacity, laterDegree);
+        }
+    }
+    BitsetWorkspace* bitsetWorkspace = createBitsetWorkspace(size, bitsetCapacity);
+
+    if (control) {
+        control->done = 0;
+        control->total = 0;
+        for (i = 0; i < size; i++) {
+            control->total += estimateRootWork(orderingArray[i]->laterDegree);
+        }
+        control->lastProgress = std::chrono::steady_clock::now();
+    }
+
+    bool completed = true;
+
     // for each vertex
     for (i = 0; i < size; i++) {
         int vertex = orderingArray[i]->vertex;
 
+        if (control) {
+            if (pivoterShouldStop(control)) {
+                completed = false;
+                break;
+            }
+            control->done += estimateRootWork(orderingArray[vertex]->laterDegree);
+        }
+
+        if (localCounts) {
+            localCounts->hold[0] = vertex;
+        }
+
+        if (orderingArray[vertex]->laterDegree <= BITSET_KERNEL_MAX_SIZE) {
+            listAllCliquesBitsetRoot(cliqueCounts, orderingArray,
+                vertex, bitsetWorkspace, max_k, localCounts);
+            continue;
+        }
+
         int newBeginX, newBeginP, newBeginR;
 
         // set P to be later neighbors and X to be be earlier neighbors of vertex
@@ -90,13 +179,14 @@ void listAllCliquesDegeneracy_A(mpz_t* cliqueCounts, NeighborListArray** orderin
         listAllCliquesDegeneracyRecursive_A(cliqueCounts,
             vertexSets, vertexLookup,
             neighborsInP, numNeighbors,
-            newBeginX, newBeginP, newBeginR, max_k, rsize, drop);
+            newBeginX, newBeginP, newBeginR, max_k, rsize, drop, localCounts);
 
         beginR = beginR + 1;
     }
 
     mpz_set_ui(cliqueCounts[0], 1);
 
+    destroyBitsetWorkspace(bitsetWorkspace);
     delete[] vertexSets;
     delete[] vertexLookup;
 
@@ -111,36 +201,24 @@ void listAllCliquesDegeneracy_A(mpz_t* cliqueCounts, NeighborListArray** orderin
     delete[] neighborsInP;
     delete[] numNeighbors;
 
-    return;
+    if (completed && control && control->onProgress) {
+        control->onProgress(control->done, control->total);
+    }
+
+    return completed;
 }
 
 void listAllCliquesDegeneracyRecursive_A(mpz_t* cliqueCounts,
     int* vertexSets, int* vertexLookup,
     int** neighborsInP, int* numNeighbors,
     int beginX, int beginP, int beginR, int max_k,
-    int rsize, int drop) {
+    int rsize, int drop, LocalCliqueCounts* localCounts) {
 
     if ((beginP >= beginR) || (rsize - drop > max_k)) {
-        for (int i = drop; (i >= 0) && (rsize - i <= max_k); i--) {
-            int k = rsize - i;
-
-            mpz_t temp, n_mpz, i_mpz;
-            mpz_init(temp);
-            mpz_init(n_mpz);
-            mpz_init(i_mpz);
-
-            mpz_set_ui(n_mpz, drop);
-            mpz_set_ui(i_mpz, i);
-
-            mpz_bin_ui(temp, n_mpz, i);
-
-            mpz_add(cliqueCounts[k], cliqueCounts[k], temp);
-
-            mpz_clear(temp);
-            mpz_clear(n_mpz);
-            mpz_clear(i_mpz);
+        countCliquesAtLeaf(cliqueCounts, max_k, rsize, drop);
+        if (localCounts) {
+            countLocalCliquesAtLeaf(localCounts, rsize, drop);
         }
-
         return;
     }
 
@@ -162,6 +240,17 @@ void listAllCliquesDegeneracyRecursive_A(mpz_t* cliqueCounts,
             // vertex to be added to the partial clique
             int vertex = myCandidatesToIterateThrough[iterator];
 
+            // a non-pivot would make R hold more than max_k vertices, none of
+            // the cliques below it are counted
+            if (vertex != pivot && rsize + 1 - drop > max_k) {
+                moveFromPToXDegeneracyCliques(vertex,
+                    vertexSets, vertexLookup,
+                    &beginX, &beginP, &beginR);
+
+                iterator++;
+                continue;
+            }
+
             int newBeginX, newBeginP, newBeginR;
 
             // add vertex into partialClique, representing R.
@@ -173,17 +262,21 @@ void listAllCliquesDegeneracyRecursive_A(mpz_t* cliqueCounts,
                 &beginX, &beginP, &beginR,
                 &newBeginX, &newBeginP, &newBeginR);
 
+            if (localCounts) {
+                pushLocalCliqueVertex(localCounts, vertex, vertex == pivot, rsize, drop);
+            }
+
             // recursively compute maximal cliques with new sets R, P and X
             if (vertex == pivot)
                 listAllCliquesDegeneracyRecursive_A(cliqueCounts,
                     vertexSets, vertexLookup,
                     neighborsInP, numNeighbors,
-                    newBeginX, newBeginP, newBeginR, max_k, rsize + 1, drop + 1);
+                    newBeginX, newBeginP, newBeginR, max_k, rsize + 1, drop + 1, localCounts);
             else
                 listAllCliquesDegeneracyRecursive_A(cliqueCounts,
                     vertexSets, vertexLookup,
                     neighborsInP, numNeighbors,
-                    newBeginX, newBeginP, newBeginR, max_k, rsize + 1, drop);
+                    newBeginX, newBeginP, newBeginR, max_k, rsize + 1, drop, localCounts);
 
             moveFromRToXDegeneracyCliques(vertex,
                 vertexSets, vertexLookup,
@@ -1,3 +1,5 @@
-from pivoter._pivoter import pivoter
+from pivoter._pivoter import pivoter, pivoter_local, pivoter_incremental, pivoter_estimate, CancellationToken, PivoterCancelled
+from pivoter._pivoter import CliqueSnapshot, save_snapshot
 
-__all__ = [pivoter]
+__all__ = [pivoter, pivoter_local, pivoter_incremental, pivoter_estimate,
+           CancellationToken, PivoterCancelled, CliqueSnapshot, save_snapshot]
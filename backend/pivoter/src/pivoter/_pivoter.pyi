@@ -1,5 +1,79 @@
-from typing import Dict, Set, List
+from typing import Callable, Dict, Set, List, Tuple, Optional
+import numpy as np
 
 
-def pivoter(py_adjacency_list: List[Set[int]]) -> Dict[int, str]:
+class CancellationToken:
+    def __init__(self) -> None:
+        ...
+
+    def cancel(self) -> None:
+        ...
+
+    @property
+    def cancelled(self) -> bool:
+        ...
+
+
+class PivoterCancelled(Exception):
+    ...
+
+
+class CliqueSnapshot:
+    def __init__(self, path: str) -> None:
+        ...
+
+    @property
+    def tag(self) -> int:
+        ...
+
+    @property
+    def num_vertices(self) -> int:
+        ...
+
+    @property
+    def num_edges(self) -> int:
+        ...
+
+    def adjacency_list(self) -> List[Set[int]]:
+        ...
+
+    def labels(self) -> Optional[List[str]]:
+        ...
+
+    def counts(self) -> Dict[Optional[int], Dict[int, str]]:
+        ...
+
+    def pivoter(self, max_k: Optional[int] = None,
+                progress: Optional[Callable[[int, int], None]] = None,
+                cancel_token: Optional[CancellationToken] = None) -> Dict[int, str]:
+        ...
+
+    def estimate(self, max_k: Optional[int] = None, time_budget_ms: int = 1000,
+                 seed: Optional[int] = None) -> Dict[int, Tuple[float, float, float]]:
+        ...
+
+
+def save_snapshot(path: str, py_adjacency_list: List[Set[int]], counts: Dict[Optional[int], Dict[int, str]],
+                  tag: int, labels: Optional[List[str]] = None) -> None:
+    ...
+
+
+def pivoter(py_adjacency_list: List[Set[int]], max_k: Optional[int] = None,
+            progress: Optional[Callable[[int, int], None]] = None,
+            cancel_token: Optional[CancellationToken] = None) -> Dict[int, str]:
+    ...
+
+
+def pivoter_local(py_adjacency_list: List[Set[int]], max_k: int,
+                  progress: Optional[Callable[[int, int], None]] = None,
+                  cancel_token: Optional[CancellationToken] = None) -> Tuple[Dict[int, str], Dict[int, np.ndarray]]:
+    ...
+
+
+def pivoter_incremental(neighborhoods: Dict[int, Set[int]], new_edges: List[Tuple[int, int]], max_k: Optional[int] = None) -> Dict[int, str]:
+    ...
+
+
+def pivoter_estimate(py_adjacency_list: List[Set[int]], max_k: Optional[int] = None,
+                     time_budget_ms: int = 1000, seed: Optional[int] = None) -> Dict[int, Tuple[float, float, float]]:
     ...
@@ -0,0 +1,566 @@
+/*
+    A C++ implement of Pivoter algorithm in "The power of pivoting for
+    exact clique counting." (WSDM 2020).
+
+    Copyright (C) 2011  Darren Strash
+    Copyright (C) 2020  Shweta Jain
+    Copyright (C) 2025  ParaN3xus
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+    Contact ParaN3xus by: paran3xus007@gmail.com
+*/
+
+
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <set>
+#include <map>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <algorithm>
+#include <cerrno>
+#include <optional>
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "neighbor_list.h"
+#include "crc32c.h"
+
+// A clique count snapshot keeps a graph in CSR form together with its
+// degeneracy ordering and the clique counts computed on it, so that they
+// survive a restart. The file is laid out to be mapped as is:
+//
+//   SnapshotHeader
+//   uint64 offsets[numVertices + 1]        neighbors of v are
+//   int32  neighbors[numNeighbors]           neighbors[offsets[v]..offsets[v + 1])
+//   int32  orderNumbers[numVertices]       position of v in the ordering
+//   uint64 labelOffsets[numVertices + 1]   only if hasLabels, label of v is
+//   char   labels[]                          labels[labelOffsets[v]..labelOffsets[v + 1])
+//   counts                                 read sequentially, see writeCounts()
+//
+// Every section starts on an 8-byte boundary. Numbers are in the byte order
+// of the machine, the magic catches files from one with another order. The
+// CRC32C of everything after the header, followed by the header with crc
+// zeroed, is kept in crc.
+
+#define SNAPSHOT_MAGIC "PIVSNAP"
+#define SNAPSHOT_VERSION 2
+
+struct SnapshotHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t hasLabels;
+    uint64_t tag;               // data version chosen by the caller
+    uint64_t numVertices;
+    uint64_t numNeighbors;      // twice the number of edges
+    uint64_t offsetsOffset;     // file offsets of the sections
+    uint64_t neighborsOffset;
+    uint64_t orderOffset;
+    uint64_t labelsOffset;
+    uint64_t countsOffset;
+    uint64_t fileSize;
+    uint32_t crc;
+    uint32_t reserved;
+};
+
+// max_k (none if unbounded) -> k -> decimal count
+typedef std::map<std::optional<int>, std::map<int, std::string>> SnapshotCounts;
+
+inline uint64_t alignSnapshotOffset(uint64_t offset) {
+    return (offset + 7) & ~uint64_t(7);
+}
+
+// Buffered writes of a new snapshot file, keeping the CRC32C of what is
+// written after the header. finish() puts the header in front and syncs the
+// file; one that is never finished is removed.
+class SnapshotWriter {
+public:
+    explicit SnapshotWriter(const std::string& path) : path(path) {
+        fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0) {
+            throw std::runtime_error("cannot write snapshot " + path);
+        }
+    }
+
+    ~SnapshotWriter() {
+        if (fd >= 0) {
+            close(fd);
+            unlink(path.c_str());
+        }
+    }
+
+    SnapshotWriter(const SnapshotWriter&) = delete;
+    SnapshotWriter& operator=(const SnapshotWriter&) = delete;
+
+    void write(const void* data, size_t length) {
+        const char* bytes = static_cast<const char*>(data);
+        checksum = crc32c(bytes, length, checksum);
+        buffer.append(bytes, length);
+        offset += length;
+        if (buffer.size() >= BUFFER_SIZE) {
+            flush();
+        }
+    }
+
+    uint64_t position() const {
+        return offset;
+    }
+
+    uint32_t crc() const {
+        return checksum;
+    }
+
+    void finish(const SnapshotHeader& header) {
+        flush();
+        writeAt(&header, sizeof(header), 0);
+        if (fsync(fd) != 0 || close(fd) != 0) {
+            fd = -1;
+            unlink(path.c_str());
+            throw std::runtime_error("cannot write snapshot " + path);
+        }
+        fd = -1;
+    }
+
+private:
+    static constexpr size_t BUFFER_SIZE = 1 << 20;
+
+    std::string path;
+    int fd;
+    std::string buffer;
+    uint64_t offset = sizeof(SnapshotHeader);  // the header comes last
+    uint32_t checksum = 0;
+
+    void flush() {
+        writeAt(buffer.data(), buffer.size(), offset - buffer.size());
+        buffer.clear();
+    }
+
+    void writeAt(const void* data, size_t length, uint64_t at) {
+        const char* bytes = static_cast<const char*>(data);
+        while (length > 0) {
+            ssize_t written = pwrite(fd, bytes, length, at);
+            if (written < 0 && errno == EINTR) {
+                continue;
+            }
+            if (written <= 0) {
+                throw std::runtime_error("cannot write snapshot " + path);
+            }
+            bytes += written;
+            length -= written;
+            at += written;
+        }
+    }
+};
+
+class CliqueSnapshot {
+public:
+    // Write the snapshot to path + ".tmp" and rename it over path, so that a
+    // crash leaves either the old snapshot or the new one.
+    static void save(const std::string& path, const std::vector<std::set<int>>& adjacency,
+        const int* orderNumbers, const std::vector<std::string>* labels,
+        const SnapshotCounts& counts, uint64_t tag) {
+        uint64_t n = adjacency.size();
+
+        SnapshotHeader header;
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+        header.version = SNAPSHOT_VERSION;
+        header.hasLabels = labels != nullptr;
+        header.tag = tag;
+        header.numVertices = n;
+
+        std::vector<uint64_t> offsets(n + 1, 0);
+        for (uint64_t v = 0; v < n; v++) {
+            offsets[v + 1] = offsets[v] + adjacency[v].size();
+        }
+        header.numNeighbors = offsets[n];
+
+        std::vector<uint64_t> labelOffsets;
+        if (labels) {
+            if (labels->size() != n) {
+                throw std::invalid_argument("there must be one label per vertex");
+            }
+            labelOffsets.assign(n + 1, 0);
+            for (uint64_t v = 0; v < n; v++) {
+                labelOffsets[v + 1] = labelOffsets[v] + (*labels)[v].size();
+            }
+        }
+
+        header.offsetsOffset = alignSnapshotOffset(sizeof(SnapshotHeader));
+        header.neighborsOffset = alignSnapshotOffset(header.offsetsOffset + (n + 1) * sizeof(uint64_t));
+        header.orderOffset = alignSnapshotOffset(header.neighborsOffset + header.numNeighbors * sizeof(int32_t));
+        header.labelsOffset = alignSnapshotOffset(header.orderOffset + n * sizeof(int32_t));
+        header.countsOffset = labels
+            ? alignSnapshotOffset(header.labelsOffset + (n + 1) * sizeof(uint64_t) + labelOffsets[n])
+            : header.labelsOffset;
+
+        std::string tempPath = path + ".tmp";
+        SnapshotWriter out(tempPath);
+
+        pad(out, header.offsetsOffset);
+        out.write(offsets.data(), offsets.size() * sizeof(uint64_t));
+
+        pad(out, header.neighborsOffset);
+        std::vector<int32_t> row;
+        for (uint64_t v = 0; v < n; v++) {
+            row.assign(adjacency[v].begin(), adjacency[v].end());
+            out.write(row.data(), row.size() * sizeof(int32_t));
+        }
+
+        pad(out, header.orderOffset);
+        out.write(orderNumbers, n * sizeof(int32_t));
+
+        if (labels) {
+            pad(out, header.labelsOffset);
+            out.write(labelOffsets.data(), labelOffsets.size() * sizeof(uint64_t));
+            for (const std::string& label : *labels) {
+                out.write(label.data(), label.size());
+            }
+        }
+
+        pad(out, header.countsOffset);
+        writeCounts(out, counts);
+
+        header.fileSize = out.position();
+        header.crc = crc32c(reinterpret_cast<const char*>(&header), sizeof(header), out.crc());
+        out.finish(header);
+
+        if (std::rename(tempPath.c_str(), path.c_str()) != 0) {
+            std::remove(tempPath.c_str());
+            throw std::runtime_error("cannot replace snapshot " + path);
+        }
+
+        // the rename is only durable once the directory is synced
+        size_t slash = path.rfind('/');
+        std::string dir = slash == std::string::npos ? "." : path.substr(0, slash + 1);
+        int dirFd = open(dir.c_str(), O_RDONLY | O_DIRECTORY);
+        if (dirFd >= 0) {
+            fsync(dirFd);
+            close(dirFd);
+        }
+    }
+
+    // map the snapshot at path, throws std::runtime_error if it is not a
+    // valid snapshot of this version
+    explicit CliqueSnapshot(const std::string& path) {
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw std::runtime_error("cannot open snapshot " + path);
+        }
+
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(SnapshotHeader)) {
+            close(fd);
+            throw std::runtime_error("snapshot " + path + " is truncated");
+        }
+
+        size = st.st_size;
+        data = static_cast<const char*>(mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0));
+        close(fd);
+
+        if (data == MAP_FAILED) {
+            throw std::runtime_error("cannot map snapshot " + path);
+        }
+
+        try {
+            validate(path);
+        }
+        catch (...) {
+            munmap(const_cast<char*>(data), size);
+            throw;
+        }
+    }
+
+    ~CliqueSnapshot() {
+        munmap(const_cast<char*>(data), size);
+    }
+
+    CliqueSnapshot(const CliqueSnapshot&) = delete;
+    CliqueSnapshot& operator=(const CliqueSnapshot&) = delete;
+
+    uint64_t tag() const {
+        return header->tag;
+    }
+
+    int numVertices() const {
+        return header->numVertices;
+    }
+
+    uint64_t numEdges() const {
+        return header->numNeighbors / 2;
+    }
+
+    bool hasLabels() const {
+        return header->hasLabels;
+    }
+
+    std::vector<std::set<int>> adjacency() const {
+        std::vector<std::set<int>> result(numVertices());
+        for (int v = 0; v < numVertices(); v++) {
+            // neighbors were written in order, hint the insertion at the end
+            for (uint64_t i = offsets[v]; i < offsets[v + 1]; i++) {
+                result[v].insert(result[v].end(), neighbors[i]);
+            }
+        }
+        return result;
+    }
+
+    std::vector<std::string> labels() const {
+        std::vector<std::string> result;
+        if (!hasLabels()) {
+            return result;
+        }
+
+        const uint64_t* labelOffsets = at<uint64_t>(header->labelsOffset);
+        const char* labelBytes = reinterpret_cast<const char*>(labelOffsets + numVertices() + 1);
+
+        result.reserve(numVertices());
+        for (int v = 0; v < numVertices(); v++) {
+            result.emplace_back(labelBytes + labelOffsets[v], labelOffsets[v + 1] - labelOffsets[v]);
+        }
+        return result;
+    }
+
+    SnapshotCounts counts() const {
+        return readCounts();
+    }
+
+    // the stored ordering as listAllCliquesDegeneracy_A takes it, *deg is
+    // set to the max later-degree
+    NeighborListArray** orderingArray(int* deg) const {
+        int n = numVertices();
+        NeighborListArray** orderingArray = new NeighborListArray * [n];
+
+        *deg = 0;
+        for (int v = 0; v < n; v++) {
+            NeighborListArray* list = new NeighborListArray();
+            list->vertex = v;
+            list->orderNumber = orderNumbers[v];
+            list->laterDegree = 0;
+            list->earlierDegree = 0;
+
+            for (uint64_t i = offsets[v]; i < offsets[v + 1]; i++) {
+                if (orderNumbers[neighbors[i]] > orderNumbers[v]) {
+                    list->laterDegree++;
+                }
+                else {
+                    list->earlierDegree++;
+                }
+            }
+
+            list->later = new int[list->laterDegree];
+            list->earlier = new int[list->earlierDegree];
+
+            int later = 0, earlier = 0;
+            for (uint64_t i = offsets[v]; i < offsets[v + 1]; i++) {
+                if (orderNumbers[neighbors[i]] > orderNumbers[v]) {
+                    list->later[later++] = neighbors[i];
+                }
+                else {
+                    list->earlier[earlier++] = neighbors[i];
+                }
+            }
+
+            *deg = std::max(*deg, list->laterDegree);
+            orderingArray[v] = list;
+        }
+
+        return orderingArray;
+    }
+
+private:
+    const char* data;
+    size_t size;
+    const SnapshotHeader* header;
+    const uint64_t* offsets;
+    const int32_t* neighbors;
+    const int32_t* orderNumbers;
+
+    template <typename T>
+    const T* at(uint64_t offset) const {
+        return reinterpret_cast<const T*>(data + offset);
+    }
+
+    static void pad(SnapshotWriter& out, uint64_t offset) {
+        static const char zeros[8] = {0};
+        out.write(zeros, offset - out.position());
+    }
+
+    // uint32 number of count sets, then for each set int32 max_k (-1 if
+    // unbounded), uint32 number of counts and for each count int32 k,
+    // uint32 length and the decimal digits
+    static void writeCounts(SnapshotWriter& out, const SnapshotCounts& counts) {
+        writeValue<uint32_t>(out, counts.size());
+        for (const auto& countSet : counts) {
+            writeValue<int32_t>(out, countSet.first ? *countSet.first : -1);
+            writeValue<uint32_t>(out, countSet.second.size());
+            for (const auto& count : countSet.second) {
+                writeValue<int32_t>(out, count.first);
+                writeValue<uint32_t>(out, count.second.size());
+                out.write(count.second.data(), count.second.size());
+            }
+        }
+    }
+
+    template <typename T>
+    static void writeValue(SnapshotWriter& out, T value) {
+        out.write(&value, sizeof(T));
+    }
+
+    SnapshotCounts readCounts() const {
+        uint64_t position = header->countsOffset;
+        SnapshotCounts result;
+
+        uint32_t numSets = readValue<uint32_t>(position);
+        for (uint32_t i = 0; i < numSets; i++) {
+            int32_t max_k = readValue<int32_t>(position);
+            uint32_t numCounts = readValue<uint32_t>(position);
+
+            std::map<int, std::string>& countSet = result[max_k < 0 ? std::nullopt : std::optional<int>(max_k)];
+            for (uint32_t j = 0; j < numCounts; j++) {
+                int32_t k = readValue<int32_t>(position);
+                uint32_t length = readValue<uint32_t>(position);
+                if (position + length > header->fileSize) {
+                    throw std::runtime_error("snapshot counts are truncated");
+                }
+                countSet[k] = std::string(data + position, length);
+                position += length;
+            }
+        }
+
+        return result;
+    }
+
+    template <typename T>
+    T readValue(uint64_t& position) const {
+        if (position + sizeof(T) > header->fileSize) {
+            throw std::runtime_error("snapshot counts are truncated");
+        }
+        T value;
+        memcpy(&value, data + position, sizeof(T));
+        position += sizeof(T);
+        return value;
+    }
+
+    // the header, the CRC and every offset and vertex id the other methods
+    // index with, so that they never read outside the file
+    void validate(const std::string& path) {
+        header = at<SnapshotHeader>(0);
+
+        if (memcmp(header->magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) != 0) {
+            throw std::runtime_error(path + " is not a clique snapshot");
+        }
+        if (header->version != SNAPSHOT_VERSION) {
+            throw std::runtime_error("snapshot " + path + " has version "
+                + std::to_string(header->version) + ", expected "
+                + std::to_string(SNAPSHOT_VERSION));
+        }
+        if (header->fileSize != size) {
+            throw std::runtime_error("snapshot " + path + " is truncated");
+        }
+
+        SnapshotHeader zeroed = *header;
+        zeroed.crc = 0;
+        uint32_t crc = crc32c(data + sizeof(SnapshotHeader), size - sizeof(SnapshotHeader));
+        if (crc32c(reinterpret_cast<const char*>(&zeroed), sizeof(zeroed), crc) != header->crc) {
+            throw std::runtime_error("snapshot " + path + " is corrupted: checksum mismatch");
+        }
+
+        auto corrupted = [&path](const std::string& what) {
+            return std::runtime_error("snapshot " + path + " is corrupted: " + what);
+        };
+
+        uint64_t n = header->numVertices;
+        if (n > uint64_t(std::numeric_limits<int32_t>::max()) || n > size / sizeof(uint64_t)
+            || header->numNeighbors > size / sizeof(int32_t)) {
+            throw corrupted("invalid sizes");
+        }
+        if (header->offsetsOffset < sizeof(SnapshotHeader)
+            || header->neighborsOffset < header->offsetsOffset + (n + 1) * sizeof(uint64_t)
+            || header->orderOffset < header->neighborsOffset + header->numNeighbors * sizeof(int32_t)
+            || header->labelsOffset < header->orderOffset + n * sizeof(int32_t)
+            || header->countsOffset < header->labelsOffset
+            || header->countsOffset > size
+            || (header->hasLabels && header->countsOffset
+                < header->labelsOffset + (n + 1) * sizeof(uint64_t))
+            || header->offsetsOffset % 8 || header->neighborsOffset % 8
+            || header->orderOffset % 8 || header->labelsOffset % 8) {
+            throw corrupted("invalid section offsets");
+        }
+
+        offsets = at<uint64_t>(header->offsetsOffset);
+        neighbors = at<int32_t>(header->neighborsOffset);
+        orderNumbers = at<int32_t>(header->orderOffset);
+
+        // rows in bounds, sorted, without the vertex itself, and every edge
+        // in the rows of both ends
+        if (offsets[0] != 0 || offsets[n] != header->numNeighbors) {
+            throw corrupted("invalid neighbor offsets");
+        }
+        for (uint64_t v = 0; v < n; v++) {
+            if (offsets[v + 1] < offsets[v] || offsets[v + 1] > header->numNeighbors) {
+                throw corrupted("invalid neighbor offsets");
+            }
+        }
+        for (uint64_t v = 0; v < n; v++) {
+            for (uint64_t i = offsets[v]; i < offsets[v + 1]; i++) {
+                int32_t u = neighbors[i];
+                if (u < 0 || uint64_t(u) >= n || uint64_t(u) == v
+                    || (i > offsets[v] && neighbors[i - 1] >= u)) {
+                    throw corrupted("invalid neighbors of vertex " + std::to_string(v));
+                }
+                if (!std::binary_search(neighbors + offsets[u], neighbors + offsets[u + 1], int32_t(v))) {
+                    throw corrupted("edge " + std::to_string(v) + " - " + std::to_string(u)
+                        + " is stored in one direction only");
+                }
+            }
+        }
+
+        // the ordering is a permutation, order numbers index orderingArray
+        std::vector<bool> seen(n, false);
+        for (uint64_t v = 0; v < n; v++) {
+            int32_t order = orderNumbers[v];
+            if (order < 0 || uint64_t(order) >= n || seen[order]) {
+                throw corrupted("invalid ordering");
+            }
+            seen[order] = true;
+        }
+
+        if (header->hasLabels) {
+            const uint64_t* labelOffsets = at<uint64_t>(header->labelsOffset);
+            uint64_t labelBytes = header->countsOffset - header->labelsOffset - (n + 1) * sizeof(uint64_t);
+            if (labelOffsets[0] != 0 || labelOffsets[n] > labelBytes) {
+                throw corrupted("invalid label offsets");
+            }
+            for (uint64_t v = 0; v < n; v++) {
+                if (labelOffsets[v + 1] < labelOffsets[v]) {
+                    throw corrupted("invalid label offsets");
+                }
+            }
+        }
+
+        readCounts();
+    }
+};
+
+#endif // SNAPSHOT_H
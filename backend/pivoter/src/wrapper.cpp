@@ -1,10 +1,39 @@
 #include <pybind11/pybind11.h>
 #include <pybind11/stl.h>
+#include <pybind11/numpy.h>
 #include "pivoter.h"
+#include "incremental.h"
+#include "estimate.h"
+#include "snapshot.h"
 
 namespace py = pybind11;
 
-std::map<int, std::string> pivoter(const std::vector<std::set<int>>& py_adjacency_list) {
+// set from python, possibly from another thread, to stop a running count
+class CancellationToken {
+public:
+    void cancel() {
+        flag.store(true, std::memory_order_relaxed);
+    }
+
+    bool cancelled() const {
+        return flag.load(std::memory_order_relaxed);
+    }
+
+    const std::atomic<bool>* get() const {
+        return &flag;
+    }
+
+private:
+    std::atomic<bool> flag{false};
+};
+
+struct PivoterCancelled : std::runtime_error {
+    PivoterCancelled() : std::runtime_error("pivoter was cancelled") {}
+};
+
+// degeneracy ordering of the python adjacency list, *deg is set to the
+// max later-degree
+NeighborListArray** computeOrdering(const std::vector<std::set<int>>& py_adjacency_list, int* deg) {
     int n = py_adjacency_list.size();
     std::list<int>** adjList = new std::list<int>*[n];
 
@@ -15,43 +44,409 @@ std::map<int, std::string> pivoter(const std::vector<std::set<int>>& py_adjacenc
         }
     }
 
-    int deg = 0;
     NeighborListArray** orderingArray = computeDegeneracyOrderArray(adjList, n);
 
+    *deg = 0;
     for (int i = 0; i < n; i++) {
-        if (deg < orderingArray[i]->laterDegree) deg = orderingArray[i]->laterDegree;
+        if (*deg < orderingArray[i]->laterDegree) *deg = orderingArray[i]->laterDegree;
     }
 
-    mpz_t* cliqueCounts = new mpz_t[deg + 1];
-    for (int i = 0; i <= deg; i++) {
-        mpz_init(cliqueCounts[i]);
-        mpz_set_ui(cliqueCounts[i], 0);
+    for (int i = 0; i < n; i++) {
+        delete adjList[i];
     }
+    delete[] adjList;
 
-    listAllCliquesDegeneracy_A(cliqueCounts, orderingArray, n, deg);
+    return orderingArray;
+}
 
+std::map<int, std::string> countsToMap(mpz_t* cliqueCounts, int size) {
     std::map<int, std::string> result;
     char buffer[1024];
 
-    for (int i = 0; i <= deg; i++) {
+    for (int i = 0; i < size; i++) {
         if (mpz_cmp_ui(cliqueCounts[i], 0) != 0) {
             gmp_snprintf(buffer, sizeof(buffer), "%Zd", cliqueCounts[i]);
             result[i] = std::string(buffer);
         }
     }
 
-    for (int i = 0; i <= deg; i++) {
+    return result;
+}
+
+// Runs listAllCliquesDegeneracy_A with the GIL released. progress, if not
+// None, is called as progress(done, total) and holds the GIL only for that
+// call; if it raises, the count stops and the error is rethrown here.
+// Throws PivoterCancelled if token was cancelled before the count finished.
+void countCliquesWithoutGil(mpz_t* cliqueCounts, NeighborListArray** orderingArray,
+    int size, int max_k, LocalCliqueCounts* localCounts,
+    const py::object& progress, const CancellationToken* token) {
+    PivoterControl control;
+    std::exception_ptr progressError;
+
+    if (token) {
+        control.cancelled = token->get();
+    }
+
+    if (!progress.is_none()) {
+        control.onProgress = [&](long long done, long long total) {
+            py::gil_scoped_acquire acquire;
+            try {
+                progress(done, total);
+            }
+            catch (py::error_already_set&) {
+                progressError = std::current_exception();
+                return false;
+            }
+            return true;
+        };
+    }
+
+    bool completed;
+    {
+        py::gil_scoped_release release;
+        completed = listAllCliquesDegeneracy_A(cliqueCounts, orderingArray,
+            size, max_k, localCounts, &control);
+    }
+
+    if (progressError) {
+        std::rethrow_exception(progressError);
+    }
+    if (!completed) {
+        throw PivoterCancelled();
+    }
+}
+
+void clearCliqueCounts(mpz_t* cliqueCounts, int max_k) {
+    for (int i = 0; i <= max_k; i++) {
         mpz_clear(cliqueCounts[i]);
     }
     delete[] cliqueCounts;
+}
 
+// count the cliques of a graph whose ordering is already known, deg is its
+// max later-degree
+std::map<int, std::string> countWithOrdering(NeighborListArray** orderingArray, int n,
+    int deg, std::optional<int> py_max_k, const py::object& progress,
+    const CancellationToken* cancel_token) {
+    // a clique is a vertex plus some of its later neighbors, so none is
+    // larger than deg + 1
+    int max_k = deg + 1;
+    if (py_max_k && *py_max_k < max_k) {
+        max_k = *py_max_k;
+    }
+
+    mpz_t* cliqueCounts = new mpz_t[max_k + 1];
+    for (int i = 0; i <= max_k; i++) {
+        mpz_init(cliqueCounts[i]);
+        mpz_set_ui(cliqueCounts[i], 0);
+    }
+
+    try {
+        countCliquesWithoutGil(cliqueCounts, orderingArray, n, max_k,
+            nullptr, progress, cancel_token);
+    }
+    catch (...) {
+        clearCliqueCounts(cliqueCounts, max_k);
+        throw;
+    }
+
+    std::map<int, std::string> result = countsToMap(cliqueCounts, max_k + 1);
+    clearCliqueCounts(cliqueCounts, max_k);
+
+    return result;
+}
+
+std::map<int, std::string> pivoter(const std::vector<std::set<int>>& py_adjacency_list,
+    std::optional<int> py_max_k, const py::object& progress,
+    const CancellationToken* cancel_token) {
+    if (py_max_k && *py_max_k < 1) {
+        throw std::invalid_argument("max_k must be at least 1");
+    }
+
+    int n = py_adjacency_list.size();
+
+    int deg = 0;
+    NeighborListArray** orderingArray;
+    {
+        py::gil_scoped_release release;
+        orderingArray = computeOrdering(py_adjacency_list, &deg);
+    }
+
+    return countWithOrdering(orderingArray, n, deg, py_max_k, progress, cancel_token);
+}
+
+// same as pivoter() on the snapshot graph, without recomputing its ordering
+std::map<int, std::string> pivoter_snapshot(const CliqueSnapshot& snapshot,
+    std::optional<int> py_max_k, const py::object& progress,
+    const CancellationToken* cancel_token) {
+    if (py_max_k && *py_max_k < 1) {
+        throw std::invalid_argument("max_k must be at least 1");
+    }
+
+    int deg = 0;
+    NeighborListArray** orderingArray;
+    {
+        py::gil_scoped_release release;
+        orderingArray = snapshot.orderingArray(&deg);
+    }
+
+    return countWithOrdering(orderingArray, snapshot.numVertices(), deg,
+        py_max_k, progress, cancel_token);
+}
+
+void save_snapshot(const std::string& path, const std::vector<std::set<int>>& py_adjacency_list,
+    const SnapshotCounts& counts, uint64_t tag,
+    std::optional<std::vector<std::string>> labels) {
+    int n = py_adjacency_list.size();
+
+    int deg = 0;
+    NeighborListArray** orderingArray = computeOrdering(py_adjacency_list, &deg);
+
+    std::vector<int> orderNumbers(n);
     for (int i = 0; i < n; i++) {
-        delete adjList[i];
+        orderNumbers[i] = orderingArray[i]->orderNumber;
+        delete[] orderingArray[i]->later;
+        delete[] orderingArray[i]->earlier;
+        delete orderingArray[i];
     }
-    delete[] adjList;
+    delete[] orderingArray;
+
+    CliqueSnapshot::save(path, py_adjacency_list, orderNumbers.data(),
+        labels ? &*labels : nullptr, counts, tag);
+}
+
+std::pair<std::map<int, std::string>, std::map<int, py::array_t<double>>>
+pivoter_local(const std::vector<std::set<int>>& py_adjacency_list, int max_k,
+    const py::object& progress, const CancellationToken* cancel_token) {
+    if (max_k < 1) {
+        throw std::invalid_argument("max_k must be at least 1");
+    }
+
+    int n = py_adjacency_list.size();
+
+    int deg = 0;
+    NeighborListArray** orderingArray;
+    {
+        py::gil_scoped_release release;
+        orderingArray = computeOrdering(py_adjacency_list, &deg);
+    }
+
+    // no clique is larger than deg + 1, and the per-vertex table has
+    // max_k + 1 rows
+    if (max_k > deg + 1) {
+        max_k = deg + 1;
+    }
+
+    mpz_t* cliqueCounts = new mpz_t[max_k + 1];
+    for (int i = 0; i <= max_k; i++) {
+        mpz_init(cliqueCounts[i]);
+        mpz_set_ui(cliqueCounts[i], 0);
+    }
+
+    LocalCliqueCounts* localCounts = createLocalCliqueCounts(n, deg, max_k);
+
+    try {
+        countCliquesWithoutGil(cliqueCounts, orderingArray, n, max_k,
+            localCounts, progress, cancel_token);
+    }
+    catch (...) {
+        destroyLocalCliqueCounts(localCounts);
+        clearCliqueCounts(cliqueCounts, max_k);
+        throw;
+    }
+
+    std::map<int, std::string> globalResult = countsToMap(cliqueCounts, max_k + 1);
+
+    std::map<int, py::array_t<double>> localResult;
+    for (int k = 1; k <= max_k; k++) {
+        py::array_t<double> perVertex(n);
+        std::memcpy(perVertex.mutable_data(), localCounts->counts + size_t(k) * n,
+            size_t(n) * sizeof(double));
+        localResult[k] = perVertex;
+    }
+
+    destroyLocalCliqueCounts(localCounts);
+    clearCliqueCounts(cliqueCounts, max_k);
+
+    return std::make_pair(globalResult, localResult);
+}
+
+std::map<int, std::string> pivoter_incremental(const Neighborhoods& neighborhoods,
+    const std::vector<std::pair<int, int>>& new_edges, std::optional<int> py_max_k) {
+    if (py_max_k && *py_max_k < 1) {
+        throw std::invalid_argument("max_k must be at least 1");
+    }
+
+    NewEdgeCliqueCounter counter(neighborhoods, new_edges);
+
+    int max_k = counter.maxCliqueSize();
+    if (py_max_k && *py_max_k < max_k) {
+        max_k = *py_max_k;
+    }
+
+    mpz_t* cliqueCounts = new mpz_t[max_k + 1];
+    for (int i = 0; i <= max_k; i++) {
+        mpz_init(cliqueCounts[i]);
+        mpz_set_ui(cliqueCounts[i], 0);
+    }
+
+    counter.count(cliqueCounts, max_k);
+
+    std::map<int, std::string> result = countsToMap(cliqueCounts, max_k + 1);
+    clearCliqueCounts(cliqueCounts, max_k);
 
     return result;
 }
+
+// k -> (estimate, low, high), the bounds of a 95% confidence interval, of
+// a graph whose ordering is already known; takes ownership of
+// orderingArray, deg is its max later-degree
+std::map<int, std::tuple<double, double, double>> estimateWithOrdering(
+    NeighborListArray** orderingArray, int n, long long edges, int deg,
+    std::optional<int> py_max_k, int time_budget_ms, std::optional<uint64_t> seed) {
+    int max_k = deg + 1;
+    if (py_max_k && *py_max_k < max_k) {
+        max_k = *py_max_k;
+    }
+
+    CliqueCountEstimate estimate = estimateCliqueCounts(orderingArray, n, max_k,
+        std::chrono::milliseconds(time_budget_ms),
+        seed ? *seed : std::random_device()());
+
+    // cliques of up to two vertices are known without sampling
+    estimate.estimate[0] = 1;
+    estimate.stdError[0] = 0;
+    if (max_k >= 1) {
+        estimate.estimate[1] = n;
+        estimate.stdError[1] = 0;
+    }
+    if (max_k >= 2) {
+        estimate.estimate[2] = edges;
+        estimate.stdError[2] = 0;
+    }
+
+    std::map<int, std::tuple<double, double, double>> result;
+    for (int k = 0; k <= max_k; k++) {
+        if (estimate.estimate[k] == 0) {
+            continue;
+        }
+
+        long double halfWidth = 1.96L * estimate.stdError[k];
+        result[k] = std::make_tuple(double(estimate.estimate[k]),
+            double(std::max(0.0L, estimate.estimate[k] - halfWidth)),
+            double(estimate.estimate[k] + halfWidth));
+    }
+
+    return result;
+}
+
+void checkEstimateArguments(std::optional<int> py_max_k, int time_budget_ms) {
+    if (py_max_k && *py_max_k < 1) {
+        throw std::invalid_argument("max_k must be at least 1");
+    }
+    if (time_budget_ms < 0) {
+        throw std::invalid_argument("time_budget_ms must not be negative");
+    }
+}
+
+std::map<int, std::tuple<double, double, double>> pivoter_estimate(
+    const std::vector<std::set<int>>& py_adjacency_list, std::optional<int> py_max_k,
+    int time_budget_ms, std::optional<uint64_t> seed) {
+    checkEstimateArguments(py_max_k, time_budget_ms);
+
+    long long edges = 0;
+    for (const auto& neighbors : py_adjacency_list) {
+        edges += neighbors.size();
+    }
+    edges /= 2;
+
+    int deg = 0;
+    NeighborListArray** orderingArray = computeOrdering(py_adjacency_list, &deg);
+
+    return estimateWithOrdering(orderingArray, py_adjacency_list.size(), edges, deg,
+        py_max_k, time_budget_ms, seed);
+}
+
+// same as pivoter_estimate() on the snapshot graph, without recomputing its
+// ordering
+std::map<int, std::tuple<double, double, double>> estimate_snapshot(const CliqueSnapshot& snapshot,
+    std::optional<int> py_max_k, int time_budget_ms, std::optional<uint64_t> seed) {
+    checkEstimateArguments(py_max_k, time_budget_ms);
+
+    int deg = 0;
+    NeighborListArray** orderingArray = snapshot.orderingArray(&deg);
+
+    return estimateWithOrdering(orderingArray, snapshot.numVertices(), snapshot.numEdges(), deg,
+        py_max_k, time_budget_ms, seed);
+}
+
 PYBIND11_MODULE(_pivoter, m) {
-    m.def("pivoter", &pivoter, "Calculate clique counts for each degree");
+    py::class_<CancellationToken>(m, "CancellationToken")
+        .def(py::init<>())
+        .def("cancel", &CancellationToken::cancel,
+            "Stop the counts this token was passed to, they raise PivoterCancelled")
+        .def_property_readonly("cancelled", &CancellationToken::cancelled);
+
+    py::register_exception<PivoterCancelled>(m, "PivoterCancelled");
+
+    m.def("pivoter", &pivoter,
+        "Calculate clique counts for each degree, only up to max_k if given. The GIL is "
+        "released while counting; progress, if given, is called with (done, total) about "
+        "every 100ms and cancel_token can stop the count from another thread",
+        py::arg("py_adjacency_list"), py::arg("max_k") = py::none(),
+        py::arg("progress") = py::none(), py::arg("cancel_token") = py::none());
+    m.def("pivoter_local", &pivoter_local,
+        "Calculate clique counts for each degree up to max_k, along with the number of "
+        "k-cliques each vertex belongs to. max_k is lowered to the largest possible clique "
+        "size. progress and cancel_token work as in pivoter",
+        py::arg("py_adjacency_list"), py::arg("max_k"),
+        py::arg("progress") = py::none(), py::arg("cancel_token") = py::none());
+    m.def("pivoter_incremental", &pivoter_incremental,
+        "Calculate, for each degree up to max_k if given, the number of cliques that contain "
+        "at least one of new_edges. neighborhoods maps the endpoints of new_edges and their "
+        "common neighbors to their neighbors in the graph with new_edges added",
+        py::arg("neighborhoods"), py::arg("new_edges"), py::arg("max_k") = py::none(),
+        py::call_guard<py::gil_scoped_release>());
+    py::class_<CliqueSnapshot>(m, "CliqueSnapshot")
+        .def(py::init<const std::string&>(), py::arg("path"),
+            "Map a snapshot written by save_snapshot, raises RuntimeError if it is not "
+            "a valid snapshot of this version")
+        .def_property_readonly("tag", &CliqueSnapshot::tag)
+        .def_property_readonly("num_vertices", &CliqueSnapshot::numVertices)
+        .def_property_readonly("num_edges", &CliqueSnapshot::numEdges)
+        .def("adjacency_list", &CliqueSnapshot::adjacency,
+            py::call_guard<py::gil_scoped_release>())
+        .def("labels", [](const CliqueSnapshot& snapshot) -> std::optional<std::vector<std::string>> {
+            if (!snapshot.hasLabels()) {
+                return std::nullopt;
+            }
+            return snapshot.labels();
+        })
+        .def("counts", &CliqueSnapshot::counts,
+            "Stored clique counts by max_k, None for unbounded counts")
+        .def("pivoter", &pivoter_snapshot,
+            "Same as pivoter() on the snapshot graph, reusing the stored degeneracy ordering",
+            py::arg("max_k") = py::none(), py::arg("progress") = py::none(),
+            py::arg("cancel_token") = py::none())
+        .def("estimate", &estimate_snapshot,
+            "Same as pivoter_estimate() on the snapshot graph, reusing the stored degeneracy "
+            "ordering",
+            py::arg("max_k") = py::none(), py::arg("time_budget_ms") = 1000,
+            py::arg("seed") = py::none(), py::call_guard<py::gil_scoped_release>());
+
+    m.def("save_snapshot", &save_snapshot,
+        "Write the graph, its degeneracy ordering and the clique counts (by max_k, None "
+        "for unbounded) to a versioned binary snapshot at path. tag is kept as is for the "
+        "caller to tell which data the snapshot was made from, labels names each vertex",
+        py::arg("path"), py::arg("py_adjacency_list"), py::arg("counts"), py::arg("tag"),
+        py::arg("labels") = py::none(), py::call_guard<py::gil_scoped_release>());
+    m.def("pivoter_estimate", &pivoter_estimate,
+        "Estimate clique counts for each degree, only up to max_k if given, by sampling "
+        "roots for about time_budget_ms. Returns (estimate, low, high) for each degree, "
+        "low and high bounding a 95% confidence interval. The counts are exact, with "
+        "low == high, for degrees up to 2 and when every root got sampled. The budget only "
+        "covers the sampling, not converting the graph and computing its ordering",
+        py::arg("py_adjacency_list"), py::arg("max_k") = py::none(),
+        py::arg("time_budget_ms") = 1000, py::arg("seed") = py::none(),
+        py::call_guard<py::gil_scoped_release>());
 }
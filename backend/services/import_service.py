@@ -1,27 +1,41 @@
-from typing import List, Optional
+from typing import List, Optional, Tuple
 from backend.models.article import Article
 from backend.models.storage import LiteratureStorage
-from backend.utils.xml_parser import extract_keywords_basic, parse_articles_from_xml
+from backend.utils.xml_parser import extract_keywords_basic, parse_articles
+from bptree import parse_dblp
 
 
 class ImportService:
     def __init__(self, storage: LiteratureStorage):
         self.storage = storage
 
-    def import_from_xml(self, xml_content: str) -> int:
-        articles = parse_articles_from_xml(xml_content)
+    def import_from_xml(self, xml_content: bytes) -> Tuple[int, float]:
+        # returns the number of articles and the parsing throughput in MB/s
+        parser = parse_dblp(xml_content)
         imported_count = 0
 
-        for article in articles:
-            article_id = self.storage.add_article(
-                article, save_immediately=False)
-            if article_id > 0:
-                imported_count += 1
+        for articles in parse_articles(parser):
+            article_ids = self.storage.add_articles(
+                articles, save_immediately=False)
+            imported_count += sum(1 for article_id in article_ids if article_id > 0)
 
         self.storage._save_indices()
         self.storage._clear_cache()
 
-        return imported_count
+        print(f"Imported {imported_count} articles, "
+              f"{parser.bytes_read / 1024 / 1024:.1f} MB parsed at {parser.mb_per_second:.1f} MB/s")
+
+        return imported_count, parser.mb_per_second
+
+    def import_from_files(self, xml_paths: List[str], threads: int = 0) -> Tuple[int, float]:
+        # returns the number of articles and the overall throughput in MB/s
+        stats = self.storage.bulk_import(xml_paths, threads)
+        mb_per_second = stats.bytes / 1024 / 1024 / stats.seconds if stats.seconds > 0 else 0.0
+
+        print(f"Bulk imported {stats.articles} articles from {len(xml_paths)} files, "
+              f"{stats.bytes / 1024 / 1024:.1f} MB in {stats.seconds:.1f}s at {mb_per_second:.1f} MB/s")
+
+        return stats.articles, mb_per_second
 
     def import_manual_article(self, article_data: dict) -> Optional[int]:
         try:
@@ -13,15 +13,24 @@ class SearchService:
     def get_article_by_title(self, title: str) -> Optional[Article]:
         return self.storage.get_article_by_title(title)
 
-    def get_collaborators(self, author: str) -> Dict[str, int]:
-        return self.storage.get_collaborators(author)
+    def get_collaborators(self, author: str, limit: Optional[int] = None) -> Dict[str, int]:
+        return self.storage.get_collaborators(author, limit)
 
     def get_coauthor_articles(self, author: str, coauthor: str) -> List[Dict]:
         res = self.storage.get_coauthor_articles(author, coauthor)
         return [article.to_dict() for article in res]
 
+    def find_authors_fuzzy(self, name: str, max_distance: int = 2, limit: int = 10) -> List[Dict]:
+        res = self.storage.find_authors_fuzzy(name, min(max(max_distance, 0), 3), max(limit, 0))
+        return [{'name': author, 'distance': distance, 'articles': articles}
+                for author, distance, articles in res]
+
     def search_articles_by_keywords(self, keywords_pattern: str) -> List[Article]:
         return self.storage.search_articles_by_keywords(keywords_pattern)
 
+    def search_articles_ranked(self, keywords_pattern: str, limit: int = 20) -> List[Dict]:
+        res = self.storage.search_articles_ranked(keywords_pattern, max(limit, 0))
+        return [dict(article.to_dict(), score=score) for article, score in res]
+
     def get_article_by_id(self, article_id: int) -> Optional[Article]:
         return self.storage.get_article_by_id(article_id)
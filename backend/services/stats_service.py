@@ -2,23 +2,36 @@ from typing import List, Dict, Tuple, Set
 from backend.models.storage import LiteratureStorage
 
 
+# most keywords per year of get_yearly_keyword_frequencies
+MAX_YEARLY_KEYWORDS = 100
+
+
 class StatsService:
     def __init__(self, storage: LiteratureStorage):
         self.storage = storage
 
-    def get_author_article_counts(self) -> List[Tuple[str, int]]:
-        counts = self.storage.get_author_article_counts()
-        return sorted(counts.items(), key=lambda x: x[1], reverse=True)
+    def get_author_article_counts(self, limit: int = 100) -> List[Tuple[str, int]]:
+        # already most articles first
+        counts = self.storage.get_author_article_counts(max(limit, 0))
+        return list(counts.items())
 
     def get_yearly_keyword_frequencies(self, limit: int = 10) -> Dict[int, List[Tuple[str, int]]]:
-        yearly_keywords = self.storage.get_yearly_keyword_frequencies()
+        # already most frequent first; the tables are cached by limit
+        limit = min(max(limit, 0), MAX_YEARLY_KEYWORDS)
+        yearly_keywords = self.storage.get_yearly_keyword_frequencies(limit)
+
+        return {year: list(keywords.items()) for year, keywords in yearly_keywords.items()}
+
+    def get_keyword_trend(self, keywords: List[str], first_year: int, last_year: int) -> Dict[str, Dict[int, int]]:
+        # keywords are indexed lowercased
+        keywords = [keyword.strip().lower() for keyword in keywords if keyword.strip()]
+        return self.storage.get_keyword_trend(keywords, first_year, last_year)
 
-        result = {}
-        for year, keywords in yearly_keywords.items():
-            result[year] = sorted(
-                keywords.items(), key=lambda x: x[1], reverse=True)[:limit]
+    def count_cliques_with_progress(self, progress_callback=None, max_k=None, cancel_token=None):
+        return self.storage.count_cliques_with_progress(progress_callback, max_k, cancel_token)
 
-        return result
+    def estimate_cliques(self, max_k=None, time_budget_ms=1000) -> Dict[int, Tuple[float, float, float]]:
+        return self.storage.estimate_cliques(max_k, time_budget_ms)
 
-    def count_cliques_with_progress(self, progress_callback=None):
-        return self.storage.count_cliques_with_progress(progress_callback)
+    def get_top_clique_authors(self, k: int, limit: int = 100) -> List[Tuple[str, int]]:
+        return self.storage.get_top_clique_authors(k, limit)
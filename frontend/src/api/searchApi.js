@@ -7,3 +7,19 @@ export function searchByKeyword(query) {
     params: { q: query },
   })
 }
+
+export function searchRanked(query, limit = 20) {
+  return request({
+    url: '/search/ranked',
+    method: 'get',
+    params: { q: query, limit },
+  })
+}
+
+export function searchAuthors(name, distance = 2, limit = 10) {
+  return request({
+    url: '/search/authors',
+    method: 'get',
+    params: { q: name, distance, limit },
+  })
+}
@@ -14,3 +14,31 @@ export function getYearlyKeywordFrequencies() {
     method: 'get',
   })
 }
+
+export function getKeywordTrend(keywords, start, end) {
+  return request({
+    url: '/stats/keywords/trend',
+    method: 'get',
+    params: { keywords: keywords.join(','), start, end },
+  })
+}
+
+export function getTopCliqueAuthors(k = 3, limit = 100) {
+  return request({
+    url: '/stats/collaboration/clique-authors',
+    method: 'get',
+    params: { k, limit },
+  })
+}
+
+export function getCliquesEstimate(maxK = null, budgetMs = 500) {
+  const params = { budget_ms: budgetMs }
+  if (maxK !== null) {
+    params.max_k = maxK
+  }
+  return request({
+    url: '/stats/collaboration/cliques-estimate',
+    method: 'get',
+    params,
+  })
+}
@@ -1,4 +1,5 @@
 import os
+import sys
 import gzip
 import requests
 import time
@@ -287,6 +288,29 @@ def import_split_xml_files(target_dir, api_root='http://localhost:2747/api', run
     }
 
 
+def bulk_import_split_xml_files(target_dir, storage_dir=os.environ.get('DATA_DIR') or 'data', threads=0):
+    # offline, with the server stopped: every file goes into an empty
+    # storage at once, parsed on all cores with one index build at the end
+    from backend.models.storage import LiteratureStorage
+    from backend.services.import_service import ImportService
+
+    xml_files = [f for f in os.listdir(target_dir) if f.endswith('.xml')]
+    xml_files.sort(key=lambda x: int(x.split('_')[1].split('.')[0]))
+    xml_paths = [os.path.join(target_dir, xml_file) for xml_file in xml_files]
+
+    print(f"Bulk importing {len(xml_paths)} XML files into {storage_dir}")
+
+    storage = LiteratureStorage(storage_dir)
+    total_articles, mb_per_second = ImportService(
+        storage).import_from_files(xml_paths, threads)
+
+    return {
+        'total_files': len(xml_paths),
+        'total_articles': total_articles,
+        'mb_per_second': mb_per_second
+    }
+
+
 if __name__ == "__main__":
     target_dir = Path("tmp")
 
@@ -297,5 +321,8 @@ if __name__ == "__main__":
     num_files = split_large_xml(
         target_dir / "dblp.xml", split_dir, target_size_mb=100)
     '''
-    import_result = import_split_xml_files(split_dir, run_pivoter=True)
+    if "--bulk" in sys.argv:
+        import_result = bulk_import_split_xml_files(split_dir)
+    else:
+        import_result = import_split_xml_files(split_dir, run_pivoter=True)
     print("imported:", import_result)